@@ -27,6 +27,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include "../utils/log.h"
 #include "../gui/elems/mainWindow/keyboard/channel.h"
 #include "const.h"
@@ -55,6 +56,7 @@ Channel::Channel(int type, int bufferSize, bool mono)
 	bufferSize    (bufferSize),
 	volume_i      (1.0f),
 	volume_d      (0.0f),
+	volume_r      (G_DEFAULT_VOL),
 	boost         (G_DEFAULT_BOOST),
 	mute_i        (false),
 	name					(""),
@@ -79,13 +81,23 @@ Channel::Channel(int type, int bufferSize, bool mono)
 	midiOutLmute  (0x0),
 	midiOutLsolo  (0x0)
 {
+#ifdef WITH_VST
+	plugins.store(new std::vector<Plugin*>());
+	paramChangesCount = 0;
+	paramStack        = nullptr;
+#endif
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-Channel::~Channel() {}
+Channel::~Channel()
+{
+#ifdef WITH_VST
+	delete plugins.load();  // The plug-ins themselves are gone with freeStack()
+#endif
+}
 
 
 /* -------------------------------------------------------------------------- */
@@ -97,6 +109,23 @@ bool Channel::allocBuffers()
 		gu_log("[Channel::allocBuffers] unable to alloc memory for vChan!\n");
 		return false;
 	}
+	if (!oChan.alloc(bufferSize, G_OUT_CHANS)) {
+		gu_log("[Channel::allocBuffers] unable to alloc memory for oChan!\n");
+		return false;
+	}
+	if (!delayComp.alloc(G_MAX_DELAY_COMP, G_OUT_CHANS)) {
+		gu_log("[Channel::allocBuffers] unable to alloc memory for delayComp!\n");
+		return false;
+	}
+#ifdef WITH_VST
+	/* Reserve room for plug-in events now: clear() keeps it, so adding events in
+	the audio thread won't allocate. */
+	midiBuffer.ensureSize(G_MIDI_IN_BUFFER_SIZE);
+	midiScratch.ensureSize(G_MIDI_IN_BUFFER_SIZE);
+	emptyMidiBuffer.ensureSize(G_MIDI_IN_BUFFER_SIZE);
+	pluginBuffer.setSize(G_OUT_CHANS, bufferSize);
+	instrumentBuffer.setSize(G_OUT_CHANS, bufferSize);
+#endif
 	return true;
 }
 
@@ -114,6 +143,7 @@ void Channel::copy(const Channel* src, pthread_mutex_t* pluginMutex)
 {
 	key             = src->key;
 	volume          = src->volume;
+	volume_r        = src->volume;
 	pan             = src->pan;
 	mute_i          = src->mute_i;
 	mute_s          = src->mute_s;
@@ -129,8 +159,8 @@ void Channel::copy(const Channel* src, pthread_mutex_t* pluginMutex)
 	/* clone plugins */
 
 #ifdef WITH_VST
-	for (unsigned i=0; i<src->plugins.size(); i++)
-		pluginHost::clonePlugin(src->plugins.at(i), pluginMutex, this);
+	for (Plugin* p : src->getPlugins())
+		pluginHost::clonePlugin(p, this);
 #endif
 
 	/* clone actions */
@@ -139,11 +169,12 @@ void Channel::copy(const Channel* src, pthread_mutex_t* pluginMutex)
 		for (unsigned k=0; k<recorder::global.at(i).size(); k++) {
 			recorder::action* a = recorder::global.at(i).at(k);
 			if (a->chan == src->index) {
-				recorder::rec(index, a->type, a->frame, a->iValue, a->fValue);
+				recorder::recTick(index, a->type, a->tick, a->iValue, a->fValue);
 				hasActions = true;
 			}
 		}
 	}
+	recorder::sortActions();
 }
 
 
@@ -152,19 +183,17 @@ void Channel::copy(const Channel* src, pthread_mutex_t* pluginMutex)
 
 void Channel::sendMidiLmessage(uint32_t learn, const midimap::message_t& msg)
 {
-	gu_log("[channel::sendMidiLmessage] learn=%#X, chan=%d, msg=%#X, offset=%d\n",
-		learn, msg.channel, msg.value, msg.offset);
-
 	/* isolate 'channel' from learnt message and offset it as requested by 'nn'
 	 * in the midimap configuration file. */
 
 		uint32_t out = ((learn & 0x00FF0000) >> 16) << msg.offset;
 
 	/* merge the previously prepared channel into final message, and finally
-	 * send it. */
+	 * send it. It goes through the lighting cache of each device: no logging and
+	 * no waiting here, as this is often called by the audio thread. */
 
 	out |= msg.value | (msg.channel << 24);
-	kernelMidi::send(out);
+	kernelMidi::sendLight(out);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -219,9 +248,9 @@ void Channel::sendMidiLmute()
 	if (!midiOutL || midiOutLmute == 0x0)
 		return;
 	if (mute)
-		sendMidiLmessage(midiOutLsolo, midimap::muteOn);
+		sendMidiLmessage(midiOutLmute, midimap::muteOn);
 	else
-		sendMidiLmessage(midiOutLsolo, midimap::muteOff);
+		sendMidiLmessage(midiOutLmute, midimap::muteOff);
 }
 
 
@@ -288,30 +317,69 @@ void Channel::input(giada::m::AudioBuffer& in)
 }
 
 void Channel::output(giada::m::AudioBuffer& out) {
-	if (mute) return;
+	float vol = volume;
+	if (mute) {
+		volume_r = vol;
+		return;
+	}
 	assert(out.countFrames() == vChan.countFrames());
 
+	/* Linear ramp from the previous block's volume to the current one. */
+
+	float volStep = (vol - volume_r) / vChan.countFrames();
+
 	// Output fixed to stereo
 	peak = 0;
 	int outCh = conf::channelsOut;
 	if (mono) {
 		for (int i=0; i<vChan.countFrames(); i++) {
-			out[i][outCh] += vChan[i][0] * volume * calcPanning(0) * boost;
-			out[i][outCh+1] += vChan[i][0] * volume * calcPanning(1) * boost;
+			float v = volume_r + volStep * (i + 1);
+			out[i][outCh] += vChan[i][0] * v * calcPanning(0) * boost;
+			out[i][outCh+1] += vChan[i][0] * v * calcPanning(1) * boost;
 			if (out[i][outCh] > peak) peak = out[i][outCh];
 			if (out[i][outCh+1] > peak) peak = out[i][outCh+1];
 		}
 	}
 	else {
 		for (int i=0; i<vChan.countFrames(); i++) {
-			out[i][outCh] += vChan[i][0] * volume * calcPanning(0) * boost;
-			out[i][outCh+1] += vChan[i][1] * volume * calcPanning(1) * boost;
+			float v = volume_r + volStep * (i + 1);
+			out[i][outCh] += vChan[i][0] * v * calcPanning(0) * boost;
+			out[i][outCh+1] += vChan[i][1] * v * calcPanning(1) * boost;
 			if (out[i][outCh] > peak) peak = out[i][outCh];
 			if (out[i][outCh+1] > peak) peak = out[i][outCh+1];
 		}
 	}
+	volume_r = vol;
+}
+
+/* -------------------------------------------------------------------------- */
+
+
+void Channel::render(giada::m::AudioBuffer& in)
+{
+	oChan.clear();
+	process(oChan, in);
+	delayComp.process(oChan);
+}
+
+
+void Channel::mix(giada::m::AudioBuffer& out)
+{
+	assert(out.countFrames() == oChan.countFrames());
+
+	int channels = std::min(out.countChannels(), oChan.countChannels());
+	for (int i=0; i<out.countFrames(); i++)
+		for (int j=0; j<channels; j++)
+			out[i][j] += oChan[i][j];
+}
+
+
+void Channel::setDelayComp(int frames)
+{
+	delayComp.setDelay(frames);
 }
 
+
 /* -------------------------------------------------------------------------- */
 
 
@@ -362,6 +430,13 @@ void Channel::setVolume(float v)
 	volume = v;
 }
 
+
+void Channel::resetVolume(float v)
+{
+	volume   = v;
+	volume_r = v;
+}
+
 float Channel::getVolume() const
 {
 	return volume;
@@ -409,34 +484,76 @@ std::string Channel::getName() const
 
 /* -------------------------------------------------------------------------- */
 
-void Channel::receiveMidi(const giada::m::MidiEvent& midiEvent) {
+void Channel::receiveMidi(const giada::m::MidiEvent& midiEvent, int localFrame) {
 #ifdef WITH_VST
 
-
 	MidiEvent midiEventFlat(midiEvent);
 	midiEventFlat.setChannel(0);
-
-	while (true) {
-		if (pthread_mutex_trylock(&pluginHost::mutex_midi) != 0)
-			continue;
-		gu_log("[Channel::receiveMidi] msg=%X\n", midiEventFlat.getRaw());
-		addVstMidiEvent(midiEventFlat.getRaw(), 0);
-		pthread_mutex_unlock(&pluginHost::mutex_midi);
-		break;
-	}
+	addVstMidiEvent(midiEventFlat.getRaw(), localFrame);
 
 #endif
 }
 
 #ifdef WITH_VST
 
+const std::vector<Plugin*>& Channel::getPlugins() const
+{
+	return *plugins.load();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void Channel::addVstMidiEvent(uint32_t msg, int localFrame)
 {
-	juce::MidiMessage message = juce::MidiMessage(
-		kernelMidi::getB1(msg),
-		kernelMidi::getB2(msg),
-		kernelMidi::getB3(msg));
-	midiBuffer.addEvent(message, localFrame);
+	/* Raw bytes straight into the preallocated buffer, no juce::MidiMessage in
+	between. MidiBuffer figures out the actual length from the status byte. */
+
+	juce::uint8 data[3] = {
+		static_cast<juce::uint8>(kernelMidi::getB1(msg)),
+		static_cast<juce::uint8>(kernelMidi::getB2(msg)),
+		static_cast<juce::uint8>(kernelMidi::getB3(msg))
+	};
+	if (localFrame < 0)
+		localFrame = 0;
+	else
+	if (localFrame >= bufferSize)
+		localFrame = bufferSize - 1;
+	midiBuffer.addEvent(data, 3, localFrame);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void Channel::addParamChange(uint32_t key, float value, int localFrame)
+{
+	if (paramChangesCount == G_MAX_PARAM_CHANGES)
+		return;
+	if (localFrame < 0)
+		localFrame = 0;
+	else
+	if (localFrame >= bufferSize)
+		localFrame = bufferSize - 1;
+
+	/* Keep changes sorted by frame: MIDI controls are scheduled before the
+	actions of the same block. Equal frames keep their arrival order. */
+
+	if (paramChangesCount == 0)
+		paramStack = plugins.load();
+
+	int i = paramChangesCount++;
+	for (; i > 0 && paramChanges[i-1].frame > localFrame; i--)
+		paramChanges[i] = paramChanges[i-1];
+	paramChanges[i] = { localFrame, recorder::getParamPlugin(key),
+		recorder::getParamIndex(key), value };
+}
+
+
+void Channel::clearParamChanges()
+{
+	paramChangesCount = 0;
 }
 
 #endif
@@ -30,11 +30,14 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
 #include <pthread.h>
+#include "const.h"
 #include "midiMapConf.h"
 #include "midiEvent.h"
 #include "recorder.h"
 #include "audioBuffer.h"
+#include "delayLine.h"
 
 #ifdef WITH_VST
 	#include "../deps/juce-config.h"
@@ -60,6 +63,18 @@ class Channel
 
 		giada::m::AudioBuffer vChan;
 
+		/* oChan
+		Private output buffer, filled by render() and summed to the destination by
+		mix(). Channels processed in parallel never write to a shared buffer. */
+
+		giada::m::AudioBuffer oChan;
+
+		/* delayComp
+		Delay applied to oChan by render(), to line this channel up with slower
+		ones. See mixer::routeAudio. */
+
+		giada::m::DelayLine delayComp;
+
 #ifdef WITH_VST
 
 		/* MidiBuffer contains MIDI events. When ready, events are sent to each plugin
@@ -82,6 +97,13 @@ class Channel
 		float volume_i;
 		float volume_d;
 
+		/* volume_r
+		Volume applied at the end of the previous block. output() ramps from here
+		to 'volume', so that fast changes (e.g. from a MIDI controller) don't
+		produce zipper noise. */
+
+		float volume_r;
+
 		/* boost
 		Additional volume boost */
 		float boost;
@@ -93,7 +115,7 @@ class Channel
 
 		/* sendMidiLMessage
 		Composes a MIDI message by merging bytes from MidiMap conf class, and sends it
-		to KernelMidi. */
+		to KernelMidi as a lighting message: unchanged LEDs are filtered out. */
 
 		void sendMidiLmessage(uint32_t learn, const giada::m::midimap::message_t& msg);
 
@@ -151,6 +173,23 @@ public:
 
 	virtual void output(giada::m::AudioBuffer& out);
 
+	/* render
+	Same as process(), but the output goes to the private buffer oChan. It only
+	touches the channel's own state, so different channels can render at the
+	same time on different threads. */
+
+	void render(giada::m::AudioBuffer& in);
+
+	/* mix
+	Sums the result of the last render() into 'out'. */
+
+	void mix(giada::m::AudioBuffer& out);
+
+	/* setDelayComp
+	Sets the output delay in frames, to compensate for latency elsewhere. */
+
+	void setDelayComp(int frames);
+
 	/* setMono
 	realloc buffers */
 	virtual void setMono(bool mono);
@@ -200,9 +239,10 @@ public:
 	void sendMidiLplay();
 
 	/* receiveMidi
-	Receives and processes midi messages from external devices. */
+	Receives and processes midi messages from external devices, at frame
+	'localFrame' of the current block. Audio thread only. */
 
-	virtual void receiveMidi(const giada::m::MidiEvent& midiEvent);
+	virtual void receiveMidi(const giada::m::MidiEvent& midiEvent, int localFrame);
 
 	/* setters */
 
@@ -210,6 +250,12 @@ public:
 	void setPan(float v);
 	void setVolume(float v);
 	void setBoost(float v);
+
+	/* resetVolume
+	Like setVolume(), with no ramp from the previous volume (see volume_r). For
+	volumes set outside the audio block: patch loading, the GUI. */
+
+	void resetVolume(float v);
 	void setMidiInFilter(int c);
 
 	/* getters */
@@ -284,14 +330,74 @@ public:
 	uint32_t	midiOutLsolo;
 
 #ifdef WITH_VST
-  std::vector <Plugin*> plugins;
+
+	/* plugins
+	Plug-in stack. Never changed in place: pluginHost publishes a new one on each
+	change (GUI thread only) and retires the old one. Other threads read it
+	within a reclaimer::Reader. */
+
+	std::atomic<std::vector<Plugin*>*> plugins;
+
+	/* getPlugins
+	Current plug-in stack. */
+
+	const std::vector<Plugin*>& getPlugins() const;
 
 	/* addVstMidiEvent
 	 * Add a new Midi event to the midiEvent stack fom a composite uint32_t raw
 	 * Midi event. LocalFrame is the offset: it tells where to put the event
-	 * inside the buffer. */
+	 * inside the buffer (clamped to the current block). Never allocates. */
 
 	void addVstMidiEvent(uint32_t msg, int localFrame);
+
+	/* ParamChange
+	A plug-in parameter change scheduled for the current block: 'plugin' is the
+	position in the stack, 'frame' the offset in the block. */
+
+	struct ParamChange
+	{
+		int   frame;
+		int   plugin;
+		int   param;
+		float value;
+	};
+
+	/* addParamChange
+	Schedules the change of parameter 'key' (see recorder::paramKey) at
+	'localFrame' of the current block, from actions or MIDI controls. Changes are
+	kept in frame order. Never allocates: changes past G_MAX_PARAM_CHANGES in a
+	block are dropped. */
+
+	void addParamChange(uint32_t key, float value, int localFrame);
+
+	/* clearParamChanges
+	Drops changes of the current block. Called once the stack has been
+	processed. */
+
+	void clearParamChanges();
+
+	/* paramChanges, paramChangesCount
+	Parameter changes scheduled for the current block, read by
+	pluginHost::processStack(). */
+
+	ParamChange paramChanges[G_MAX_PARAM_CHANGES];
+	int         paramChangesCount;
+
+	/* paramStack
+	The stack the positions in 'paramChanges' refer to, i.e. the one published
+	when the first change of the block came in. */
+
+	const std::vector<Plugin*>* paramStack;
+
+	/* pluginBuffer, instrumentBuffer, midiScratch, emptyMidiBuffer
+	Working buffers for pluginHost::processStack(), allocated along with vChan.
+	Each channel owns its set, so plug-in stacks of different channels can run
+	in parallel. */
+
+	juce::AudioBuffer<float> pluginBuffer;
+	juce::AudioBuffer<float> instrumentBuffer;
+	juce::MidiBuffer midiScratch;
+	juce::MidiBuffer emptyMidiBuffer;
 #endif
 
 };
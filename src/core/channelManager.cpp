@@ -41,6 +41,7 @@
 
 
 using std::string;
+using std::vector;
 
 
 namespace giada {
@@ -55,7 +56,7 @@ void writeActions_(int chanIndex, patch::channel_t& pch)
 		if (a->chan != chanIndex)
 			return;
 		pch.actions.push_back(patch::action_t {
-			a->type, a->frame, a->fValue, a->iValue
+			a->type, a->frame, a->tick, a->fValue, a->iValue
 		});
 	});
 }
@@ -72,6 +73,7 @@ void writePlugins_(const Channel* ch, patch::channel_t& pch)
 		patch::plugin_t pp;
 		pp.path   = p->getUniqueId();
 		pp.bypass = p->isBypassed();
+		pp.state  = p->getState();
 		for (int k=0; k<p->getNumParameters(); k++)
 			pp.params.push_back(p->getParameter(k));
 		for (uint32_t param : p->midiInParams)
@@ -90,42 +92,12 @@ void writePlugins_(const Channel* ch, patch::channel_t& pch)
 void readActions_(Channel* ch, const patch::channel_t& pch)
 {
 	for (const patch::action_t& ac : pch.actions) {
-		recorder::rec(ch->index, ac.type, ac.frame, ac.iValue, ac.fValue);
+		recorder::recTick(ch->index, ac.type, ac.tick, ac.iValue, ac.fValue);
 		ch->hasActions = true;
 	}
 }
 
 
-/* -------------------------------------------------------------------------- */
-
-
-void readPlugins_(Channel* ch, const patch::channel_t& pch)
-{
-#ifdef WITH_VST
-
-	for (const patch::plugin_t& ppl : pch.plugins) {
-		Plugin* plugin = pluginHost::addPlugin(ppl.path, &mixer::mutex_plugins, ch);
-		if (plugin == nullptr)
-			continue;
-
-		plugin->setBypass(ppl.bypass);
-		for (unsigned j=0; j<ppl.params.size(); j++)
-			plugin->setParameter(j, ppl.params.at(j));
-
-		/* Don't fill Channel::midiInParam if Patch::midiInParams are 0: it would
-		wipe out the current default 0x0 values. */
-
-		if (!ppl.midiInParams.empty()) {
-			plugin->midiInParams.clear();
-			for (uint32_t midiInParam : ppl.midiInParams)
-				plugin->midiInParams.push_back(midiInParam);
-		}
-	}
-
-#endif
-}
-
-
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
@@ -250,7 +222,7 @@ void readPatch(Channel* ch, int i)
 	ch->mute            = pch.mute;
 	//ch->mute_s          = pch.mute_s;
 	ch->solo            = pch.solo;
-	ch->volume          = pch.volume;
+	ch->resetVolume(pch.volume);
 	ch->pan             = pch.pan;
 	ch->midiIn          = pch.midiIn;
 	//ch->midiInKeyPress  = pch.midiInKeyPress;
@@ -266,7 +238,6 @@ void readPatch(Channel* ch, int i)
 	ch->midiOutLsolo    = pch.midiOutLsolo;
 
 	readActions_(ch, pch);
-	readPlugins_(ch, pch);
 }
 
 
@@ -285,9 +256,15 @@ void readPatch(SampleChannel* ch, const string& basePath, int i)
 	ch->midiInPitch       = pch.midiInPitch;
   ch->inputMonitor      = pch.inputMonitor;
 	ch->setBoost(pch.boost);
+}
+
+
+/* -------------------------------------------------------------------------- */
 
-  Wave* w = nullptr;
-  int res = waveManager::create(basePath + pch.samplePath, &w);
+
+void readWave(SampleChannel* ch, int i, Wave* w, int res)
+{
+	const patch::channel_t& pch = patch::channels.at(i);
 
 	if (res == G_RES_OK) {
 		ch->pushWave(w);
@@ -316,4 +293,42 @@ void readPatch(MidiChannel* ch, int i)
 	ch->midiOut     = pch.midiOut;
 	ch->midiOutChan = pch.midiOutChan;
 }
+
+
+/* -------------------------------------------------------------------------- */
+
+
+#ifdef WITH_VST
+
+pluginHost::StackRequest readPlugins(Channel* ch, int index)
+{
+	/* Each plug-in is set up before reaching its stack, possibly by another
+	thread: the setup reads the patch only. */
+
+	pluginHost::StackRequest r;
+	r.ch = ch;
+	for (const patch::plugin_t& ppl : patch::channels.at(index).plugins)
+		r.fids.push_back(ppl.path);
+
+	r.setup = [index] (Plugin* plugin, int i) {
+		const patch::plugin_t& ppl = patch::channels.at(index).plugins.at(i);
+
+		plugin->setBypass(ppl.bypass);
+		if (ppl.state.empty() || !plugin->setState(ppl.state))
+			for (unsigned j=0; j<ppl.params.size(); j++)
+				plugin->setParameter(j, ppl.params.at(j));
+
+		/* Don't fill Channel::midiInParam if Patch::midiInParams are 0: it would
+		wipe out the current default 0x0 values. */
+
+		if (!ppl.midiInParams.empty()) {
+			plugin->midiInParams.clear();
+			for (uint32_t midiInParam : ppl.midiInParams)
+				plugin->midiInParams.push_back(midiInParam);
+		}
+	};
+	return r;
+}
+
+#endif
 }}}; // giada::m::channelManager
@@ -30,11 +30,15 @@
 
 
 #include <string>
+#ifdef WITH_VST
+	#include "pluginHost.h"
+#endif
 
 
 class Channel;
 class SampleChannel;
 class MidiChannel;
+class Wave;
 
 
 namespace giada {
@@ -50,6 +54,23 @@ void writePatch(const MidiChannel* ch, bool isProject, int index);
 void readPatch(Channel* ch, int index);
 void readPatch(SampleChannel* ch, const std::string& basePath, int index);
 void readPatch(MidiChannel* ch, int index);
+
+/* readWave
+Second half of readPatch() for sample channels: applies the wave decoded from
+patch::channels[index].samplePath, or the error status if 'res' != G_RES_OK.
+Waves are decoded apart, see waveLoader. */
+
+void readWave(SampleChannel* ch, int index, Wave* w, int res);
+
+#ifdef WITH_VST
+
+/* readPlugins
+Plug-ins of patch::channels[index] for channel 'ch', to be created together
+with the ones of the other channels (see pluginHost::addPlugins). */
+
+pluginHost::StackRequest readPlugins(Channel* ch, int index);
+
+#endif
 }}}; // giada::m::channelManager
 
 
@@ -26,12 +26,16 @@
 
 
 #include <cassert>
-#include "../glue/transport.h"
-#include "../glue/main.h"
+#include <cmath>
+#include <algorithm>
+#include "../utils/log.h"
 #include "conf.h"
 #include "const.h"
+#include "commands.h"
 #include "kernelAudio.h"
 #include "kernelMidi.h"
+#include "queue.h"
+#include "pll.h"
 #include "clock.h"
 
 
@@ -65,6 +69,46 @@ int midiTChours   = 0;
 kernelAudio::JackState jackStatePrev;
 #endif
 
+/* SyncEvent
+A MIDI sync message, as received by the MIDI input thread. 'time' is the steady
+clock time of arrival, in nanoseconds. */
+
+struct SyncEvent
+{
+	int64_t time;
+	int     b1;
+	int     b2;
+	int     b3;
+};
+
+Queue<SyncEvent, G_MIDI_SYNC_QUEUE_SIZE> syncQueue;
+
+/* MIDI clock slave state. clockTicks counts clock ticks (24 per beat) from song
+position 0, -1 = before the first tick. clockStartPending is set by a Start
+message: the sequencer actually starts on the next tick. */
+
+Pll  clockPll(G_PLL_BANDWIDTH_CLOCK);
+int  clockTicks        = -1;
+bool clockStartPending = false;
+
+/* MTC slave state. mtcSeconds is the timecode position at the last quarter
+frame, valid once a complete timecode has been decoded. */
+
+Pll     mtcPll(G_PLL_BANDWIDTH_MTC);
+int     mtcNibbles[8];
+int     mtcPieces   = 0;      // bitmask of quarter frames received so far
+bool    mtcValid    = false;
+double  mtcSeconds  = 0.0;
+double  mtcFps      = 25.0;
+int64_t mtcLastTime = 0;
+
+/* syncSteps, syncInterval
+Frames to add (> 0) or drop (< 0) in the current block to stay in phase with
+the master, one every syncInterval frames. */
+
+int syncSteps    = 0;
+int syncInterval = 0;
+
 
 void updateQuanto()
 {
@@ -74,6 +118,142 @@ void updateQuanto()
 		quanto = framesInBeat * quantize;
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+
+double toSeconds(int64_t ns)
+{
+	return ns / 1000000000.0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void recvMIDIclock(const SyncEvent& e)
+{
+	switch (e.b1) {
+		case MIDI_START:
+			clockTicks        = -1;
+			clockStartPending = true;
+			break;
+		case MIDI_CONTINUE:
+			if (!running)
+				commands::push(commands::START_SEQ);
+			break;
+		case MIDI_STOP:
+			clockStartPending = false;
+			if (running)
+				commands::push(commands::STOP_SEQ);
+			break;
+		case MIDI_POSITION_PTR:        // in 16th notes, i.e. 6 ticks each
+			clockTicks = (((e.b3 << 7) | e.b2) * 6) - 1;
+			break;
+		case MIDI_CLOCK:
+			clockPll.update(toSeconds(e.time));
+			if (clockStartPending) {
+				clockStartPending = false;
+				clockTicks        = 0;
+				commands::push(commands::REWIND_SEQ);
+				commands::push(commands::START_SEQ);
+			}
+			else
+			if (running)
+				clockTicks++;
+			break;
+	}
+
+	if (e.b1 != MIDI_CLOCK || !clockPll.isLocked())
+		return;
+
+	/* Follow tempo in the same 0.1 BPM steps of the GUI. The threshold is a bit
+	larger than half a step, so that jitter can't make it bounce. */
+
+	float tempo = 60.0f / (clockPll.getPeriod() * 24.0f);
+	if (tempo >= G_MIN_BPM && tempo <= G_MAX_BPM &&
+	    std::fabs(tempo - bpm) > G_MIDI_SYNC_MIN_BPM_DIFF)
+		commands::push(commands::SET_BPM, -1, false, false, true,
+			roundf(tempo * 10.0f) / 10.0f);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void recvMIDItimecode(const SyncEvent& e)
+{
+	static const double rates[4] = { 24.0, 25.0, 29.97, 30.0 };
+
+	if (e.b1 != MIDI_MTC_QUARTER)
+		return;
+
+	int piece  = (e.b2 >> 4) & 0x07;
+	int nibble = e.b2 & 0x0F;
+
+	mtcPll.update(toSeconds(e.time));
+	mtcLastTime = e.time;
+	if (mtcValid)
+		mtcSeconds += 1.0 / (mtcFps * 4.0);
+
+	if (piece == 0)
+		mtcPieces = 0;
+	mtcNibbles[piece] = nibble;
+	mtcPieces |= 1 << piece;
+
+	if (piece != 7 || mtcPieces != 0xFF)
+		return;
+
+	/* A full timecode takes two frames to be transmitted: it refers to the
+	first quarter frame, so now it's 1.75 frames later. */
+
+	int frames  = mtcNibbles[0] | (mtcNibbles[1] << 4);
+	int seconds = mtcNibbles[2] | (mtcNibbles[3] << 4);
+	int minutes = mtcNibbles[4] | (mtcNibbles[5] << 4);
+	int hours   = mtcNibbles[6] | ((mtcNibbles[7] & 0x01) << 4);
+	mtcFps      = rates[(mtcNibbles[7] >> 1) & 0x03];
+	mtcSeconds  = (hours * 3600) + (minutes * 60) + seconds + ((frames + 1.75) / mtcFps);
+
+	if (!mtcValid) {
+		mtcValid = true;
+		if (!running)
+			commands::push(commands::START_SEQ);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* follow
+Compares the position the master will have when the current block is heard,
+in frames, with the current one. Small errors are spread over the block, large
+ones (the master has jumped) move the sequencer straight to the new position. */
+
+void follow(double target, int bufferSize)
+{
+	if (framesInLoop <= 0 || framesInBeat <= 0)
+		return;
+
+	target = std::fmod(target, framesInLoop);
+	double error = target - currentFrame;
+	if (error > framesInLoop / 2)
+		error -= framesInLoop;
+	else
+	if (error < -framesInLoop / 2)
+		error += framesInLoop;
+
+	if (std::fabs(error) > G_MIDI_SYNC_MAX_DRIFT * conf::samplerate) {
+		currentFrame = target;
+		currentBeat  = currentFrame / framesInBeat;
+		return;
+	}
+
+	int maxSteps = std::min(G_MIDI_SYNC_MAX_STEPS, bufferSize);
+	syncSteps    = std::max(-maxSteps, std::min(maxSteps, (int) std::round(error)));
+	syncInterval = syncSteps != 0 ? bufferSize / std::abs(syncSteps) : 0;
+}
+
 }; // {anonymous}
 
 
@@ -240,13 +420,11 @@ void updateFrameBars()
 /* -------------------------------------------------------------------------- */
 
 
-void sendMIDIsync()
+void sendMIDIsync(int localFrame)
 {
-	/* TODO - only Master (_M) is implemented so far. */
-
 	if (conf::midiSync == MIDI_SYNC_CLOCK_M) {
 		if (currentFrame % (framesInBeat/24) == 0)
-			kernelMidi::send(MIDI_CLOCK, -1, -1);
+			kernelMidi::sendAt(localFrame, MIDI_CLOCK, -1, -1);
 		return;
 	}
 
@@ -266,10 +444,10 @@ void sendMIDIsync()
 		 * seconds high nibble */
 
 		if (midiTCframes % 2 == 0) {
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCframes & 0x0F)  | 0x00, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCframes >> 4)    | 0x10, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCseconds & 0x0F) | 0x20, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCseconds >> 4)   | 0x30, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCframes & 0x0F)  | 0x00, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCframes >> 4)    | 0x10, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCseconds & 0x0F) | 0x20, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCseconds >> 4)   | 0x30, -1);
 		}
 
 		/* minutes low nibble
@@ -278,10 +456,10 @@ void sendMIDIsync()
 		 * hours high nibble SMPTE frame rate */
 
 		else {
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCminutes & 0x0F) | 0x40, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTCminutes >> 4)   | 0x50, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTChours & 0x0F)   | 0x60, -1);
-			kernelMidi::send(MIDI_MTC_QUARTER, (midiTChours >> 4)     | 0x70, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCminutes & 0x0F) | 0x40, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTCminutes >> 4)   | 0x50, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTChours & 0x0F)   | 0x60, -1);
+			kernelMidi::sendAt(localFrame, MIDI_MTC_QUARTER, (midiTChours >> 4)     | 0x70, -1);
 		}
 
 		midiTCframes++;
@@ -342,19 +520,19 @@ void recvJackSync()
 	if (jackState.running != jackStatePrev.running) {
 		if (jackState.running) {
 			if (!isRunning())
-				glue_startSeq(false); // not from UI
+				commands::push(commands::START_SEQ);
 		}
 		else {
 			if (isRunning())
-				glue_stopSeq(false); // not from UI
+				commands::push(commands::STOP_SEQ);
 		}
 	}
 	if (jackState.bpm != jackStatePrev.bpm)
 		if (jackState.bpm > 1.0f)  // 0 bpm if Jack does not send that info
-			glue_setBpm(jackState.bpm);
+			commands::push(commands::SET_BPM, -1, false, false, false, jackState.bpm);
 
 	if (jackState.frame == 0 && jackState.frame != jackStatePrev.frame)
-		glue_rewindSeq(false, false);  // not from UI, don't notify jack (avoid loop)
+		commands::push(commands::REWIND_SEQ);  // don't notify jack (avoid loop)
 
 	jackStatePrev = jackState;
 }
@@ -365,12 +543,101 @@ void recvJackSync()
 /* -------------------------------------------------------------------------- */
 
 
+void pushMIDIsync(int64_t time, int b1, int b2, int b3)
+{
+	if (conf::midiSync == MIDI_SYNC_CLOCK_S) {
+		if (b1 != MIDI_CLOCK && b1 != MIDI_START && b1 != MIDI_CONTINUE &&
+		    b1 != MIDI_STOP  && b1 != MIDI_POSITION_PTR)
+			return;
+	}
+	else
+	if (conf::midiSync == MIDI_SYNC_MTC_S) {
+		if (b1 != MIDI_MTC_QUARTER)
+			return;
+	}
+	else
+		return;
+
+	if (!syncQueue.push({ time, b1, b2, b3 }))
+		gu_log("[clock] MIDI sync queue full, message dropped!\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void recvMIDIsync(int bufferSize)
+{
+	syncSteps = 0;
+
+	SyncEvent e;
+	while (syncQueue.pop(e)) {
+		if (conf::midiSync == MIDI_SYNC_CLOCK_S)
+			recvMIDIclock(e);
+		else
+		if (conf::midiSync == MIDI_SYNC_MTC_S)
+			recvMIDItimecode(e);
+	}
+
+	double blockTime = toSeconds(kernelMidi::getBlockTime());
+
+	if (conf::midiSync == MIDI_SYNC_CLOCK_S) {
+		if (!running || clockTicks < 0 || !clockPll.isLocked())
+			return;
+		double ticks = clockTicks + std::min(std::max(clockPll.getPhase(blockTime), 0.0), 1.5);
+		follow(ticks * framesInBeat / 24.0, bufferSize);
+	}
+	else
+	if (conf::midiSync == MIDI_SYNC_MTC_S) {
+		if (!mtcValid)
+			return;
+		if (kernelMidi::getBlockTime() - mtcLastTime > G_MIDI_SYNC_TIMEOUT_NS) {
+			mtcValid  = false;
+			mtcPieces = 0;
+			if (running)
+				commands::push(commands::STOP_SEQ);
+			return;
+		}
+		if (!running || !mtcPll.isLocked())
+			return;
+		double quarters = std::min(std::max(mtcPll.getPhase(blockTime), 0.0), 1.5);
+		follow((mtcSeconds + quarters / (mtcFps * 4.0)) * conf::samplerate, bufferSize);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int getSyncSteps(int localFrame)
+{
+	if (syncSteps == 0 || localFrame % syncInterval != 0)
+		return 1;
+	if (syncSteps > 0) {
+		syncSteps--;
+		return 2;
+	}
+	syncSteps++;
+	return 0;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 int getCurrentFrame()
 {
 	return currentFrame;
 }
 
 
+int getFrameAt(int localFrame)
+{
+	int frame = currentFrame + localFrame;
+	return frame > framesInLoop ? frame - framesInLoop - 1 : frame;
+}
+
+
 int getFramesInLoop()
 {
 	return framesInLoop;
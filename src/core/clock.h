@@ -29,6 +29,9 @@
 #define G_CLOCK_H
 
 
+#include <cstdint>
+
+
 namespace giada {
 namespace m {
 namespace clock
@@ -36,9 +39,10 @@ namespace clock
 void init(int sampleRate, float midiTCfps);
 
 /* sendMIDIsync
-Generates MIDI sync output data. */
+Generates MIDI sync output data for frame 'localFrame' of the current audio
+block. */
 
-void sendMIDIsync();
+void sendMIDIsync(int localFrame);
 
 /* sendMIDIrewind
 Rewinds timecode to beat 0 and also send a MTC full frame to cue the slave. */
@@ -49,11 +53,39 @@ void sendMIDIrewind();
 void recvJackSync();
 #endif
 
+/* pushMIDIsync
+Feeds an incoming MIDI sync message (clock, start/stop, song position, MTC
+quarter frame) received at steady clock time 'time', in nanoseconds. Called by
+the MIDI input thread: the message is only queued. */
+
+void pushMIDIsync(int64_t time, int b1, int b2, int b3);
+
+/* recvMIDIsync
+Consumes queued MIDI sync messages when Giada is a MIDI clock or MTC slave:
+follows transport and tempo, then computes the phase correction to apply to
+the current block of 'bufferSize' frames. Called by the mixer at the
+beginning of each block. */
+
+void recvMIDIsync(int bufferSize);
+
+/* getSyncSteps
+How many times the sequencer should advance at frame 'localFrame' of the
+current block: 1 normally, 0 or 2 to catch up with an external MIDI master. */
+
+int getSyncSteps(int localFrame);
+
 float getBpm();
 int getBeats();
 int getBars();
 int getCurrentBeat();
 int getCurrentFrame();
+
+/* getFrameAt
+Returns the sequencer frame 'localFrame' frames after the current one, wrapped
+around the loop. Handy for events that belong to a given frame of the block
+about to be processed. */
+
+int getFrameAt(int localFrame);
 int getFramesInBar();
 int getFramesInBeat();
 int getFramesInLoop();
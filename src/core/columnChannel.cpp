@@ -42,6 +42,9 @@ using namespace giada::m;
 
 ColumnChannel::ColumnChannel(int bufferSize)
 	: Channel(G_CHANNEL_COLUMN, bufferSize, false),
+	skip(false),
+	resourcesOn(false),
+	rAlive(false),
 	inputChannel(nullptr),
 	outputIndex(-1)
 {
@@ -86,6 +89,11 @@ bool ColumnChannel::allocBuffers()
 		return false;
 	}
 
+	if (!inputDelay.alloc(G_MAX_DELAY_COMP, mono?1:2)) {
+		gu_log("[ColumnChannel::allocBuffers] unable to alloc memory for inputDelay!\n");
+		return false;
+	}
+
 	return true;
 }
 
@@ -117,27 +125,62 @@ void ColumnChannel::parseAction(giada::m::recorder::action* a, int localFrame, i
 
 /* -------------------------------------------------------------------------- */
 
-void ColumnChannel::process(giada::m::AudioBuffer& out, giada::m::AudioBuffer& in)
+bool ColumnChannel::prepare()
 {
-	if (mute) return;
+	skip        = mute;
+	resourcesOn = false;
+	rAlive      = false;
+	if (skip) return false;
 
-	assert(out.countFrames() == vChan.countFrames());
+	assert(oChan.countFrames() == vChan.countFrames());
 	// Ignore mixer input, receive only throught InputChannel
 
 	if (inputChannel != nullptr)
 		inputChannel->output(vChan);
 
-	bool rAlive = false;
-	if (!pre_mute) {
-		for (ResourceChannel* ch : resources) {
-			if (!rAlive)
-				if (ch->inputMonitor || ch->isPlaying() || ch->isRecording()) rAlive = true;
-			ch->process(rChan, vChan);
-			ch->preview(rChan);
+	if (pre_mute) return false;
+
+	for (ResourceChannel* ch : resources)
+		if (ch->inputMonitor || ch->isPlaying() || ch->isRecording()) {
+			rAlive = true;
+			break;
 		}
+
+	resourcesOn = true;
+	return true;
+}
+
+
+void ColumnChannel::renderResource(int index)
+{
+	if (resourcesOn)
+		resources[index]->render(vChan);
+}
+
+
+void ColumnChannel::gather()
+{
+	if (!resourcesOn) return;
+
+	for (ResourceChannel* ch : resources) {
+		ch->mix(rChan);
+		ch->preview(rChan);
 	}
+}
+
+void ColumnChannel::setInputDelayComp(int frames)
+{
+	inputDelay.setDelay(frames);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ColumnChannel::process(giada::m::AudioBuffer& out, giada::m::AudioBuffer& in)
+{
+	if (skip) return;
 
 	if (!inputMonitor) vChan.clear();
+	inputDelay.process(vChan);
 
 	if (rAlive) {
 		for (int i=0; i<vChan.countFrames(); i++) {
@@ -151,7 +194,7 @@ void ColumnChannel::process(giada::m::AudioBuffer& out, giada::m::AudioBuffer& i
 	pluginHost::processStack(vChan, this);
 #endif
 
-		output(out);
+	output(out);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -47,6 +47,20 @@ private:
 
 	giada::m::AudioBuffer rChan;
 
+	/* skip, resourcesOn, rAlive
+	Decisions taken by prepare() for the current block: column muted, resources
+	to be rendered, resources actually producing sound. */
+
+	bool skip;
+	bool resourcesOn;
+	bool rAlive;
+
+	/* inputDelay
+	Delay applied to the monitored input before it's mixed with the resources,
+	so that the two are aligned. */
+
+	giada::m::DelayLine inputDelay;
+
 public:
 
 	ColumnChannel(int bufferSize);
@@ -62,6 +76,34 @@ public:
 	void parseAction(giada::m::recorder::action* a, int localFrame, int globalFrame, bool mixerIsRunning) override;
 	void setMono(bool mono) override;
 
+	/* Processing happens in steps, so that resources and columns can be rendered
+	in parallel by the mixer:
+
+		prepare() -> renderResource() for each resource -> gather() -> process()
+
+	process() is the last one: it runs the column plug-in stack and outputs. */
+
+	/* prepare
+	Feeds vChan with the input channel. Returns false if resources must not be
+	rendered in this block. */
+
+	bool prepare();
+
+	/* renderResource
+	Renders resource 'index' into its own buffer, with vChan as input. Safe to
+	call in parallel for different resources. */
+
+	void renderResource(int index);
+
+	/* gather
+	Sums rendered resources and previews into rChan. */
+
+	void gather();
+
+	/* setInputDelayComp
+	Sets the delay of the monitored input, in frames. */
+
+	void setInputDelayComp(int frames);
 
 	/* */
 
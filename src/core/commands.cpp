@@ -0,0 +1,336 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#include <atomic>
+#include "../gui/dialogs/gd_mainWindow.h"
+#include "../gui/elems/mainWindow/mainTransport.h"
+#include "../gui/elems/mainWindow/mainTimer.h"
+#include "../gui/dialogs/pluginList.h"
+#include "../glue/io.h"
+#include "../glue/channel.h"
+#include "../utils/gui.h"
+#include "../utils/log.h"
+#include "const.h"
+#include "conf.h"
+#include "queue.h"
+#include "clock.h"
+#include "kernelAudio.h"
+#include "kernelMidi.h"
+#include "mixer.h"
+#include "mixerHandler.h"
+#include "midiDispatcher.h"
+#include "pluginHost.h"
+#include "recorder.h"
+#include "reclaimer.h"
+#include "resourceChannel.h"
+#include "columnChannel.h"
+#include "sampleChannel.h"
+#include "waveLoader.h"
+#include "commands.h"
+
+
+extern gdMainWindow* G_MainWin;
+
+
+namespace giada {
+namespace m {
+namespace commands
+{
+namespace
+{
+/* commandQueue, notificationQueue
+Any thread -> audio thread, and audio thread -> GUI. */
+
+Queue<Command, G_COMMAND_QUEUE_SIZE> commandQueue;
+Queue<int, G_COMMAND_QUEUE_SIZE>     notificationQueue;
+
+/* droppedCommands, droppedNotifications
+What didn't fit in the queues above. Reported by the GUI. */
+
+std::atomic<int> droppedCommands(0);
+std::atomic<int> droppedNotifications(0);
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* getChannel
+Same as mh::getResourceChannelByIndex(), without complaining if the channel is
+gone: a command may outlive its target. Requires mixer::mutex_chans. */
+
+ResourceChannel* getChannel(int index)
+{
+	for (ColumnChannel* cch : mixer::columnChannels)
+		for (ResourceChannel* ch : *cch)
+			if (ch->index == index)
+				return ch;
+	return nullptr;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void startSeq()
+{
+	if (clock::isRunning())
+		return;
+	clock::start();
+#ifdef __linux__
+	kernelAudio::jackStart();
+#endif
+	notify(SEQ_STARTED);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void stopSeq()
+{
+	mh::stopSequencer();
+#ifdef __linux__
+	kernelAudio::jackStop();
+#endif
+
+	/* What to do if we stop the sequencer and some action recs are active?
+	Deactivate the button and delete any 'rec on' status. Same for input recs:
+	one might stop the sequencer while an input rec is running. Stop recording
+	right away, the GUI wraps up the takes. */
+
+	if (recorder::active) {
+		recorder::active = false;
+		notify(ACTION_REC_STOPPED);
+	}
+	if (mixer::recording) {
+		mixer::recording = false;
+		notify(INPUT_REC_STOPPED);
+	}
+	notify(SEQ_STOPPED);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void rewindSeq(bool notifyJack)
+{
+	mh::rewindSequencer();
+
+	/* FIXME - potential desync when Quantizer is enabled from this point on.
+	Mixer would wait, while the following calls would be made regardless of its
+	state. */
+
+#ifdef __linux__
+	if (notifyJack)
+		kernelAudio::jackSetPosition(0);
+#endif
+	if (conf::midiSync == MIDI_SYNC_CLOCK_M)
+		kernelMidi::send(MIDI_POSITION_PTR, 0, 0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void setBpm(float bpm, bool notifyJack)
+{
+	/* Never change this stuff while recording audio. */
+
+	if (mixer::recording)
+		return;
+	clock::setBpm(bpm);
+#ifdef __linux__
+	if (notifyJack)
+		kernelAudio::jackSetBpm(clock::getBpm());
+#endif
+	notify(BPM_CHANGED);
+}
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+
+void push(int type, int chan, bool ctrl, bool shift, int iValue, float fValue)
+{
+	if (!commandQueue.push({ type, chan, ctrl, shift, iValue, fValue }))
+		droppedCommands++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void process()
+{
+	Command c;
+	while (commandQueue.pop(c)) {
+		if (c.chan != -1) {
+			pthread_mutex_lock(&mixer::mutex_chans);
+			ResourceChannel* ch = getChannel(c.chan);
+			if (ch != nullptr) {
+				switch (c.type) {
+					case KEY_PRESS:
+						giada::c::io::keyPress(ch, c.ctrl, c.shift, c.iValue); break;
+					case KEY_RELEASE:
+						giada::c::io::keyRelease(ch, c.ctrl, c.shift); break;
+					case KILL:
+						giada::c::channel::kill(ch); break;
+				}
+			}
+			pthread_mutex_unlock(&mixer::mutex_chans);
+			continue;
+		}
+		switch (c.type) {
+			case START_SEQ:
+				startSeq(); break;
+			case STOP_SEQ:
+				stopSeq(); break;
+			case REWIND_SEQ:
+				rewindSeq(c.iValue); break;
+			case SET_BPM:
+				setBpm(c.fValue, c.iValue); break;
+		}
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void notify(int type)
+{
+	if (!notificationQueue.push(type))
+		droppedNotifications++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void processNotifications()
+{
+#ifdef WITH_VST
+
+	/* Plug-ins created by the loader thread are published here. */
+
+	pluginHost::processInsertions();
+
+#endif
+
+	/* Nobody else runs the commands if the audio stream is not running. */
+
+	if (!kernelAudio::isRunning())
+		process();
+
+	/* Record actions captured elsewhere (e.g. plug-in parameter moves). Channels
+	get their action status updated when action recording stops. */
+
+	recorder::flushCaptured(&mixer::mutex_recs, [] (const recorder::action& a) {
+		Channel* ch = mh::getChannelByIndex(a.chan);
+		if (ch != nullptr)
+			ch->hasActions = true;
+	});
+
+	/* Free whatever the audio thread is done with. */
+
+	reclaimer::collect();
+
+	int dropped = kernelMidi::countDropped();
+	if (dropped > 0)
+		gu_log("[commands] MIDI output queue full, %d messages dropped!\n", dropped);
+	dropped = recorder::countDropped();
+	if (dropped > 0)
+		gu_log("[commands] capture queue full, %d actions dropped!\n", dropped);
+	dropped = droppedCommands.exchange(0);
+	if (dropped > 0)
+		gu_log("[commands] command queue full, %d commands dropped!\n", dropped);
+	dropped = droppedNotifications.exchange(0);
+	if (dropped > 0)
+		gu_log("[commands] notification queue full, %d notifications dropped!\n", dropped);
+
+	int n;
+	while (notificationQueue.pop(n)) {
+		switch (n) {
+			case SEQ_STARTED:
+				G_MainWin->mainTransport->updatePlay(1); break;
+			case SEQ_STOPPED:
+				G_MainWin->mainTransport->updatePlay(0); break;
+			case ACTION_REC_STOPPED:
+				G_MainWin->mainTransport->updateRecAction(0); break;
+			case INPUT_REC_STOPPED:
+
+				/* Closing takes touches waves and channel widgets: GUI's job. */
+
+				pthread_mutex_lock(&mixer::mutex_chans);
+				mh::stopInputRec();
+				pthread_mutex_unlock(&mixer::mutex_chans);
+				G_MainWin->mainTransport->updateRecInput(0);
+				G_MainWin->mainTimer->setLock(false);
+				break;
+			case BPM_CHANGED:
+
+				/* Rebuilding the frame cache of recorded actions allocates: it's up to
+				the GUI, not to the audio thread that changed the tempo. Until then
+				the audio thread places actions on the new tempo by itself, see
+				recorder::forEachActionAt(). */
+
+				recorder::updateClock(clock::getFramesInLoop(), clock::getBeats(),
+					&mixer::mutex_recs);
+				G_MainWin->mainTimer->setBpm(clock::getBpm());
+				gu_refreshActionEditor();
+				gu_log("[commands] Bpm changed to %f\n", clock::getBpm());
+				break;
+			case MIDI_CONTROLS_CHANGED:
+				midiDispatcher::refreshControls(); break;
+			case MIDI_BINDINGS_CHANGED:
+				midiDispatcher::rebuild(); break;
+			case WAVES_WANTED:
+				for (ColumnChannel* cch : mixer::columnChannels)
+					for (ResourceChannel* ch : *cch)
+						if (ch->type == G_CHANNEL_SAMPLE && static_cast<SampleChannel*>(ch)->wanted.exchange(false))
+							waveLoader::prioritize(ch->index);
+				break;
+#ifdef WITH_VST
+			case PLUGINS_CHANGED: {
+				midiDispatcher::rebuild();
+				gdPluginList* pl = static_cast<gdPluginList*>(gu_getSubwindow(G_MainWin, WID_FX_LIST));
+				if (pl != nullptr) {
+					pl->refreshList();
+					pl->redraw();
+				}
+				break;
+			}
+#endif
+		}
+	}
+}
+}}}; // giada::m::commands::
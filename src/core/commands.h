@@ -0,0 +1,110 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#ifndef G_COMMANDS_H
+#define G_COMMANDS_H
+
+
+namespace giada {
+namespace m {
+namespace commands
+{
+/* Command types
+Requests for the engine, from the GUI, MIDI input or the audio thread itself
+(external sync). Handlers only flip engine state: anything that allocates or
+touches the GUI is sent back with a notification. */
+
+enum
+{
+	KEY_PRESS = 0,  // iValue = velocity
+	KEY_RELEASE,
+	KILL,
+	START_SEQ,
+	STOP_SEQ,
+	REWIND_SEQ,     // iValue = notify JACK
+	SET_BPM         // fValue = bpm, iValue = notify JACK
+};
+
+/* Notification types
+Things happened in the engine the GUI must reflect. */
+
+enum
+{
+	SEQ_STARTED = 0,
+	SEQ_STOPPED,
+	ACTION_REC_STOPPED,
+	INPUT_REC_STOPPED,
+	BPM_CHANGED,
+	MIDI_CONTROLS_CHANGED,
+	MIDI_BINDINGS_CHANGED,  // a binding has been learned on the MIDI thread
+	PLUGINS_CHANGED,        // plug-ins added to a stack
+	WAVES_WANTED            // channels started before their wave was loaded
+};
+
+/* Command
+'chan' is the index of the target channel, i.e. Channel->index, or -1. The
+channel is looked up when the command runs: it might be gone by then. */
+
+struct Command
+{
+	int   type;
+	int   chan;
+	bool  ctrl;
+	bool  shift;
+	int   iValue;
+	float fValue;
+};
+
+/* push
+Queues a command for the engine. It will be executed by the audio thread at the
+beginning of the next block, so that engine state is never touched by two
+threads at once. Safe from any thread, never blocks. */
+
+void push(int type, int chan=-1, bool ctrl=false, bool shift=false,
+	int iValue=0, float fValue=0.0f);
+
+/* process
+Executes pending commands. Audio thread only, or whoever drains the queue while
+the audio stream is not running. */
+
+void process();
+
+/* notify
+Queues a notification for the GUI. Safe from any thread, never blocks. */
+
+void notify(int type);
+
+/* processNotifications
+Updates the GUI according to pending notifications. Called by the GUI refresh
+thread, with the FLTK lock held. */
+
+void processNotifications();
+}}}; // giada::m::commands::
+
+
+#endif
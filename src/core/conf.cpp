@@ -163,6 +163,7 @@ int  samplerate     = G_DEFAULT_SAMPLERATE;
 int  buffersize     = G_DEFAULT_BUFSIZE;
 int  delayComp      = G_DEFAULT_DELAYCOMP;
 bool limitOutput    = false;
+bool metronomeCue   = false;
 int  rsmpQuality    = 0;
 
 int    midiSystem  = 0;
@@ -191,6 +192,9 @@ bool chansStopOnSeqHalt    = false;
 bool treatRecsAsLoops      = false;
 bool resizeRecordings      = true;
 bool inputMonitorDefaultOn = false;
+bool compactActions        = false;
+bool lazyLoading           = false;
+bool lazySkipStart         = false;
 
 string pluginPath = "";
 string patchPath  = "";
@@ -261,11 +265,12 @@ int columnInputY = 0;
 
 #ifdef WITH_VST
 
-int pluginChooserX   = 0;
-int pluginChooserY   = 0;
-int pluginChooserW   = 640;
-int pluginChooserH   = 480;
-int pluginSortMethod = 0;
+int  pluginChooserX     = 0;
+int  pluginChooserY     = 0;
+int  pluginChooserW     = 640;
+int  pluginChooserH     = 480;
+int  pluginSortMethod   = 0;
+bool pluginScanIsolated = true;
 
 #endif
 
@@ -332,6 +337,7 @@ int read()
 	if (!storager::setInt(jRoot, CONF_KEY_BUFFER_SIZE, buffersize)) return 0;
 	if (!storager::setInt(jRoot, CONF_KEY_DELAY_COMPENSATION, delayComp)) return 0;
 	if (!storager::setBool(jRoot, CONF_KEY_LIMIT_OUTPUT, limitOutput)) return 0;
+	if (!storager::setBool(jRoot, CONF_KEY_METRONOME_CUE, metronomeCue)) return 0;
 	if (!storager::setInt(jRoot, CONF_KEY_RESAMPLE_QUALITY, rsmpQuality)) return 0;
 	if (!storager::setInt(jRoot, CONF_KEY_MIDI_SYSTEM, midiSystem)) return 0;
 	if (!storager::setInt(jRoot, CONF_KEY_MIDI_PORT_OUT, midiPortOut)) return 0;
@@ -357,6 +363,9 @@ int read()
 	if (!storager::setBool(jRoot, CONF_KEY_TREAT_RECS_AS_LOOPS, treatRecsAsLoops)) return 0;
 	if (!storager::setBool(jRoot, CONF_KEY_RESIZE_RECORDINGS, resizeRecordings)) return 0;
 	if (!storager::setBool(jRoot, CONF_KEY_INPUT_MONITOR_DEFAULT_ON, inputMonitorDefaultOn)) return 0;
+	if (!storager::setBool(jRoot, CONF_KEY_COMPACT_ACTIONS, compactActions)) return 0;
+	if (!storager::setBool(jRoot, CONF_KEY_LAZY_LOADING, lazyLoading)) return 0;
+	if (!storager::setBool(jRoot, CONF_KEY_LAZY_SKIP_START, lazySkipStart)) return 0;
 	if (!storager::setString(jRoot, CONF_KEY_PLUGINS_PATH, pluginPath)) return 0;
 	if (!storager::setString(jRoot, CONF_KEY_PATCHES_PATH, patchPath)) return 0;
 	if (!storager::setString(jRoot, CONF_KEY_SAMPLES_PATH, samplePath)) return 0;
@@ -411,6 +420,12 @@ int read()
 	if (!storager::setInt(jRoot, CONF_KEY_PLUGIN_CHOOSER_H, pluginChooserH)) return 0;
 	if (!storager::setInt(jRoot, CONF_KEY_PLUGIN_SORT_METHOD, pluginSortMethod)) return 0;
 
+	/* Added later: configuration files without it keep the default instead of
+	storager's 'false' for missing keys. */
+
+	if (json_object_get(jRoot, CONF_KEY_PLUGIN_SCAN_ISOLATED) != nullptr &&
+	    !storager::setBool(jRoot, CONF_KEY_PLUGIN_SCAN_ISOLATED, pluginScanIsolated)) return 0;
+
 #endif
 
 	json_decref(jRoot);
@@ -442,6 +457,7 @@ int write()
 	json_object_set_new(jRoot, CONF_KEY_BUFFER_SIZE,               json_integer(buffersize));
 	json_object_set_new(jRoot, CONF_KEY_DELAY_COMPENSATION,        json_integer(delayComp));
 	json_object_set_new(jRoot, CONF_KEY_LIMIT_OUTPUT,              json_boolean(limitOutput));
+	json_object_set_new(jRoot, CONF_KEY_METRONOME_CUE,             json_boolean(metronomeCue));
 	json_object_set_new(jRoot, CONF_KEY_RESAMPLE_QUALITY,          json_integer(rsmpQuality));
 	json_object_set_new(jRoot, CONF_KEY_MIDI_SYSTEM,               json_integer(midiSystem));
 	json_object_set_new(jRoot, CONF_KEY_MIDI_PORT_OUT,             json_integer(midiPortOut));
@@ -467,6 +483,9 @@ int write()
 	json_object_set_new(jRoot, CONF_KEY_TREAT_RECS_AS_LOOPS,       json_boolean(treatRecsAsLoops));
 	json_object_set_new(jRoot, CONF_KEY_RESIZE_RECORDINGS,         json_boolean(resizeRecordings));
 	json_object_set_new(jRoot, CONF_KEY_INPUT_MONITOR_DEFAULT_ON,  json_boolean(inputMonitorDefaultOn));
+	json_object_set_new(jRoot, CONF_KEY_COMPACT_ACTIONS,           json_boolean(compactActions));
+	json_object_set_new(jRoot, CONF_KEY_LAZY_LOADING,              json_boolean(lazyLoading));
+	json_object_set_new(jRoot, CONF_KEY_LAZY_SKIP_START,           json_boolean(lazySkipStart));
 	json_object_set_new(jRoot, CONF_KEY_PLUGINS_PATH,              json_string(pluginPath.c_str()));
 	json_object_set_new(jRoot, CONF_KEY_PATCHES_PATH,              json_string(patchPath.c_str()));
 	json_object_set_new(jRoot, CONF_KEY_SAMPLES_PATH,              json_string(samplePath.c_str()));
@@ -515,11 +534,12 @@ int write()
 
 #ifdef WITH_VST
 
-	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_X,   json_integer(pluginChooserX));
-	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_Y,   json_integer(pluginChooserY));
-	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_W,   json_integer(pluginChooserW));
-	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_H,   json_integer(pluginChooserH));
-	json_object_set_new(jRoot, CONF_KEY_PLUGIN_SORT_METHOD, json_integer(pluginSortMethod));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_X,     json_integer(pluginChooserX));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_Y,     json_integer(pluginChooserY));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_W,     json_integer(pluginChooserW));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_CHOOSER_H,     json_integer(pluginChooserH));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_SORT_METHOD,   json_integer(pluginSortMethod));
+	json_object_set_new(jRoot, CONF_KEY_PLUGIN_SCAN_ISOLATED, json_boolean(pluginScanIsolated));
 
 #endif
 
@@ -58,6 +58,7 @@ extern int  samplerate;
 extern int  buffersize;
 extern int  delayComp;
 extern bool limitOutput;
+extern bool metronomeCue;
 extern int  rsmpQuality;
 
 extern int  midiSystem;
@@ -86,6 +87,9 @@ extern bool chansStopOnSeqHalt;
 extern bool treatRecsAsLoops;
 extern bool resizeRecordings;
 extern bool inputMonitorDefaultOn;
+extern bool compactActions;
+extern bool lazyLoading;
+extern bool lazySkipStart;
 
 extern std::string pluginPath;
 extern std::string patchPath;
@@ -121,6 +125,7 @@ extern int columnInputX, columnInputY;
 
 extern int pluginChooserX, pluginChooserY, pluginChooserW, pluginChooserH;
 extern int pluginSortMethod;
+extern bool pluginScanIsolated;
 
 #endif
 }}}; // giada::m::conf::
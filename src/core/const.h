@@ -210,6 +210,16 @@
 
 
 
+/* -- command queues -------------------------------------------------------- */
+#define G_COMMAND_QUEUE_SIZE 256  // must be a power of two
+
+
+
+/* -- deferred reclamation -------------------------------------------------- */
+#define G_RECLAIMER_READERS 32  // threads that may read shared data at once
+
+
+
 /* -- preview modes --------------------------------------------------------- */
 #define G_PREVIEW_NONE   0x00
 #define G_PREVIEW_NORMAL 0x01
@@ -225,10 +235,13 @@
 #define G_ACTION_MUTEOFF		0x10 // 0001 0000
 #define G_ACTION_VOLUME     0x20 // 0010 0000
 #define G_ACTION_MIDI       0x40 // 0100 0000
+#define G_ACTION_PARAM      0x80 // 1000 0000
 
 #define G_ACTION_KEYS       0x03 // 0000 0011 any key
 #define G_ACTION_MUTES      0x24 // 0001 1000 any mute
 
+#define G_PPQ               960  // action resolution, ticks per beat
+
 #define G_RANGE_CHAR        0x01 // range for MIDI (0-127)
 #define G_RANGE_FLOAT       0x02 // range for volumes and VST params (0.0-1.0)
 
@@ -301,6 +314,101 @@
 
 
 
+/* -- MIDI input ------------------------------------------------------------ */
+#define G_MIDI_IN_QUEUE_SIZE  1024      // per device, must be a power of two
+#define G_MIDI_IN_BUFFER_SIZE 8192      // bytes, plug-in MIDI buffer per channel
+#define G_MIDI_CC_RAMP_STEPS  8         // plug-in parameter steps per block
+
+
+
+/* -- MIDI output ----------------------------------------------------------- */
+#define G_MIDI_OUT_QUEUE_SIZE 1024      // must be a power of two
+#define G_MIDI_SENDER_POLL_NS 1000000   // 1 ms
+#define G_MIDI_RESYNC_NS      50000000  // 50 ms
+#define G_MIDI_MAX_OUT_LATENCY 1000     // ms
+#define G_MIDI_PROBE_MSG       0x8F000000 // note off, channel 16, note 0
+#define G_MIDI_PROBE_COUNT     8
+#define G_MIDI_PROBE_TIMEOUT_NS 200000000 // 200 ms
+#define G_GUI_PROBE_POLL_RATE  0.1      // seconds between latency probe checks
+
+
+
+/* -- MIDI lighting --------------------------------------------------------- */
+#define G_MIDI_LIGHT_QUEUE_SIZE 1024    // must be a power of two
+#define G_MIDI_LIGHT_RATE       300     // messages per second, per device
+#define G_MIDI_LIGHT_BURST      32      // messages sent at once after a pause
+
+
+
+/* -- worker pool ----------------------------------------------------------- */
+#define G_MAX_WORKERS   8       // worker threads besides the audio one
+#define G_WORKER_SPIN   8192    // polls before an idle worker goes to sleep
+#define G_WORKER_PRIORITY 70  // SCHED_RR priority of worker threads
+
+
+
+/* -- plug-in scan ---------------------------------------------------------- */
+#define G_PLUGIN_CACHE_FILE     "pluginCache.xml"
+#define G_PLUGIN_PROBE_ARG      "--probe-plugin"
+#define G_PLUGIN_PROBE_TIMEOUT  20000   // ms before a hung probe is killed
+#define G_GUI_SCAN_POLL_RATE    0.1     // seconds between scan progress updates
+
+
+
+/* -- plug-in loading ------------------------------------------------------- */
+#define G_PLUGIN_INSERT_QUEUE_SIZE 256  // must be a power of two
+
+
+
+/* -- plug-in delay compensation -------------------------------------------- */
+#define G_MAX_DELAY_COMP        16384   // frames, longest compensation delay
+
+
+
+/* -- plug-in CPU accounting ------------------------------------------------ */
+#define G_PLUGIN_CPU_SMOOTHING  0.05f   // weight of each block in the average
+#define G_PLUGIN_CPU_PEAK_DECAY 0.999f  // peak multiplier on each block
+#define G_PLUGIN_METRICS_FILE   "pluginMetrics.json"
+#define G_GUI_PLUGIN_CPU_RATE   0.5     // seconds between CPU load updates
+
+
+
+/* -- plug-in sleep --------------------------------------------------------- */
+#define G_PLUGIN_SILENCE        0.00001f  // -100 dB
+#define G_PLUGIN_SLEEP_HOLD     2000      // ms of silence before sleeping
+
+
+
+/* -- plug-in automation ---------------------------------------------------- */
+#define G_MAX_PARAM_CHANGES          256   // per channel, per block
+#define G_ACTION_CAPTURE_QUEUE_SIZE  1024  // must be a power of two
+
+
+
+/* -- sample loading -------------------------------------------------------- */
+#define G_GUI_LOAD_POLL_RATE    0.05    // seconds between loading progress updates
+
+
+
+/* -- metronome ------------------------------------------------------------- */
+#define G_METRONOME_SAMPLERATE  44100   // rate of the built-in click tables
+#define G_METRONOME_VOICES      4       // clicks sounding at the same time
+
+
+
+/* -- MIDI sync (slave) ----------------------------------------------------- */
+#define G_MIDI_SYNC_QUEUE_SIZE   256        // must be a power of two
+#define G_MIDI_SYNC_TIMEOUT_NS   250000000  // 250 ms without MTC = stopped
+#define G_MIDI_SYNC_MAX_DRIFT    0.02       // seconds, relocate beyond this
+#define G_MIDI_SYNC_MAX_STEPS    16         // max frames corrected per block
+#define G_MIDI_SYNC_MIN_BPM_DIFF 0.1f
+#define G_PLL_BANDWIDTH_CLOCK    0.5        // Hz
+#define G_PLL_BANDWIDTH_MTC      0.2        // Hz
+#define G_PLL_MAX_ERROR          0.5        // periods, reset beyond this
+#define G_PLL_LOCK_EVENTS        24
+
+
+
 /* -- MIDI signals -------------------------------------------------------------
 All signals are set to channel 0 (where channels are considered). It's up to the
 caller to bitmask them with the proper channel number.
@@ -419,14 +527,17 @@ const int MIDI_CHANS[16] = {
 #define PATCH_KEY_CHANNEL_MIDI_OUT_CHAN        "midi_out_chan"
 #define PATCH_KEY_CHANNEL_PLUGINS              "plugins"
 #define PATCH_KEY_CHANNEL_ACTIONS              "actions"
+#define PATCH_KEY_CHANNEL_ACTIONS_PACKED       "actions_packed"
 #define PATCH_KEY_CHANNEL_ARMED                "armed"
 #define PATCH_KEY_ACTION_TYPE                  "type"
 #define PATCH_KEY_ACTION_FRAME                 "frame"
+#define PATCH_KEY_ACTION_TICK                  "tick"
 #define PATCH_KEY_ACTION_F_VALUE               "f_value"
 #define PATCH_KEY_ACTION_I_VALUE               "i_value"
 #define PATCH_KEY_PLUGIN_PATH                  "path"
 #define PATCH_KEY_PLUGIN_BYPASS                "bypass"
 #define PATCH_KEY_PLUGIN_PARAMS                "params"
+#define PATCH_KEY_PLUGIN_STATE                 "state"
 #define PATCH_KEY_PLUGIN_MIDI_IN_PARAMS        "midi_in_params"
 #define PATCH_KEY_COLUMN_INDEX                 "index"
 #define PATCH_KEY_COLUMN_WIDTH                 "width"
@@ -445,6 +556,7 @@ const int MIDI_CHANS[16] = {
 #define CONF_KEY_BUFFER_SIZE              "buffer_size"
 #define CONF_KEY_DELAY_COMPENSATION       "delay_compensation"
 #define CONF_KEY_LIMIT_OUTPUT             "limit_output"
+#define CONF_KEY_METRONOME_CUE            "metronome_cue"
 #define CONF_KEY_RESAMPLE_QUALITY         "resample_quality"
 #define CONF_KEY_MIDI_SYSTEM              "midi_system"
 #define CONF_KEY_MIDI_PORT_OUT            "midi_port_out"
@@ -470,6 +582,9 @@ const int MIDI_CHANS[16] = {
 #define CONF_KEY_TREAT_RECS_AS_LOOPS      "treat_recs_as_loops"
 #define CONF_KEY_RESIZE_RECORDINGS        "resize_recordings"
 #define CONF_KEY_INPUT_MONITOR_DEFAULT_ON "input_monitor_default_on"
+#define CONF_KEY_COMPACT_ACTIONS          "compact_actions"
+#define CONF_KEY_LAZY_LOADING             "lazy_loading"
+#define CONF_KEY_LAZY_SKIP_START          "lazy_skip_start"
 #define CONF_KEY_PLUGINS_PATH             "plugins_path"
 #define CONF_KEY_PATCHES_PATH             "patches_path"
 #define CONF_KEY_SAMPLES_PATH             "samples_path"
@@ -520,6 +635,7 @@ const int MIDI_CHANS[16] = {
 #define CONF_KEY_MIDI_INPUT_W             "midi_input_w"
 #define CONF_KEY_MIDI_INPUT_H             "midi_input_h"
 #define CONF_KEY_PLUGIN_SORT_METHOD       "plugin_sort_method"
+#define CONF_KEY_PLUGIN_SCAN_ISOLATED     "plugin_scan_isolated"
 
 /* JSON midimaps keys */
 
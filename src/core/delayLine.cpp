@@ -0,0 +1,102 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#include <algorithm>
+#include "delayLine.h"
+
+
+namespace giada {
+namespace m
+{
+DelayLine::DelayLine()
+	: m_write(0),
+	  m_delay(0)
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool DelayLine::alloc(int maxDelay, int channels)
+{
+	m_write = 0;
+	m_delay = 0;
+	return m_ring.alloc(maxDelay + 1, channels);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void DelayLine::setDelay(int frames)
+{
+	if (!m_ring.isAllocd())
+		return;
+	m_delay = std::max(0, std::min(frames, m_ring.countFrames() - 1));
+}
+
+
+int DelayLine::getDelay() const
+{
+	return m_delay;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void DelayLine::process(AudioBuffer& buf)
+{
+	if (!m_ring.isAllocd())
+		return;
+
+	int size     = m_ring.countFrames();
+	int channels = std::min(buf.countChannels(), m_ring.countChannels());
+	for (int i=0; i<buf.countFrames(); i++) {
+		int read = m_write - m_delay;
+		if (read < 0)
+			read += size;
+		for (int j=0; j<channels; j++) {
+			m_ring[m_write][j] = buf[i][j];
+			buf[i][j] = m_ring[read][j];
+		}
+		if (++m_write == size)
+			m_write = 0;
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void DelayLine::clear()
+{
+	m_ring.clear();
+}
+
+}} // giada::m::
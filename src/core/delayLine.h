@@ -0,0 +1,79 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#ifndef G_DELAY_LINE_H
+#define G_DELAY_LINE_H
+
+
+#include "audioBuffer.h"
+
+
+namespace giada {
+namespace m
+{
+/* DelayLine
+Fixed-capacity delay over a preallocated ring buffer. Changing the delay never
+allocates, so it can be done from the audio thread. */
+
+class DelayLine
+{
+public:
+
+	DelayLine();
+
+	/* alloc
+	Allocates room for delays up to 'maxDelay' frames of 'channels' channels. The
+	current delay is reset to 0. */
+
+	bool alloc(int maxDelay, int channels);
+
+	/* setDelay
+	Sets the delay in frames, clamped to [0, maxDelay]. */
+
+	void setDelay(int frames);
+	int  getDelay() const;
+
+	/* process
+	Delays 'buf' in place. Extra channels in 'buf', if any, are left untouched. */
+
+	void process(AudioBuffer& buf);
+
+	/* clear
+	Fills the line with silence. */
+
+	void clear();
+
+private:
+
+	AudioBuffer m_ring;
+	int         m_write;
+	int         m_delay;
+};
+
+}} // giada::m::
+
+#endif
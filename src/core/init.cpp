@@ -26,6 +26,7 @@
 
 
 #include <ctime>
+#include <thread>
 #ifdef __APPLE__
 	#include <pwd.h>
 #endif
@@ -49,8 +50,11 @@
 #include "pluginHost.h"
 #include "recorder.h"
 #include "midiMapConf.h"
+#include "midiDispatcher.h"
 #include "kernelMidi.h"
 #include "kernelAudio.h"
+#include "metronome.h"
+#include "workerPool.h"
 
 
 extern bool		 		   G_quit;
@@ -84,7 +88,15 @@ void init_prepareKernelAudio()
   kernelAudio::openDevice();
   clock::init(conf::samplerate, conf::midiTCfps);
 	mixer::init(clock::getFramesInLoop(), kernelAudio::getRealBufSize());
+	metronome::init(conf::samplerate, kernelAudio::getRealBufSize(),
+		kernelAudio::getOutChans() > G_OUT_CHANS);
 	recorder::init();
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats());
+
+	/* One worker per spare core: the audio thread renders channels too. */
+
+	int cores = std::thread::hardware_concurrency();
+	workerPool::init(cores > 1 ? cores - 1 : 0);
 
 #ifdef WITH_VST
 
@@ -109,6 +121,8 @@ void init_prepareKernelAudio()
 void init_prepareKernelMIDI()
 {
 	kernelMidi::setApi(conf::midiSystem);
+	kernelMidi::init();
+	midiDispatcher::rebuild();
 	//kernelMidi::openOutDevice(conf::midiPortOut);
 	//kernelMidi::openInDevice(conf::midiPortIn);
 }
@@ -195,13 +209,18 @@ void init_shutdown()
 		gu_log("[init] Mixer closed\n");
 	}
 
+	workerPool::close();
+	gu_log("[init] Worker pool closed\n");
+
+	kernelMidi::close();
+
 	recorder::clearAll();
 	gu_log("[init] Recorder cleaned up\n");
 
 #ifdef WITH_VST
 
-	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::inputChannels, &mixer::mutex_plugins);
-	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::columnChannels, &mixer::mutex_plugins);
+	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::inputChannels);
+	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::columnChannels);
 
   pluginHost::close();
 	gu_log("[init] PluginHost cleaned up\n");
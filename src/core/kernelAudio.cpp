@@ -51,6 +51,8 @@ bool     status       = false;
 unsigned numDevs      = 0;
 bool     inputEnabled = false;
 unsigned realBufsize  = 0; 		// reale bufsize from the soundcard
+unsigned latency      = 0;      // stream latency in frames
+int      outChans     = G_OUT_CHANS;
 int      api          = 0;
 
 #ifdef __linux__
@@ -80,6 +82,15 @@ bool getStatus()
 /* -------------------------------------------------------------------------- */
 
 
+bool isRunning()
+{
+	return rtSystem != nullptr && rtSystem->isStreamRunning();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 int openDevice()
 {
 	api = conf::soundSystem;
@@ -142,6 +153,17 @@ int openDevice()
 	outParams.nChannels    = G_OUT_CHANS;
 	outParams.firstChannel = conf::channelsOut;   // chan 0=0, 1=2, 2=4, ...
 
+	/* The metronome cue pair sits right after the main one. Fall back to the
+	main pair if the device doesn't have that many channels. */
+
+	if (conf::metronomeCue) {
+		if (getMaxOutChans(outParams.deviceId) >= (unsigned) conf::channelsOut + G_OUT_CHANS * 2)
+			outParams.nChannels = G_OUT_CHANS * 2;
+		else
+			gu_log("[KA] not enough output channels for the metronome cue, using main output\n");
+	}
+	outChans = outParams.nChannels;
+
 	/* inDevice can be disabled. */
 
 	if (conf::soundDeviceIn != -1) {
@@ -196,7 +218,8 @@ int startStream()
 {
 	try {
 		rtSystem->startStream();
-		gu_log("[KA] latency = %lu\n", rtSystem->getStreamLatency());
+		latency = rtSystem->getStreamLatency();
+		gu_log("[KA] latency = %u\n", latency);
 		return 1;
 	}
 	catch (RtAudioError &e) {
@@ -381,6 +404,21 @@ unsigned getRealBufSize()
 }
 
 
+int getOutChans()
+{
+	return outChans;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+unsigned getLatency()
+{
+	return latency;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 
@@ -62,6 +62,12 @@ int startStream();
 int stopStream();
 
 bool getStatus();
+
+/* isRunning
+True if the audio stream is running, i.e. the audio thread is being called. */
+
+bool isRunning();
+
 bool isProbed(unsigned dev);
 bool isDefaultIn(unsigned dev);
 bool isDefaultOut(unsigned dev);
@@ -71,6 +77,18 @@ unsigned getMaxInChans(int dev);
 unsigned getMaxOutChans(unsigned dev);
 unsigned getDuplexChans(unsigned dev);
 unsigned getRealBufSize();
+
+/* getOutChans
+Number of channels of the output stream: the main pair, plus the metronome cue
+pair if enabled and supported by the device. */
+
+int getOutChans();
+
+/* getLatency
+Returns the stream latency in frames, as reported by the audio API when the
+stream starts. */
+
+unsigned getLatency();
 unsigned countDevices();
 int getTotalFreqs(unsigned dev);
 int getFreq(unsigned dev, int i);
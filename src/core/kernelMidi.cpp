@@ -25,15 +25,26 @@
  * -------------------------------------------------------------------------- */
 
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 #include "const.h"
 #include "../utils/log.h"
+#include "conf.h"
+#include "queue.h"
+#include "reclaimer.h"
+#include "kernelAudio.h"
+#include "clock.h"
 #include "midiDispatcher.h"
 #include "midiMapConf.h"
+#include "midiDeviceHandler.h"
 #include "kernelMidi.h"
 
 
 using std::string;
 using std::vector;
+using namespace std::chrono;
 
 
 namespace giada {
@@ -44,14 +55,168 @@ namespace
 {
 bool status = false;
 int api = 0;
-RtMidiOut* midiOut = nullptr;
 //RtMidiIn*  midiIn  = nullptr;
 unsigned numOutPorts = 0;
 unsigned numInPorts  = 0;
 
+/* Message
+A MIDI message waiting in the output queue, for device 'device' (its index, see
+MidiDevice::getIndex(): the device might be gone when the message leaves).
+'time' is the steady clock time in nanoseconds the message must leave at; 0
+means as soon as possible. */
+
+struct Message
+{
+	unsigned char data[3];
+	int           size;
+	int64_t       time;
+	int           device;
+};
+
+/* outQueue, sender
+All outgoing messages go through outQueue: the sender thread pops them and
+talks to the MIDI driver, so that no blocking call happens in the audio
+callback. */
+
+Queue<Message, G_MIDI_OUT_QUEUE_SIZE> outQueue;
+
+/* dropped
+Messages lost because a queue was full. Counted rather than logged on the
+spot: senders include the audio thread. The GUI reports them. */
+
+std::atomic<int> dropped(0);
+
+/* lightQueue
+Lighting messages for controllers, waiting for the sender thread to merge them
+into the lighting cache of each device. */
+
+Queue<uint32_t, G_MIDI_LIGHT_QUEUE_SIZE> lightQueue;
+std::thread       sender;
+std::atomic<bool> senderRunning(false);
+
+/* streamOrigin, blockStart, blockTime
+Steady clock time of stream time 0, time the current audio block has been
+requested at and time its first frame will be heard at. All of them are touched
+by the audio thread only. */
+
+int64_t streamOrigin = 0;
+int64_t blockStart   = 0;
+int64_t blockTime    = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* enqueue
+Pushes a message of up to three bytes (-1 = unused) for device 'device' into the
+output queue. */
+
+void enqueue(int device, int64_t time, int b1, int b2, int b3)
+{
+	Message m;
+	m.size    = 1;
+	m.data[0] = b1;
+	if (b2 != -1) m.data[m.size++] = b2;
+	if (b3 != -1) m.data[m.size++] = b3;
+	m.time    = time;
+	m.device  = device;
+
+	if (!outQueue.push(m))
+		dropped++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* broadcast
+Queues a message for every device with an open output port. Timed messages
+leave earlier by the latency of each device, so that external gear sounds along
+with the audio stream. */
+
+void broadcast(int64_t time, int b1, int b2, int b3)
+{
+	reclaimer::Reader reader;
+	for (MidiDevice* device : mdh::getDevices()) {
+		if (!device->isOutOpen())
+			continue;
+		int64_t t = time == 0 ? 0 : time - device->getOutLatency() * 1000000LL;
+		enqueue(device->getIndex(), t, b1, b2, b3);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* senderLoop
+Body of the sender thread. Pending messages are kept sorted by time: the
+thread sends the ones due, then sleeps until the next deadline, but never
+longer than G_MIDI_SENDER_POLL_NS, so that new messages are picked up soon.
+Lighting messages go through the cache of each device, which sends changes
+only, at its own pace. */
+
+void senderLoop()
+{
+	vector<Message> pending;
+	pending.reserve(G_MIDI_OUT_QUEUE_SIZE);
+
+	while (senderRunning.load()) {
+
+		/* upper_bound keeps the arrival order of messages with the same time. */
+
+		Message m;
+		while (outQueue.pop(m))
+			pending.insert(std::upper_bound(pending.begin(), pending.end(), m,
+				[](const Message& a, const Message& b) { return a.time < b.time; }), m);
+
+		int64_t now  = getNow();
+		size_t  sent = 0;
+		{
+			reclaimer::Reader reader;
+			const vector<MidiDevice*>& devices = mdh::getDevices();
+			for (; sent < pending.size() && pending[sent].time <= now; sent++) {
+				MidiDevice* device = mdh::getDevice(devices, pending[sent].device);
+				if (device == nullptr)
+					continue;
+				vector<unsigned char> msg(pending[sent].data, pending[sent].data + pending[sent].size);
+				device->send(&msg);
+				//gu_log("[KM] send msg=(%X %X %X)\n", msg[0], msg[1], msg[2]);
+			}
+
+			uint32_t light;
+			while (lightQueue.pop(light))
+				for (MidiDevice* device : devices)
+					device->pushLight(light);
+			for (MidiDevice* device : devices)
+				device->flushLights(now);
+		}
+		pending.erase(pending.begin(), pending.begin() + sent);
+
+		int64_t wake = now + G_MIDI_SENDER_POLL_NS;
+		if (!pending.empty() && pending.front().time < wake)
+			wake = pending.front().time;
+		std::this_thread::sleep_until(steady_clock::time_point(nanoseconds(wake)));
+	}
+}
+
 
 static void callback(double t, std::vector<unsigned char>* msg, void* data)
 {
+	/* Driver deltas chain all messages together, sync ones included: stamp each
+	of them, even the ones thrown away below. */
+
+	MidiDevice* device = (MidiDevice*) data;
+	int64_t     time   = device->stamp(t, getNow());
+
+	/* System messages (clock, MTC and friends) go to the clock, for slave
+	sync. They are shorter than 3 bytes. */
+
+	if (msg->size() > 0 && msg->at(0) >= 0xF0) {
+		clock::pushMIDIsync(time, msg->at(0),
+			msg->size() > 1 ? msg->at(1) : -1, msg->size() > 2 ? msg->at(2) : -1);
+		return;
+	}
+
 	if (msg->size() < 3) {
 		//gu_log("[KM] MIDI received - unknown signal - size=%d, value=0x", (int) msg->size());
 		//for (unsigned i=0; i<msg->size(); i++)
@@ -59,7 +224,16 @@ static void callback(double t, std::vector<unsigned char>* msg, void* data)
 		//gu_log("\n");
 		return;
 	}
-	midiDispatcher::dispatch((MidiDevice*) data, msg->at(0), msg->at(1), msg->at(2));
+
+	/* Controls (learn, master, mute, volume, ...) are handled right away. Key
+	presses and notes for plug-ins must be sample accurate instead: they reach
+	the audio thread through the device queue. */
+
+	uint32_t value = getIValue(msg->at(0), msg->at(1), msg->at(2));
+	if (device->recvProbe(value, time))
+		return;
+	midiDispatcher::dispatch(device, msg->at(0), msg->at(1), msg->at(2));
+	device->pushEvent(value, time);
 }
 
 
@@ -233,17 +407,98 @@ bool hasAPI(int API)
 /* -------------------------------------------------------------------------- */
 
 
-void send(uint32_t data)
+void init()
 {
-	if (!status)
+	senderRunning.store(true);
+	sender = std::thread(senderLoop);
+	gu_log("[KM] MIDI sender thread started\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void close()
+{
+	if (!senderRunning.load())
 		return;
+	senderRunning.store(false);
+	sender.join();
+	gu_log("[KM] MIDI sender thread stopped\n");
+}
 
-	vector<unsigned char> msg(1, getB1(data));
-	msg.push_back(getB2(data));
-	msg.push_back(getB3(data));
 
-	midiOut->sendMessage(&msg);
-	gu_log("[KM] send msg=0x%X (%X %X %X)\n", data, msg[0], msg[1], msg[2]);
+/* -------------------------------------------------------------------------- */
+
+
+void beginBlock(double streamTime)
+{
+	/* The difference between wall clock and stream time jitters a bit, as the
+	callback is never woken up at the very same moment. Smooth it out, unless
+	it has moved too much (stream restarted, xrun): in that case start over. */
+
+	int64_t now    = getNow();
+	int64_t origin = now - (int64_t) (streamTime * 1e9);
+	int64_t drift  = origin - streamOrigin;
+	if (streamOrigin == 0 || drift > G_MIDI_RESYNC_NS || drift < -G_MIDI_RESYNC_NS)
+		streamOrigin = origin;
+	else
+		streamOrigin += drift / 16;
+
+	int64_t latency = (kernelAudio::getLatency() * 1000000000LL) / conf::samplerate;
+	blockStart = streamOrigin + (int64_t) (streamTime * 1e9);
+	blockTime  = blockStart + latency;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int64_t getBlockTime()
+{
+	return blockTime;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int getFrameOffset(int64_t time, int bufferSize)
+{
+	/* Messages received during the previous block period map linearly onto the
+	current block: input timing is preserved, with a constant delay of one
+	block. Late or early ones (backlog, clock jitter) are clamped. */
+
+	int64_t from   = blockStart - (bufferSize * 1000000000LL) / conf::samplerate;
+	int64_t offset = ((time - from) * conf::samplerate) / 1000000000LL;
+	return std::max((int64_t) 0, std::min((int64_t) bufferSize - 1, offset));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int countDropped()
+{
+	return dropped.exchange(0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int64_t getNow()
+{
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void send(uint32_t data)
+{
+	broadcast(0, getB1(data), getB2(data), getB3(data));
 }
 
 
@@ -252,18 +507,44 @@ void send(uint32_t data)
 
 void send(int b1, int b2, int b3)
 {
-	if (!status)
-		return;
+	broadcast(0, b1, b2, b3);
+}
+
 
-	vector<unsigned char> msg(1, b1);
+/* -------------------------------------------------------------------------- */
+
+
+void sendTo(const MidiDevice* device, int64_t time, int b1, int b2, int b3)
+{
+	enqueue(device->getIndex(), time, b1, b2, b3);
+}
+
+
+/* -------------------------------------------------------------------------- */
 
-	if (b2 != -1)
-		msg.push_back(b2);
-	if (b3 != -1)
-		msg.push_back(b3);
 
-	midiOut->sendMessage(&msg);
-	//gu_log("[KM] send msg=(%X %X %X)\n", b1, b2, b3);
+void sendLight(uint32_t data)
+{
+	if (!lightQueue.push(data))
+		dropped++;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void sendAt(int offset, uint32_t data)
+{
+	sendAt(offset, getB1(data), getB2(data), getB3(data));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void sendAt(int offset, int b1, int b2, int b3)
+{
+	broadcast(blockTime + (offset * 1000000000LL) / conf::samplerate, b1, b2, b3);
 }
 
 
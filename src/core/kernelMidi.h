@@ -58,8 +58,23 @@ channel. */
 
 uint32_t setChannel(uint32_t iValue, int channel);
 
+/* init, close
+Start and stop the sender thread, which delivers all outgoing messages to the
+MIDI driver. */
+
+void init();
+void close();
+
+/* getNow
+Returns the steady clock time in nanoseconds, the time base of all MIDI
+timestamps. */
+
+int64_t getNow();
+
 /* send
- * send a MIDI message 's' (uint32_t). */
+ * send a MIDI message 's' (uint32_t) to every device with an open output port.
+ * Messages are queued and leave as soon as possible from the sender thread:
+ * send() never blocks. */
 
 void send(uint32_t s);
 
@@ -68,6 +83,52 @@ void send(uint32_t s);
 
 void send(int b1, int b2=-1, int b3=-1);
 
+/* sendAt
+Same as send(), for messages generated in the audio callback: 'offset' is the
+frame of the current block the message belongs to. The sender thread emits it
+when that frame is actually heard, i.e. taking stream time and output latency
+into account, minus the output latency of each device. Audio thread only. */
+
+void sendAt(int offset, uint32_t s);
+void sendAt(int offset, int b1, int b2=-1, int b3=-1);
+
+/* sendTo
+Queues a message for device 'device' only, leaving at steady clock time 'time'
+(nanoseconds, 0 = as soon as possible), without latency compensation. */
+
+void sendTo(const MidiDevice* device, int64_t time, int b1, int b2=-1, int b3=-1);
+
+/* countDropped
+Returns the number of outgoing messages, lighting ones included, dropped
+because a queue was full, since the last call. */
+
+int countDropped();
+
+/* sendLight
+Queues a lighting message (LED feedback) for controllers. Each device sends
+only actual changes of its LEDs, rate limited. Any thread, never blocks. */
+
+void sendLight(uint32_t s);
+
+/* beginBlock
+Marks the beginning of a new audio block, given the stream time of its first
+frame. Called by the mixer on each callback. */
+
+void beginBlock(double streamTime);
+
+/* getBlockTime
+Returns the steady clock time, in nanoseconds, the first frame of the current
+audio block will be heard at. Audio thread only. */
+
+int64_t getBlockTime();
+
+/* getFrameOffset
+Returns the frame of the current audio block of size 'bufferSize' an incoming
+MIDI message received at steady clock time 'time' (nanoseconds) belongs to.
+Audio thread only. */
+
+int getFrameOffset(int64_t time, int bufferSize);
+
 /* setApi
  * set the Api in use for both in & out messages. */
 
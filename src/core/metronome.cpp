@@ -24,7 +24,11 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <cmath>
+#include <vector>
+#include <samplerate.h>
 #include "../utils/log.h"
+#include "const.h"
 #include "audioBuffer.h"
 #include "metronome.h"
 
@@ -368,35 +372,171 @@ namespace metronome
         0.050381,  0.048409,  0.028974,  0.008405
     });
 
-   bool   on = false;
-   float  vol = 1;
-   MetronomeWave wave = tigerWave;
-   int    output = 0;
-   bool   mono = false;
-   int    tickTracker, tockTracker = 0;
-   bool   tickPlay, tockPlay = false;
-
-   void render(AudioBuffer& outBuf, unsigned frame)
-   {
-     //gu_log("tick:%x, tock:%x\n", tickPlay, tockPlay);
-   	if (tockPlay) {
-   		for (int i=output; i<output+(mono?1:2) && i<outBuf.countChannels(); i++)
-   			outBuf[frame][i] += wave.tock[tockTracker] * vol;
-   		tockTracker++;
-   		if (tockTracker >= wave.size-1) {
-   			tockPlay    = false;
-   			tockTracker = 0;
-   		}
-   	}
-   	if (tickPlay) {
-   		for (int i=output; i<output+(mono?1:2) && i<outBuf.countChannels(); i++)
-   			outBuf[frame][i] += wave.tick[tickTracker] * vol;
-   		tickTracker++;
-   		if (tickTracker >= wave.size-1) {
-   			tickPlay    = false;
-   			tickTracker = 0;
-   		}
-   	}
-   }
+namespace
+{
+/* Click
+A click table resampled to the engine rate. */
+
+struct Click
+{
+	std::vector<float> tick;
+	std::vector<float> tock;
+};
+
+/* Voice
+A click being played. 'offset' is the first frame of the current block it
+sounds in, zero after the first block. */
+
+struct Voice
+{
+	const std::vector<float>* data;
+	int  pos;
+	int  offset;
+	bool bar;
+};
+
+Click clicks[2];  // one per MetronomeWave, indexed by id
+Voice voices[G_METRONOME_VOICES];
+
+/* mix
+Mono sum of the voices for the current block, before it is spread on the
+output pair. */
+
+std::vector<float> mix;
+
+bool mono = false;
+
+
+/* -------------------------------------------------------------------------- */
+
+
+std::vector<float> resample(const float* data, int size, int sampleRate)
+{
+	if (sampleRate == G_METRONOME_SAMPLERATE)
+		return std::vector<float>(data, data + size);
+
+	double ratio = sampleRate / (double) G_METRONOME_SAMPLERATE;
+	std::vector<float> out((int) std::ceil(size * ratio) + 1, 0.0f);
+
+	SRC_DATA src;
+	src.data_in       = data;
+	src.input_frames  = size;
+	src.data_out      = out.data();
+	src.output_frames = out.size();
+	src.src_ratio     = ratio;
+
+	int ret = src_simple(&src, SRC_SINC_MEDIUM_QUALITY, 1);
+	if (ret != 0) {
+		gu_log("[metronome::resample] unable to resample click: %s\n", src_strerror(ret));
+		return std::vector<float>(data, data + size);
+	}
+	out.resize(src.output_frames_gen);
+	return out;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void schedule(const std::vector<float>& data, int frame, bool bar)
+{
+	for (Voice& v : voices)
+		if (v.data == nullptr) {
+			v.data   = &data;
+			v.pos    = 0;
+			v.offset = frame;
+			v.bar    = bar;
+			return;
+		}
+}
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+
+bool  on = false;
+float vol = 1;
+MetronomeWave wave = tigerWave;
+int   output = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void init(int sampleRate, int bufferSize, bool cue)
+{
+	for (const MetronomeWave* w : {&defaultWave, &tigerWave}) {
+		clicks[w->id].tick = resample(w->tick, w->size, sampleRate);
+		clicks[w->id].tock = resample(w->tock, w->size, sampleRate);
+	}
+	for (Voice& v : voices)
+		v.data = nullptr;
+	mix.assign(bufferSize, 0.0f);
+	output = cue ? G_OUT_CHANS : 0;
+	gu_log("[metronome::init] clicks resampled to %d Hz, output %d\n", sampleRate, output);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void tick(int frame)
+{
+	schedule(clicks[wave.id].tick, frame, true);
+}
+
+
+void tock(int frame)
+{
+	for (const Voice& v : voices)
+		if (v.data != nullptr && v.bar)
+			return;
+	schedule(clicks[wave.id].tock, frame, false);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void render(AudioBuffer& outBuf)
+{
+	int  frames = std::min(outBuf.countFrames(), (int) mix.size());
+	bool active = false;
+
+	for (Voice& v : voices) {
+		if (v.data == nullptr)
+			continue;
+		if (!active) {
+			std::fill(mix.begin(), mix.begin() + frames, 0.0f);
+			active = true;
+		}
+
+		/* Contiguous mono add: the compiler turns it into SIMD. */
+
+		int n = std::max(0, std::min(frames - v.offset, (int) v.data->size() - v.pos));
+		const float* src = v.data->data() + v.pos;
+		float*       dst = mix.data() + v.offset;
+		for (int i=0; i<n; i++)
+			dst[i] += src[i];
+
+		v.pos   += n;
+		v.offset = 0;
+		if (v.pos >= (int) v.data->size())
+			v.data = nullptr;
+	}
+
+	if (!active)
+		return;
+
+	int last = std::min(output + (mono ? 1 : G_OUT_CHANS), outBuf.countChannels());
+	for (int i=0; i<frames; i++) {
+		float s = mix[i] * vol;
+		for (int j=output; j<last; j++)
+			outBuf[i][j] += s;
+	}
+}
 
 }}}; // giada::m::metronome::
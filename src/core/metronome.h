@@ -53,7 +53,24 @@ struct MetronomeWave {
   }
 };
 
-void render(AudioBuffer& outBuf, unsigned frame);
+/* init
+Resamples the click tables (G_METRONOME_SAMPLERATE) to the engine rate, once.
+'cue' sends the metronome to the output pair after the main one. Call it before
+the stream starts. */
+
+void init(int sampleRate, int bufferSize, bool cue);
+
+/* tick, tock
+Schedule a bar (tick) or beat (tock) click at 'frame' in the current block. A
+tock is skipped while a tick is sounding. */
+
+void tick(int frame);
+void tock(int frame);
+
+/* render
+Mixes the scheduled clicks into 'outBuf', one block at a time. */
+
+void render(AudioBuffer& outBuf);
 
 extern MetronomeWave defaultWave, tigerWave;
 
@@ -61,8 +78,6 @@ extern MetronomeWave wave;
 extern bool   on;
 extern float  vol;
 extern int    output;
-extern int    tickTracker, tockTracker;
-extern bool   tickPlay, tockPlay;
 
 }}} // giada::m::metronome::;
 
@@ -99,6 +99,11 @@ void MidiChannel::parseAction(recorder::action *a, int localFrame,
 {
 	if (a->type == G_ACTION_MIDI)
 		sendMidi(a, localFrame);
+#ifdef WITH_VST
+	else
+	if (a->type == G_ACTION_PARAM)
+		addParamChange(a->iValue, a->fValue, localFrame);
+#endif
 }
 
 
@@ -144,7 +149,13 @@ void MidiChannel::unsetMute(bool internal)
 }
 
 void MidiChannel::process(giada::m::AudioBuffer& out, giada::m::AudioBuffer& in) {
+#ifdef WITH_VST
+	/* No plug-in processing on MIDI channels yet: drop this block's events and
+	parameter changes, so that the preallocated MIDI buffer never grows. */
 
+	clearMidiBuffer();
+	clearParamChanges();
+#endif
 }
 
 /* -------------------------------------------------------------------------- */
@@ -221,7 +232,7 @@ void MidiChannel::sendMidi(recorder::action* a, int localFrame)
 {
 	if (status & (STATUS_PLAY | STATUS_ENDING) && !mute) {
 		if (midiOut)
-			kernelMidi::send(a->iValue | MIDI_CHANS[midiOutChan]);
+			kernelMidi::sendAt(localFrame, a->iValue | MIDI_CHANS[midiOutChan]);
 
 #ifdef WITH_VST
 		addVstMidiEvent(a->iValue, localFrame);
@@ -268,7 +279,7 @@ void MidiChannel::writePatch(bool isProject)
 /* -------------------------------------------------------------------------- */
 
 
-void MidiChannel::receiveMidi(const MidiEvent& midiEvent)
+void MidiChannel::receiveMidi(const MidiEvent& midiEvent, int localFrame)
 {
 	if (!armed)
 		return;
@@ -282,19 +293,12 @@ void MidiChannel::receiveMidi(const MidiEvent& midiEvent)
 
 #ifdef WITH_VST
 
-	while (true) {
-		if (pthread_mutex_trylock(&pluginHost::mutex_midi) != 0)
-			continue;
-		gu_log("[Channel::processMidi] msg=%X\n", midiEventFlat.getRaw());
-		addVstMidiEvent(midiEventFlat.getRaw(), 0);
-		pthread_mutex_unlock(&pluginHost::mutex_midi);
-		break;
-	}
+	addVstMidiEvent(midiEventFlat.getRaw(), localFrame);
 
 #endif
 
 	if (recorder::canRec(this, clock::isRunning(), mixer::recording)) {
-		recorder::rec(index, G_ACTION_MIDI, clock::getCurrentFrame(), midiEventFlat.getRaw());
+		recorder::capture(index, G_ACTION_MIDI, clock::getFrameAt(localFrame), midiEventFlat.getRaw());
 		hasActions = true;
 	}
 }
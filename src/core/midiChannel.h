@@ -56,7 +56,7 @@ public:
 	void setMute(bool internal) override;
 	void unsetMute(bool internal) override;
 	void parseAction(giada::m::recorder::action* a, int localFrame, int globalFrame, bool mixerIsRunning) override;
-	void receiveMidi(const giada::m::MidiEvent& midiEvent) override;
+	void receiveMidi(const giada::m::MidiEvent& midiEvent, int localFrame) override;
 
 	/* [ResourceChannel] inheritance */
 	void preview(giada::m::AudioBuffer& out) override;
@@ -24,6 +24,9 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include "../utils/log.h"
 #include "const.h"
 #include "kernelMidi.h"
@@ -45,7 +48,17 @@ namespace m
 			m_midiIn			(nullptr),
 			m_midiOut			(nullptr),
 			m_statusIn		(false),
-			m_statusOut		(false)
+			m_statusOut		(false),
+			m_outLatency	(0),
+			m_probeTime		(0),
+			m_probeTrip		(-1),
+			m_probeDone		(false),
+			m_probeAbort	(false),
+			m_probeResult	(-1),
+			m_lightTokens	(G_MIDI_LIGHT_BURST),
+			m_lightTime		(0),
+			m_lightReset	(false),
+			m_inTime			(0)
 	{
 		/* Create MIDI Input */
 
@@ -55,6 +68,23 @@ namespace m
 	}
 /* -------------------------------------------------------------------------- */
 
+MidiDevice::~MidiDevice()
+{
+	m_probeAbort.store(true);
+	if (m_probeThread.joinable())
+		m_probeThread.join();
+	if (m_midiIn != nullptr) {
+		if (m_statusIn)
+			kernelMidi::closeInPort(m_midiIn);
+		delete m_midiIn;
+	}
+	if (m_midiOut != nullptr) {
+		if (m_statusOut)
+			kernelMidi::closeOutPort(m_midiOut);
+		delete m_midiOut;
+	}
+}
+
 /* -------------------------------------------------------------------------- */
 
 int MidiDevice::getIndex() const
@@ -79,6 +109,14 @@ bool MidiDevice::getNoNoteOff() const
 {
 	return m_noNoteOff;
 }
+bool MidiDevice::isOutOpen() const
+{
+	return m_statusOut.load();
+}
+int MidiDevice::getOutLatency() const
+{
+	return m_outLatency.load();
+}
 
 void MidiDevice::setName(string name)
 {
@@ -87,16 +125,20 @@ void MidiDevice::setName(string name)
 
 void MidiDevice::setPortIn(int port)
 {
+	m_statusIn.store(false);
 	kernelMidi::closeInPort(m_midiIn);
 	m_portIn = port;
-	kernelMidi::openInPort(m_midiIn, port, this);
+	m_statusIn.store(kernelMidi::openInPort(m_midiIn, port, this) == 1);
 }
 
 void MidiDevice::setPortOut(int port)
 {
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	m_statusOut.store(false);
 	kernelMidi::closeOutPort(m_midiOut);
 	m_portOut = port;
-	kernelMidi::openOutPort(m_midiOut, port);
+	m_statusOut.store(kernelMidi::openOutPort(m_midiOut, port) == 1);
+	m_lightReset.store(true);
 }
 
 void MidiDevice::setNoNoteOff(bool no)
@@ -104,6 +146,11 @@ void MidiDevice::setNoNoteOff(bool no)
 	m_noNoteOff = no;
 }
 
+void MidiDevice::setOutLatency(int ms)
+{
+	m_outLatency.store(std::max(0, std::min(G_MIDI_MAX_OUT_LATENCY, ms)));
+}
+
 unsigned MidiDevice::getInPortCount()
 {
 		return m_midiIn->getPortCount();
@@ -111,6 +158,7 @@ unsigned MidiDevice::getInPortCount()
 
 unsigned MidiDevice::getOutPortCount()
 {
+		std::lock_guard<std::mutex> lock(m_outMutex);
 		return m_midiOut->getPortCount();
 }
 
@@ -122,8 +170,201 @@ string MidiDevice::getInPortName(unsigned p)
 
 string MidiDevice::getOutPortName(unsigned p)
 {
+	std::lock_guard<std::mutex> lock(m_outMutex);
 	try { return m_midiOut->getPortName(p); }
 	catch (RtMidiError &error) { return ""; }
 }
 
+/* -------------------------------------------------------------------------- */
+
+int64_t MidiDevice::stamp(double delta, int64_t now)
+{
+	/* Driver deltas are more precise than the time this callback is woken up at,
+	so use them to chain messages together. Fall back to the wall clock on the
+	first message, or when the two disagree too much (driver hiccups). */
+
+	int64_t time = m_inTime + (int64_t) (delta * 1e9);
+	if (m_inTime == 0 || time > now || now - time > G_MIDI_RESYNC_NS)
+		time = now;
+	m_inTime = time;
+	return time;
+}
+
+void MidiDevice::pushEvent(uint32_t msg, int64_t time)
+{
+	if (!m_inQueue.push({ msg, time }))
+		gu_log("[MidiDevice] input queue full, message dropped!\n");
+}
+
+bool MidiDevice::popEvent(Event& e)
+{
+	return m_inQueue.pop(e);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MidiDevice::send(std::vector<unsigned char>* msg)
+{
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	if (!m_statusOut.load())
+		return;
+	try { m_midiOut->sendMessage(msg); }
+	catch (RtMidiError &error) {
+		gu_log("[MidiDevice] unable to send message: %s\n", error.getMessage().c_str());
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MidiDevice::startLatencyProbe()
+{
+	if (m_probeThread.joinable() && !m_probeDone.load())
+		return false;
+	if (!m_statusIn.load() || !m_statusOut.load()) {
+		gu_log("[MidiDevice] latency probe needs both ports open\n");
+		return false;
+	}
+	if (m_probeThread.joinable())  // Done, but never finished
+		m_probeThread.join();
+
+	m_probeDone.store(false);
+	m_probeAbort.store(false);
+	m_probeThread = std::thread([this] {
+		m_probeResult = measureOutLatency();
+		m_probeDone.store(true);
+	});
+	return true;
+}
+
+
+bool MidiDevice::isLatencyProbeDone() const
+{
+	return m_probeDone.load();
+}
+
+
+int MidiDevice::finishLatencyProbe()
+{
+	if (m_probeThread.joinable())
+		m_probeThread.join();
+	m_probeDone.store(false);
+	return m_probeResult;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MidiDevice::measureOutLatency()
+{
+	std::vector<int64_t> trips;
+	for (int i=0; i<G_MIDI_PROBE_COUNT && !m_probeAbort.load(); i++) {
+
+		/* A small delay lets the sender thread wake up right on time, so the probe
+		really leaves at 'time'. */
+
+		int64_t time = kernelMidi::getNow() + 2 * G_MIDI_SENDER_POLL_NS;
+		m_probeTrip.store(-1);
+		m_probeTime.store(time);
+		kernelMidi::sendTo(this, time, kernelMidi::getB1(G_MIDI_PROBE_MSG),
+			kernelMidi::getB2(G_MIDI_PROBE_MSG), kernelMidi::getB3(G_MIDI_PROBE_MSG));
+
+		while (m_probeTrip.load() == -1 && !m_probeAbort.load() &&
+		       kernelMidi::getNow() - time < G_MIDI_PROBE_TIMEOUT_NS)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		m_probeTime.store(0);
+		if (m_probeTrip.load() != -1)
+			trips.push_back(m_probeTrip.load());
+	}
+
+	if (trips.empty()) {
+		gu_log("[MidiDevice] no latency probe came back, is the loopback connected?\n");
+		return -1;
+	}
+
+	/* Median is robust against the odd late message. Half of the round trip:
+	the loopback is assumed symmetric. */
+
+	std::sort(trips.begin(), trips.end());
+	int ms = trips[trips.size() / 2] / 2000000LL;
+	setOutLatency(ms);
+	gu_log("[MidiDevice] output latency measured: %d ms (%d/%d probes)\n", ms,
+		(int) trips.size(), G_MIDI_PROBE_COUNT);
+	return getOutLatency();
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MidiDevice::recvProbe(uint32_t msg, int64_t now)
+{
+	int64_t time = m_probeTime.load();
+	if (time == 0 || msg != G_MIDI_PROBE_MSG)
+		return false;
+	if (now >= time)  // Arrived before leaving: late probe from a previous round
+		m_probeTrip.store(now - time);
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t MidiDevice::getLightKey(uint32_t msg)
+{
+	uint32_t type = msg & 0xF0000000;
+	if (type == 0x80000000)
+		type = 0x90000000;
+	return type | (msg & 0x0FFF0000);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MidiDevice::pushLight(uint32_t msg)
+{
+	uint32_t key = getLightKey(msg);
+	m_lightWanted[key] = msg;
+
+	auto sent = m_lightSent.find(key);
+	if (sent != m_lightSent.end() && sent->second == msg)
+		return;
+	if (std::find(m_lightDirty.begin(), m_lightDirty.end(), key) == m_lightDirty.end())
+		m_lightDirty.push_back(key);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MidiDevice::flushLights(int64_t now)
+{
+	if (m_lightReset.exchange(false)) {
+		m_lightSent.clear();
+		m_lightDirty.clear();
+		for (const auto& kv : m_lightWanted)
+			m_lightDirty.push_back(kv.first);
+	}
+
+	if (!m_statusOut || m_lightDirty.empty()) {
+		m_lightTime = now;
+		return;
+	}
+
+	/* Token bucket: G_MIDI_LIGHT_RATE tokens per second, up to
+	G_MIDI_LIGHT_BURST. One token per message. */
+
+	m_lightTokens += (now - m_lightTime) * (G_MIDI_LIGHT_RATE / 1e9);
+	m_lightTokens  = std::min(m_lightTokens, (double) G_MIDI_LIGHT_BURST);
+	m_lightTime    = now;
+
+	size_t done = 0;
+	for (; done < m_lightDirty.size() && m_lightTokens >= 1.0; done++) {
+		uint32_t key = m_lightDirty[done];
+		uint32_t msg = m_lightWanted[key];
+		auto sent = m_lightSent.find(key);
+		if (sent != m_lightSent.end() && sent->second == msg)  // Changed back meanwhile
+			continue;
+		std::vector<unsigned char> raw = { (unsigned char) kernelMidi::getB1(msg),
+			(unsigned char) kernelMidi::getB2(msg), (unsigned char) kernelMidi::getB3(msg) };
+		send(&raw);
+		m_lightSent[key] = msg;
+		m_lightTokens -= 1.0;
+	}
+	m_lightDirty.erase(m_lightDirty.begin(), m_lightDirty.begin() + done);
+}
+
 }} // giada::m::
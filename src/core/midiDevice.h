@@ -36,6 +36,14 @@
 
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include "const.h"
+#include "queue.h"
 using std::string;
 
 namespace giada {
@@ -45,18 +53,36 @@ class MidiDevice
 {
 public:
 
+	/* Event
+	An incoming MIDI message waiting for the audio thread. 'time' is the steady
+	clock time it was received at, in nanoseconds. */
+
+	struct Event
+	{
+		uint32_t msg;
+		int64_t  time;
+	};
+
 	MidiDevice(int index);
+	~MidiDevice();
 
 	int getIndex() const;
 	string getName() const;
 	int getPortIn() const;
 	int getPortOut() const;
 	bool getNoNoteOff() const;
+	bool isOutOpen() const;
+
+	/* getOutLatency
+	Output latency in milliseconds: timed messages leave this much earlier. */
+
+	int getOutLatency() const;
 
 	void setName(string name);
 	void setPortIn(int port);
 	void setPortOut(int port);
 	void setNoNoteOff(bool no);
+	void setOutLatency(int ms);
 
 	unsigned getInPortCount();
 	unsigned getOutPortCount();
@@ -64,8 +90,87 @@ public:
 	string getInPortName(unsigned p);
 	string getOutPortName(unsigned p);
 
+	/* stamp
+	Returns the steady clock time in nanoseconds the message just received was
+	sent at. 'delta' is the time elapsed since the previous message of any kind
+	according to the MIDI driver, 'now' the current steady clock time: every
+	incoming message must go through here, in order. MIDI input thread of this
+	device only. */
+
+	int64_t stamp(double delta, int64_t now);
+
+	/* pushEvent
+	Queues message 'msg', received at 'time' (see stamp()), for the audio thread.
+	MIDI input thread of this device only. */
+
+	void pushEvent(uint32_t msg, int64_t time);
+
+	/* popEvent
+	Takes the oldest queued message, if any. Audio thread only. */
+
+	bool popEvent(Event& e);
+
+	/* send
+	Sends a message right away, if the output port is open. Called by the
+	kernelMidi sender thread only. */
+
+	void send(std::vector<unsigned char>* msg);
+
+	/* startLatencyProbe
+	Starts measuring output latency in a background thread, through a loopback:
+	output port connected back to the input port of this device. Returns false if
+	a probe is already running or a port is closed. */
+
+	bool startLatencyProbe();
+
+	/* isLatencyProbeDone
+	True when the background probe has completed and its result is waiting for
+	finishLatencyProbe(). */
+
+	bool isLatencyProbeDone() const;
+
+	/* finishLatencyProbe
+	Waits for the background probe. Returns the new latency in milliseconds, or
+	-1 if no probe came back. */
+
+	int finishLatencyProbe();
+
+	/* recvProbe
+	Tells whether incoming message 'msg', received at steady clock time 'now', is
+	a probe sent by measureOutLatency() (and records its round trip). MIDI input
+	thread only. */
+
+	bool recvProbe(uint32_t msg, int64_t now);
+
+	/* pushLight
+	Records the wanted state of an LED, as lighting message 'msg'. Sender thread
+	only. */
+
+	void pushLight(uint32_t msg);
+
+	/* flushLights
+	Sends LEDs whose wanted state differs from the last one sent, oldest change
+	first, no faster than G_MIDI_LIGHT_RATE messages per second. 'now' is the
+	steady clock time in nanoseconds. Sender thread only. */
+
+	void flushLights(int64_t now);
+
 private:
 
+	/* getLightKey
+	Identifies the LED a lighting message is for: type, channel and note or
+	controller number. Note on and note off address the same LED. */
+
+	static uint32_t getLightKey(uint32_t msg);
+
+	/* measureOutLatency
+	Body of the probe thread. Sends G_MIDI_PROBE_COUNT probe messages, takes the
+	median round trip and sets half of it as output latency. Takes up to
+	G_MIDI_PROBE_COUNT * G_MIDI_PROBE_TIMEOUT_NS, less if aborted. */
+
+	int measureOutLatency();
+
+
 	void callback(double t, std::vector<unsigned char>* msg, void* data);
 
 	int		 m_index;
@@ -79,8 +184,53 @@ private:
 	RtMidiIn*  m_midiIn;
 	RtMidiOut* m_midiOut;
 
-	bool m_statusIn;
-	bool m_statusOut;
+	/* m_outMutex
+	Guards m_midiOut: the GUI reopens it while the sender thread sends. */
+
+	std::mutex m_outMutex;
+
+	std::atomic<bool> m_statusIn;
+	std::atomic<bool> m_statusOut;
+
+	/* m_outLatency
+	Output latency, in milliseconds. Atomic: read by the audio thread. */
+
+	std::atomic<int> m_outLatency;
+
+	/* m_probeTime, m_probeTrip
+	Steady clock time the pending latency probe leaves at (0 = none) and its
+	round trip once received (-1 = not yet). */
+
+	std::atomic<int64_t> m_probeTime;
+	std::atomic<int64_t> m_probeTrip;
+
+	/* m_probe*
+	Background latency probe: its thread, completion and abort flags and its
+	result, valid once m_probeDone is set. */
+
+	std::thread       m_probeThread;
+	std::atomic<bool> m_probeDone;
+	std::atomic<bool> m_probeAbort;
+	int               m_probeResult;
+
+	/* m_light*
+	Lighting cache: wanted and last sent state of each LED, LEDs to update, rate
+	limiter budget and its last refill time. m_lightReset asks the sender thread
+	to send everything again (port reopened). */
+
+	std::unordered_map<uint32_t, uint32_t> m_lightWanted;
+	std::unordered_map<uint32_t, uint32_t> m_lightSent;
+	std::vector<uint32_t> m_lightDirty;
+	double  m_lightTokens;
+	int64_t m_lightTime;
+	std::atomic<bool> m_lightReset;
+
+	/* m_inQueue, m_inTime
+	Incoming messages (one producer, the MIDI thread, and one consumer, the audio
+	thread) and time of the last one. */
+
+	Queue<Event, G_MIDI_IN_QUEUE_SIZE> m_inQueue;
+	int64_t m_inTime;
 };
 
 }} // giada::m::
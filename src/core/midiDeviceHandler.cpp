@@ -24,7 +24,9 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <atomic>
 #include "../utils/log.h"
+#include "reclaimer.h"
 #include "midiDevice.h"
 #include "midiDeviceHandler.h"
 
@@ -34,6 +36,26 @@ namespace giada {
 namespace m {
 namespace mdh
 {
+namespace
+{
+/* published
+Copy of midiDevices seen by getDevices(). */
+
+std::atomic<const vector<MidiDevice*>*> published(nullptr);
+
+
+/* ------------------------------------------------------------------------ */
+
+
+void publish()
+{
+	const vector<MidiDevice*>* old = published.exchange(new vector<MidiDevice*>(midiDevices));
+	if (old != nullptr)
+		reclaimer::retire(old);
+}
+}; // {anonymous}
+
+/* ------------------------------------------------------------------------ */
 
 std::vector<MidiDevice*> midiDevices;
 
@@ -52,6 +74,7 @@ MidiDevice* addMidiDevice()
 {
 	MidiDevice* dev = new MidiDevice(getNewDeviceIndex());
 	midiDevices.push_back(dev);
+	publish();
 
 	gu_log("[addMidiDevice] device %d added, total=%d\n", dev->getIndex(), midiDevices.size());
 	return dev;
@@ -74,9 +97,33 @@ bool deleteMidiDevice(MidiDevice* dev)
 	}
 
 	midiDevices.erase(midiDevices.begin() + index);
+	publish();
+	reclaimer::retire(dev);
 	return true;
 }
 
+/* ------------------------------------------------------------------------ */
+
+const vector<MidiDevice*>& getDevices()
+{
+	static const vector<MidiDevice*> empty;
+
+	const vector<MidiDevice*>* d = published.load();
+	return d != nullptr ? *d : empty;
+}
+
+/* ------------------------------------------------------------------------ */
+
+MidiDevice* getDevice(const vector<MidiDevice*>& devices, int index)
+{
+	for (MidiDevice* dev : devices)
+		if (dev->getIndex() == index)
+			return dev;
+	return nullptr;
+}
+
+/* ------------------------------------------------------------------------ */
+
 unsigned getMidiDeviceCount()
 {
 	return midiDevices.size();
@@ -36,15 +36,32 @@ namespace m {
 namespace mdh
 {
 
+/* midiDevices
+Devices in use. GUI only: other threads read getDevices() instead. */
+
 extern std::vector<MidiDevice*> midiDevices;
 
+/* getDevices
+Snapshot of midiDevices for the audio, MIDI and sender threads, replaced
+whenever a device is added or removed. Valid as long as the caller stays in a
+reclaimer::Reader section, and so are the devices in it. */
+
+const std::vector<MidiDevice*>& getDevices();
+
+/* getDevice
+Returns the device with index 'index' (i.e. MidiDevice::getIndex()) in snapshot
+'devices', or nullptr if it's gone. */
+
+MidiDevice* getDevice(const std::vector<MidiDevice*>& devices, int index);
+
 /* addMidiDevice
 Add a new midi device into stack. */
 
 MidiDevice* addMidiDevice();
 
 /* deleteMidiDevice
-Completely removes a midi device from the stack. */
+Completely removes a midi device from the stack. The device is deleted as soon
+as no other thread can see it. */
 
 bool deleteMidiDevice(MidiDevice* dev);
 
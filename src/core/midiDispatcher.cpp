@@ -25,7 +25,10 @@
  * -------------------------------------------------------------------------- */
 
 
+#include <atomic>
+#include <memory>
 #include <vector>
+#include <unordered_map>
 #include "../glue/plugin.h"
 #include "../glue/io.h"
 #include "../glue/channel.h"
@@ -39,8 +42,13 @@
 #include "midiChannel.h"
 #include "conf.h"
 #include "const.h"
+#include "kernelMidi.h"
+#include "midiDeviceHandler.h"
 #include "mixer.h"
 #include "pluginHost.h"
+#include "reclaimer.h"
+#include "recorder.h"
+#include "commands.h"
 #include "plugin.h"
 #include "midiDispatcher.h"
 
@@ -54,6 +62,84 @@ namespace midiDispatcher
 {
 namespace
 {
+/* Binding actions. */
+
+enum
+{
+	MASTER_REWIND = 0,
+	MASTER_START_STOP,
+	MASTER_ACTION_REC,
+	MASTER_INPUT_REC,
+	MASTER_METRONOME,
+	MASTER_VOLUME_IN,
+	MASTER_VOLUME_OUT,
+	MASTER_BEAT_DOUBLE,
+	MASTER_BEAT_HALF,
+	CH_MUTE,
+	CH_SOLO,
+	CH_VOLUME,
+	CH_KEY_PRESS,
+	CH_KEY_REL,
+	CH_KILL,
+	CH_ARM,
+	CH_READ_ACTIONS,
+	CH_PITCH,
+	CH_PLUGIN_PARAM
+};
+
+/* Slot
+Latest value received by a continuous control (volumes, pitch, plug-in
+parameters), waiting to be applied by the audio thread (-1 = nothing new), and
+whether the GUI has to reflect it. */
+
+struct Slot
+{
+	Slot() : value(-1), dirty(false) {}
+
+	std::atomic<int>  value;
+	std::atomic<bool> dirty;
+};
+
+/* Binding
+A learned message and what to do with it. 'ch' is nullptr for master bindings;
+'plugin' and 'param' are used by CH_PLUGIN_PARAM only, 'slot' by continuous
+controls only. */
+
+struct Binding
+{
+	int      action;
+	Channel* ch;
+	Plugin*  plugin;
+	int      param;
+	Slot*    slot;
+};
+
+/* Table
+All learned bindings, indexed by pure message, plus the channels that want any
+incoming message (receiveMidi) and the continuous controls with their slots. */
+
+struct Table
+{
+	std::unordered_map<uint32_t, vector<Binding>> bindings;
+	vector<Channel*> listeners;
+	vector<Binding*> controls;
+	std::unique_ptr<Slot[]> slots;
+};
+
+/* table
+Current dispatch table, read by both MIDI and audio threads within a
+reclaimer::Reader section. rebuild() swaps it without locking and retires the
+old one. */
+
+std::atomic<Table*> table(nullptr);
+
+/* controlsPending, guiPending
+Some slot has a new value for the audio thread; some applied value has still to
+be shown by the GUI (a notification is on its way). */
+
+std::atomic<bool> controlsPending(false);
+std::atomic<bool> guiPending(false);
+
 /* cb_midiLearn, cb_data
 Callback prepared by the gdMidiGrabber window and called by midiDispatcher. It
 contains things to do once the midi message has been stored. */
@@ -65,200 +151,343 @@ void* cb_data = nullptr;
 /* -------------------------------------------------------------------------- */
 
 
-#ifdef WITH_VST
+/* isKey
+Key actions form a chain of their own, next to the one of controls. All of them
+but CH_ARM run on the audio thread. */
 
-void processPlugins(Channel* ch, const MidiEvent& midiEvent)
+bool isKey(int action)
 {
-	/* Pure value: if 'noNoteOff' in global config, get the raw value with the
-	'velocy' byte. Otherwise strip it off. */
+	return action == CH_KEY_PRESS || action == CH_KEY_REL || action == CH_KILL ||
+		action == CH_ARM;
+}
 
-	uint32_t pure = midiEvent.getRaw(conf::noNoteOff);
 
-	/* Plugins' parameters layout reflects the structure of the matrix
-	Channel::midiInPlugins. It is safe to assume then that i (i.e. Plugin*) and k
-	indexes match both the structure of Channel::midiInPlugins and
-	vector<Plugin*>* plugins. */
+/* -------------------------------------------------------------------------- */
 
-	vector<Plugin*>* plugins = &ch->plugins;
 
-	for (Plugin* plugin : *plugins) {
-		for (unsigned k=0; k<plugin->midiInParams.size(); k++) {
-			uint32_t midiInParam = plugin->midiInParams.at(k);
-			if (pure != midiInParam)
-				continue;
-			float vf = midiEvent.getVelocity() / 127.0f;
-			c::plugin::setParameter(plugin, k, vf, false); // false: not from GUI
-			gu_log("  >>> [plugin %d parameter %d] ch=%d (pure=0x%X, value=%d, float=%f)\n",
-				plugin->getId(), k, ch->index, pure, midiEvent.getVelocity(), vf);
-		}
-	}
+/* isControl
+Continuous controls: a fast sweep of values is merged into the latest one, once
+per block. Notes and triggers are never merged. */
+
+bool isControl(int action)
+{
+	return action == MASTER_VOLUME_IN || action == MASTER_VOLUME_OUT ||
+		action == CH_VOLUME || action == CH_PITCH || action == CH_PLUGIN_PARAM;
 }
 
-#endif
+
+/* -------------------------------------------------------------------------- */
+
+
+/* defer
+Stores the value of a continuous control for the next block. MIDI thread. */
+
+void defer(const Binding& b, int value)
+{
+	b.slot->value.store(value);
+	controlsPending.store(true);
+}
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void processChannels(const MidiDevice *device, const MidiEvent& midiEvent)
+#ifdef WITH_VST
+
+/* rampParameter
+Moves the parameter of binding 'b' towards 'value' in G_MIDI_CC_RAMP_STEPS
+changes spread over the block, so that coarse controller steps don't click.
+Nothing happens if the plug-in has left the stack in the meantime. Audio
+thread. */
+
+void rampParameter(const Binding& b, float value, int bufferSize)
 {
-	/* Pure value: if 'noNoteOff' in global config, get the raw value with the
-	'velocy' byte. Otherwise strip it off. */
+	const vector<Plugin*>& stack = b.ch->getPlugins();
+	int index = -1;
+	for (unsigned i=0; i<stack.size(); i++)
+		if (stack.at(i) == b.plugin) {
+			index = i;
+			break;
+		}
+	if (index == -1)
+		return;
+
+	uint32_t key  = recorder::paramKey(index, b.param);
+	float    from = b.plugin->getParameter(b.param);
+	for (int k=0; k<G_MIDI_CC_RAMP_STEPS; k++)
+		b.ch->addParamChange(key, from + (value - from) * (k + 1) / G_MIDI_CC_RAMP_STEPS,
+			k * bufferSize / G_MIDI_CC_RAMP_STEPS);
+}
 
-	uint32_t pure = midiEvent.getRaw(conf::noNoteOff);
+#endif
 
 
-	/*
-			Input Channels
-	*/
+/* -------------------------------------------------------------------------- */
 
-	for (InputChannel* ch : mixer::inputChannels) {
-		if (!ch->isMidiInAllowed(midiEvent.getChannel()))
+
+/* applyControls
+Applies the latest value of each continuous control that changed since the
+previous block. Volumes and plug-in parameters ramp during the block; the GUI is
+notified once. Audio thread. */
+
+void applyControls(int bufferSize)
+{
+	if (!controlsPending.exchange(false))
+		return;
+	Table* t = table.load();
+	if (t == nullptr)
+		return;
+
+	bool applied = false;
+	for (Binding* b : t->controls) {
+		int v = b->slot->value.exchange(-1);
+		if (v < 0)
 			continue;
-		if (pure == ch->midiInMute) {
-			gu_log("  >>> mute input ch=%d (pure=0x%X)\n", ch->index, pure);
-			c::channel::toggleMute(ch, false);
-		}
-		else if (pure == ch->midiInVolume) {
-			float vf = midiEvent.getVelocity() / 127.0f;
-			gu_log("  >>> volume input ch=%d (pure=0x%X, value=%d, float=%f)\n",
-				ch->index, pure, midiEvent.getVelocity(), vf);
-			c::channel::setVolume(ch, vf, false);
+		float vf = v / 127.0f;
+		switch (b->action) {
+			case MASTER_VOLUME_IN:
+				mixer::inVol = vf; break;
+			case MASTER_VOLUME_OUT:
+				mixer::outVol = vf; break;
+			case CH_VOLUME:
+				b->ch->setVolume(vf); break;
+			case CH_PITCH:
+				static_cast<SampleChannel*>(b->ch)->setPitch(v / (127/4.0f)); break; // [0-127] ~> [0.0-4.0]
+#ifdef WITH_VST
+			case CH_PLUGIN_PARAM:
+				rampParameter(*b, vf, bufferSize);
+				pluginHost::captureParameter(b->ch, b->plugin, b->param, vf);
+				break;
+#endif
 		}
+		b->slot->dirty.store(true);
+		applied = true;
+	}
 
-		if (ch->midiInput != device) continue;
+	if (applied && !guiPending.exchange(true))
+		commands::notify(commands::MIDI_CONTROLS_CHANGED);
+}
 
-	#ifdef WITH_VST
-		processPlugins(ch, midiEvent); // Process plugins' parameters
-	#endif
 
-		ch->receiveMidi(midiEvent);
-	}
+/* -------------------------------------------------------------------------- */
 
-	/*
-		Resource Channels
-	*/
 
-	for (ColumnChannel* cch : mixer::columnChannels) {
-		for (ResourceChannel* ch : (*cch)) {
+/* conflicts
+Tells whether binding 'b' shadows a new 'action' on the same target. As in the
+old chains of if/else the first binding wins; mute, solo and volume win over key
+bindings too. */
 
-			/* Do nothing on this channel if MIDI in is disabled or filtered out for
-			the current MIDI channel. */
+bool conflicts(const Binding& b, int action)
+{
+	if (b.action == CH_PLUGIN_PARAM)
+		return false;
+	if (!isKey(action))
+		return !isKey(b.action);
+	return isKey(b.action) || b.action == CH_MUTE || b.action == CH_SOLO ||
+		b.action == CH_VOLUME;
+}
 
-			if (!ch->midiIn || !ch->isMidiInAllowed(midiEvent.getChannel()))
-				continue;
 
-			if (pure == ch->midiInMute) {
-				gu_log("  >>> mute ch=%d (pure=0x%X)\n", ch->index, pure);
-				c::channel::toggleMute(ch, false);
-			}
-			else if (pure == ch->midiInSolo) {
-				gu_log("  >>> solo ch=%d (pure=0x%X)\n", ch->index, pure);
-				c::channel::toggleSolo(ch, false);
-			}
-			else if (pure == ch->midiInVolume) {
-				float vf = midiEvent.getVelocity() / 127.0f;
-				gu_log("  >>> volume ch=%d (pure=0x%X, value=%d, float=%f)\n",
-					ch->index, pure, midiEvent.getVelocity(), vf);
-				c::channel::setVolume(ch, vf, false);
-			}
-			else {
-				ResourceChannel* rch = static_cast<ResourceChannel*>(ch);
-				if      (pure == rch->midiInKeyPress) {
-					gu_log("  >>> keyPress, ch=%d (pure=0x%X)\n", ch->index, pure);
-					c::io::keyPress(rch, false, false, midiEvent.getVelocity());
-				}
-				else if (pure == rch->midiInKeyRel) {
-					gu_log("  >>> keyRel ch=%d (pure=0x%X)\n", ch->index, pure);
-					c::io::keyRelease(rch, false, false);
-				}
-				else if (pure == rch->midiInKill) {
-					gu_log("  >>> kill ch=%d (pure=0x%X)\n", ch->index, pure);
-					c::channel::kill(rch);
-				}
-				else if (pure == rch->midiInArm) {
-					gu_log("  >>> arm ch=%d (pure=0x%X)\n", ch->index, pure);
-					c::io::recPress(rch, false, false);
-				}
-				else if (pure == rch->midiInReadActions) {
-					gu_log("  >>> toggle read actions ch=%d (pure=0x%X)\n", rch->index, pure);
-					c::channel::toggleReadingRecs(rch, false);
-				}
-				else if (rch->type == G_CHANNEL_SAMPLE) {
-					SampleChannel *sch = static_cast<SampleChannel*>(ch);
-					if (pure == sch->midiInPitch) {
-						float vf = midiEvent.getVelocity() / (127/4.0f); // [0-127] ~> [0.0-4.0]
-						gu_log("  >>> pitch ch=%d (pure=0x%X, value=%d, float=%f)\n",
-							sch->index, pure, midiEvent.getVelocity(), vf);
-						c::channel::setPitch(sch, vf);
-					}
-				}
-			}
+/* -------------------------------------------------------------------------- */
 
-	#ifdef WITH_VST
-			processPlugins(ch, midiEvent); // Process plugins' parameters
-	#endif
 
-			/* Redirect full midi message (pure + velocity) to plugins. */
+/* bind
+Adds a binding to table 't', unless the message is empty or already taken by a
+binding of the same target. */
 
-			ch->receiveMidi(midiEvent);
-		}
-	}
+void bind(Table* t, uint32_t pure, int action, Channel* ch, Plugin* plugin=nullptr,
+	int param=0)
+{
+	if (pure == 0x0)
+		return;
+	vector<Binding>& list = t->bindings[pure];
+	if (action != CH_PLUGIN_PARAM)
+		for (const Binding& b : list)
+			if (b.ch == ch && conflicts(b, action))
+				return;
+	list.push_back({ action, ch, plugin, param, nullptr });
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void processMaster(const MidiEvent& midiEvent)
+void bindPlugins(Table* t, Channel* ch)
 {
-	/* Pure value: if 'noNoteOff' in global config, get the raw value with the
-	'velocy' byte. Otherwise strip it off. */
+#ifdef WITH_VST
+	for (Plugin* plugin : ch->getPlugins())
+		for (unsigned k=0; k<plugin->midiInParams.size(); k++)
+			bind(t, plugin->midiInParams.at(k), CH_PLUGIN_PARAM, ch, plugin, k);
+#endif
+}
 
-	uint32_t pure = midiEvent.getRaw(conf::noNoteOff);
 
-	if      (pure == conf::midiInRewind) {
-		gu_log("  >>> rewind (master) (pure=0x%X)\n", pure);
-		glue_rewindSeq(false);
-	}
-	else if (pure == conf::midiInStartStop) {
-		gu_log("  >>> startStop (master) (pure=0x%X)\n", pure);
-		glue_startStopSeq(false);
-	}
-	else if (pure == conf::midiInActionRec) {
-		gu_log("  >>> actionRec (master) (pure=0x%X)\n", pure);
-		c::io::startStopActionRec(false);
-	}
-	else if (pure == conf::midiInInputRec) {
-		gu_log("  >>> inputRec (master) (pure=0x%X)\n", pure);
-		c::io::startStopInputRec(false);
-	}
-	else if (pure == conf::midiInMetronome) {
-		gu_log("  >>> metronome (master) (pure=0x%X)\n", pure);
-		glue_startStopMetronome(false);
-	}
-	else if (pure == conf::midiInVolumeIn) {
-		float vf = midiEvent.getVelocity() / 127.0f;
-		gu_log("  >>> input volume (master) (pure=0x%X, value=%d, float=%f)\n",
-			pure, midiEvent.getVelocity(), vf);
-		glue_setInVol(vf, false);
+/* -------------------------------------------------------------------------- */
+
+
+/* wantsMidi
+Tells whether channel 'ch' does something with any incoming message: MIDI
+channels record them, plug-ins play them. */
+
+bool wantsMidi(const Channel* ch)
+{
+#ifdef WITH_VST
+	if (ch->getPlugins().size() > 0)
+		return true;
+#endif
+	return ch->type == G_CHANNEL_MIDI;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void processMaster(const Binding& b, const MidiEvent& midiEvent)
+{
+	switch (b.action) {
+		case MASTER_REWIND:
+			gu_log("  >>> rewind (master)\n");
+			glue_rewindSeq(false);
+			break;
+		case MASTER_START_STOP:
+			gu_log("  >>> startStop (master)\n");
+			glue_startStopSeq(false);
+			break;
+		case MASTER_ACTION_REC:
+			gu_log("  >>> actionRec (master)\n");
+			c::io::startStopActionRec(false);
+			break;
+		case MASTER_INPUT_REC:
+			gu_log("  >>> inputRec (master)\n");
+			c::io::startStopInputRec(false);
+			break;
+		case MASTER_METRONOME:
+			gu_log("  >>> metronome (master)\n");
+			glue_startStopMetronome(false);
+			break;
+		case MASTER_VOLUME_IN:
+		case MASTER_VOLUME_OUT:
+			defer(b, midiEvent.getVelocity());
+			break;
+		case MASTER_BEAT_DOUBLE:
+			gu_log("  >>> sequencer x2 (master)\n");
+			glue_beatsMultiply();
+			break;
+		case MASTER_BEAT_HALF:
+			gu_log("  >>> sequencer /2 (master)\n");
+			glue_beatsDivide();
+			break;
 	}
-	else if (pure == conf::midiInVolumeOut) {
-		float vf = midiEvent.getVelocity() / 127.0f;
-		gu_log("  >>> output volume (master) (pure=0x%X, value=%d, float=%f)\n",
-			pure, midiEvent.getVelocity(), vf);
-		glue_setOutVol(vf, false);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* isAllowed
+Input channels listen to their own device only, resource channels to any device
+when MIDI input is enabled. Both filter by MIDI channel. */
+
+bool isAllowed(const Channel* ch, const MidiDevice* device, const MidiEvent& midiEvent)
+{
+	if (ch->type == G_CHANNEL_INPUT) {
+		if (static_cast<const InputChannel*>(ch)->midiInput != device)
+			return false;
 	}
-	else if (pure == conf::midiInBeatDouble) {
-		gu_log("  >>> sequencer x2 (master) (pure=0x%X)\n", pure);
-		glue_beatsMultiply();
+	else
+	if (!ch->midiIn)
+		return false;
+	return ch->isMidiInAllowed(midiEvent.getChannel());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* processChannel
+Channel controls, on the MIDI thread. Continuous ones are deferred to the next
+block. */
+
+void processChannel(const Binding& b, const MidiDevice* device, const MidiEvent& midiEvent)
+{
+	Channel* ch = b.ch;
+
+	/* Input channels used to get mute and volume from any device. */
+
+	if (ch->type == G_CHANNEL_INPUT && b.action != CH_PLUGIN_PARAM) {
+		if (!ch->isMidiInAllowed(midiEvent.getChannel()))
+			return;
 	}
-	else if (pure == conf::midiInBeatHalf) {
-		gu_log("  >>> sequencer /2 (master) (pure=0x%X)\n", pure);
-		glue_beatsDivide();
+	else
+	if (!isAllowed(ch, device, midiEvent))
+		return;
+
+	switch (b.action) {
+		case CH_MUTE:
+			gu_log("  >>> mute ch=%d\n", ch->index);
+			c::channel::toggleMute(ch, false);
+			break;
+		case CH_SOLO:
+			gu_log("  >>> solo ch=%d\n", ch->index);
+			c::channel::toggleSolo(ch, false);
+			break;
+		case CH_VOLUME:
+		case CH_PITCH:
+		case CH_PLUGIN_PARAM:
+			defer(b, midiEvent.getVelocity());
+			break;
+		case CH_READ_ACTIONS:
+			gu_log("  >>> toggle read actions ch=%d\n", ch->index);
+			c::channel::toggleReadingRecs(static_cast<ResourceChannel*>(ch), false);
+			break;
+		case CH_ARM:
+			gu_log("  >>> arm ch=%d\n", ch->index);
+			c::io::recPress(static_cast<ResourceChannel*>(ch), false, false);
+			break;
 	}
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+
+/* processTimed
+Audio thread counterpart of processChannel(): key presses and notes for
+plug-ins, at frame 'localFrame' of the current block. Arming a channel creates
+its take wave: that one stays on the MIDI thread. Nothing logged here. */
+
+void processTimed(const MidiDevice* device, const MidiEvent& midiEvent, int localFrame)
+{
+	Table* t = table.load();
+	if (t == nullptr)
+		return;
+
+	auto it = t->bindings.find(midiEvent.getRaw(conf::noNoteOff));
+	if (it != t->bindings.end()) {
+		for (const Binding& b : it->second) {
+			if (b.ch == nullptr || !isAllowed(b.ch, device, midiEvent))
+				continue;
+			ResourceChannel* ch = static_cast<ResourceChannel*>(b.ch);
+			switch (b.action) {
+				case CH_KEY_PRESS:
+					c::io::keyPress(ch, false, false, midiEvent.getVelocity(), localFrame);
+					break;
+				case CH_KEY_REL:
+					c::io::keyRelease(ch, false, false, localFrame);
+					break;
+				case CH_KILL:
+					c::channel::kill(ch, localFrame);
+					break;
+			}
+		}
+	}
+
+	/* Redirect full midi message (pure + velocity) to channels that care. */
+
+	for (Channel* ch : t->listeners)
+		if (isAllowed(ch, device, midiEvent))
+			ch->receiveMidi(midiEvent, localFrame);
+}
 } // {anonymous}
 
 
@@ -287,6 +516,103 @@ void stopMidiLearn()
 /* -------------------------------------------------------------------------- */
 
 
+/* carryControls
+Moves values not yet applied (or not yet shown) from the controls of table
+'from' to the same controls in table 'to', so that a rebuild doesn't swallow
+the last move of a knob. 'to' is already live: values are handed over with the
+same atomics the audio thread reads. */
+
+void carryControls(Table* from, Table* to)
+{
+	for (Binding* ob : from->controls) {
+		int  value = ob->slot->value.exchange(-1);
+		bool dirty = ob->slot->dirty.exchange(false);
+		if (value < 0 && !dirty)
+			continue;
+		for (Binding* nb : to->controls) {
+			if (nb->action != ob->action || nb->ch != ob->ch ||
+			    nb->plugin != ob->plugin || nb->param != ob->param)
+				continue;
+			if (value >= 0) {
+				nb->slot->value.store(value);
+				controlsPending.store(true);
+			}
+			if (dirty)
+				nb->slot->dirty.store(true);
+			break;
+		}
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void rebuild()
+{
+	Table* t = new Table();
+
+	bind(t, conf::midiInRewind,     MASTER_REWIND,      nullptr);
+	bind(t, conf::midiInStartStop,  MASTER_START_STOP,  nullptr);
+	bind(t, conf::midiInActionRec,  MASTER_ACTION_REC,  nullptr);
+	bind(t, conf::midiInInputRec,   MASTER_INPUT_REC,   nullptr);
+	bind(t, conf::midiInMetronome,  MASTER_METRONOME,   nullptr);
+	bind(t, conf::midiInVolumeIn,   MASTER_VOLUME_IN,   nullptr);
+	bind(t, conf::midiInVolumeOut,  MASTER_VOLUME_OUT,  nullptr);
+	bind(t, conf::midiInBeatDouble, MASTER_BEAT_DOUBLE, nullptr);
+	bind(t, conf::midiInBeatHalf,   MASTER_BEAT_HALF,   nullptr);
+
+	for (InputChannel* ch : mixer::inputChannels) {
+		bind(t, ch->midiInMute,   CH_MUTE,   ch);
+		bind(t, ch->midiInVolume, CH_VOLUME, ch);
+		bindPlugins(t, ch);
+		t->listeners.push_back(ch);
+	}
+
+	/* Same priority order of the old if/else chains. */
+
+	for (ColumnChannel* cch : mixer::columnChannels) {
+		for (ResourceChannel* ch : (*cch)) {
+			bind(t, ch->midiInMute,        CH_MUTE,         ch);
+			bind(t, ch->midiInSolo,        CH_SOLO,         ch);
+			bind(t, ch->midiInVolume,      CH_VOLUME,       ch);
+			bind(t, ch->midiInKeyPress,    CH_KEY_PRESS,    ch);
+			bind(t, ch->midiInKeyRel,      CH_KEY_REL,      ch);
+			bind(t, ch->midiInKill,        CH_KILL,         ch);
+			bind(t, ch->midiInArm,         CH_ARM,          ch);
+			bind(t, ch->midiInReadActions, CH_READ_ACTIONS, ch);
+			if (ch->type == G_CHANNEL_SAMPLE)
+				bind(t, static_cast<SampleChannel*>(ch)->midiInPitch, CH_PITCH, ch);
+			bindPlugins(t, ch);
+			if (wantsMidi(ch))
+				t->listeners.push_back(ch);
+		}
+	}
+
+	/* Give continuous controls a slot. Bindings won't move from now on. */
+
+	for (auto& kv : t->bindings)
+		for (Binding& b : kv.second)
+			if (isControl(b.action))
+				t->controls.push_back(&b);
+	t->slots.reset(new Slot[t->controls.size()]);
+	for (unsigned i=0; i<t->controls.size(); i++)
+		t->controls.at(i)->slot = &t->slots[i];
+
+	Table* old = table.exchange(t);
+	if (old != nullptr) {
+		carryControls(old, t);
+		reclaimer::retire(old);
+	}
+
+	gu_log("[midiDispatcher::rebuild] %d messages bound, %d listeners\n",
+		(int) t->bindings.size(), (int) t->listeners.size());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void dispatch(MidiDevice *device, int byte1, int byte2, int byte3)
 {
 	/* Here we want to catch two things: a) note on/note off from a keyboard and
@@ -300,15 +626,92 @@ void dispatch(MidiDevice *device, int byte1, int byte2, int byte3)
 	/* Start dispatcher. If midi learn is on don't parse channels, just learn
 	incoming MIDI signal. Learn callback wants 'pure' MIDI event: if 'noNoteOff'
 	in global config, get the raw value with the 'velocy' byte. Otherwise strip it
-	off. If midi learn is off process master events first, then each channel
-	in the stack. This way incoming signals don't get processed by glue_* when
-	MIDI learning is on. */
+	off. If midi learn is off look the pure message up in the dispatch table and
+	run master and channel controls bound to it. This way incoming signals don't
+	get processed by glue_* when MIDI learning is on. */
 
-	if (cb_learn)
+	if (cb_learn) {
 		cb_learn(midiEvent.getRaw(conf::noNoteOff), cb_data);
-	else {
-		processMaster(midiEvent);
-		processChannels(device, midiEvent);
+		return;
+	}
+
+	reclaimer::Reader reader;
+	Table* t = table.load();
+	if (t == nullptr)
+		return;
+	auto it = t->bindings.find(midiEvent.getRaw(conf::noNoteOff));
+	if (it == t->bindings.end())
+		return;
+
+	/* Master first, as in the past: only the first matching master binding. */
+
+	for (const Binding& b : it->second)
+		if (b.ch == nullptr) {
+			processMaster(b, midiEvent);
+			break;
+		}
+
+	for (const Binding& b : it->second)
+		if (b.ch != nullptr)
+			processChannel(b, device, midiEvent);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void refreshControls()
+{
+	guiPending.store(false);
+
+	Table* t = table.load();
+	if (t == nullptr)
+		return;
+
+	for (Binding* b : t->controls) {
+		if (!b->slot->dirty.exchange(false))
+			continue;
+		switch (b->action) {
+			case MASTER_VOLUME_IN:
+				gu_log("  >>> input volume (master) (float=%f)\n", mixer::inVol);
+				glue_refreshInVol();
+				break;
+			case MASTER_VOLUME_OUT:
+				gu_log("  >>> output volume (master) (float=%f)\n", mixer::outVol);
+				glue_refreshOutVol();
+				break;
+			case CH_VOLUME:
+				gu_log("  >>> volume ch=%d (float=%f)\n", b->ch->index, b->ch->volume);
+				c::channel::refreshVolume(b->ch);
+				break;
+			case CH_PITCH:
+				gu_log("  >>> pitch ch=%d\n", b->ch->index);
+				c::channel::refreshPitch(static_cast<SampleChannel*>(b->ch));
+				break;
+#ifdef WITH_VST
+			case CH_PLUGIN_PARAM:
+				gu_log("  >>> [plugin %d parameter %d] ch=%d\n", b->plugin->getId(),
+					b->param, b->ch->index);
+				c::plugin::refreshParameter(b->plugin, b->param);
+				break;
+#endif
+		}
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void processInput(int bufferSize)
+{
+	applyControls(bufferSize);
+
+	for (MidiDevice* device : mdh::getDevices()) {
+		MidiDevice::Event e;
+		while (device->popEvent(e))
+			if (cb_learn == nullptr)
+				processTimed(device, MidiEvent(e.msg), kernelMidi::getFrameOffset(e.time, bufferSize));
 	}
 }
 }}}; // giada::m::midiDispatcher::
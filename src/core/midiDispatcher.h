@@ -45,8 +45,37 @@ typedef void (cb_midiLearn) (uint32_t, void*);
 void startMidiLearn(cb_midiLearn* cb, void* data);
 void stopMidiLearn();
 
+/* rebuild
+Recomputes the dispatch table, i.e. the map from learned messages to master,
+channel and plug-in bindings. Call it each time a binding, a channel or a
+plug-in is added, changed or removed, before the removed target is freed. GUI
+only (FLTK lock held): other threads ask for it through commands::notify(). The
+replaced table is freed through the reclaimer, so channels and plug-ins it
+points to must be freed the same way. */
+
+void rebuild();
+
+/* dispatch
+Handles an incoming message on the MIDI input thread: MIDI learn, master
+bindings and channel controls. */
+
 void dispatch(MidiDevice *device, int byte1, int byte2, int byte3);
 
+/* processInput
+Applies continuous controls received during the previous block, keeping only the
+latest value of each, then drains the input queue of each MIDI device, applying
+key presses and notes for plug-ins at the right frame of the current block of
+'bufferSize' frames. Audio thread only, at the beginning of each block. */
+
+void processInput(int bufferSize);
+
+/* refreshControls
+Updates the widgets of continuous controls (volumes, pitch, plug-in parameters)
+changed by MIDI input since the last call. Called on MIDI_CONTROLS_CHANGED
+notifications, with the FLTK lock held. */
+
+void refreshControls();
+
 }}}; // giada::m::midiDispatcher::
 
 
@@ -27,6 +27,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include "../deps/rtaudio-mod/RtAudio.h"
 #include "../utils/log.h"
 #include "metronome.h"
@@ -43,6 +44,11 @@
 #include "inputChannel.h"
 #include "columnChannel.h"
 #include "midiChannel.h"
+#include "kernelMidi.h"
+#include "commands.h"
+#include "midiDispatcher.h"
+#include "workerPool.h"
+#include "reclaimer.h"
 #include "audioBuffer.h"
 #include "mixer.h"
 
@@ -52,32 +58,147 @@ namespace mixer
 {
 namespace
 {
+/* outVolPrev
+Output volume applied at the end of the previous block, start of the next
+ramp. */
+
+float outVolPrev = G_DEFAULT_OUT_VOL;
+
 
 /* -------------------------------------------------------------------------- */
 
-/* feed
- on InputChannel::process method. */
+/* getLatency
+Plug-in latency of a single channel, in frames. */
 
-void routeAudio(AudioBuffer& out, AudioBuffer& in, unsigned bufferSize)
+int getLatency(Channel* ch)
+{
+#ifdef WITH_VST
+	return pluginHost::getStackLatency(ch);
+#else
+	return 0;
+#endif
+}
+
+
+/* getPathLatency
+Latency of the slowest path into a column stack: its InputChannel or any of its
+resources. */
+
+int getPathLatency(ColumnChannel* cch)
+{
+	int path = cch->inputChannel != nullptr ? getLatency(cch->inputChannel) : 0;
+	for (ResourceChannel* rch : *cch)
+		path = std::max(path, getLatency(rch));
+	return path;
+}
+
+
+/* updateDelayComp
+Plug-in delay compensation. Within a column the monitored input (latency of its
+InputChannel) and each resource (latency of its own stack) are delayed to the
+slowest of them; the column stack adds its own latency on top. Then columns and
+InputChannels are delayed to the slowest one, so that everything lines up at
+the master sum. Plug-ins may change their latency at any time: this runs on
+every block, it's just a few sums. */
+
+void updateDelayComp()
 {
-	// Feed InputChannels that are currently being used on a recording or being
-	// monitored with the input buffer.
-	// InputChannel copies de-interleaved buffer[inputIndex] to it's own virtual
-	// channel and process throught VSTs.
-	// If the InputChannel is monitoring, writes the processed output to outBuf.
-	// Also feeds the ColumnChannel it's routed to with the processed output.
-	if (kernelAudio::isInputEnabled()) {
-		for (unsigned i=0; i<inputChannels.size(); i++) {
-			inputChannels[i]->process(out, in);
+	int total = 0;
+
+	for (InputChannel* ich : inputChannels)
+		total = std::max(total, getLatency(ich));
+
+	for (ColumnChannel* cch : columnChannels) {
+		int inputLatency = cch->inputChannel != nullptr ? getLatency(cch->inputChannel) : 0;
+		int path = getPathLatency(cch);
+		for (ResourceChannel* rch : *cch) {
+			rch->setDelayComp(path - getLatency(rch));
+			rch->inputLatency = inputLatency;
 		}
+		cch->setInputDelayComp(path - inputLatency);
+		total = std::max(total, path + getLatency(cch));
 	}
 
-	// Process ColumnChannels
-	// (Input is ignored)
-	//
-	for (unsigned i=0; i<columnChannels.size(); i++) {
-		columnChannels[i]->process(out, in);
+	for (InputChannel* ich : inputChannels)
+		ich->setDelayComp(total - getLatency(ich));
+	for (ColumnChannel* cch : columnChannels)
+		cch->setDelayComp(total - getPathLatency(cch) - getLatency(cch));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* renderInput, renderResource, renderColumn
+Worker pool jobs, one call per channel. Resources are numbered across all
+columns, in order. */
+
+void renderInput(int i, void* in)
+{
+	inputChannels[i]->render(*static_cast<AudioBuffer*>(in));
+}
+
+
+void renderResource(int i, void* data)
+{
+	for (ColumnChannel* cch : columnChannels) {
+		if (i < (int) cch->getResourceCount()) {
+			cch->renderResource(i);
+			return;
+		}
+		i -= cch->getResourceCount();
+	}
+}
+
+
+void renderColumn(int i, void* in)
+{
+	columnChannels[i]->render(*static_cast<AudioBuffer*>(in));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* routeAudio
+inBuf -> Input Channels -> Column Channels -> Resource Channels -> Column
+Channels -> outBuf. The chain is a dependency graph: channels at the same level
+don't depend on each other, so they are rendered in parallel by the worker pool
+into their own buffers. Everything shared (sums into column buffers and into
+outBuf) happens between levels on the audio thread, in a fixed order, so the
+result doesn't depend on scheduling. */
+
+void routeAudio(AudioBuffer& out, AudioBuffer& in, unsigned bufferSize)
+{
+	updateDelayComp();
+
+	// Level 0: InputChannels currently being used on a recording or being
+	// monitored copy de-interleaved buffer[inputIndex] to their own virtual
+	// channel and process it through VSTs.
+	bool inputEnabled = kernelAudio::isInputEnabled();
+	if (inputEnabled)
+		workerPool::run(inputChannels.size(), renderInput, &in);
+
+	// Feed ColumnChannels with the processed input.
+	unsigned resources = 0;
+	for (ColumnChannel* cch : columnChannels) {
+		cch->prepare();
+		resources += cch->getResourceCount();
 	}
+
+	// Level 1: ResourceChannels of every column.
+	workerPool::run(resources, renderResource, nullptr);
+
+	for (ColumnChannel* cch : columnChannels)
+		cch->gather();
+
+	// Level 2: ColumnChannels plug-in stacks (input is ignored).
+	workerPool::run(columnChannels.size(), renderColumn, &in);
+
+	// Mix down. If an InputChannel is monitoring its output goes to outBuf too.
+	if (inputEnabled)
+		for (InputChannel* ich : inputChannels)
+			ich->mix(out);
+	for (ColumnChannel* cch : columnChannels)
+		cch->mix(out);
 }
 
 
@@ -106,20 +227,17 @@ void clearAllBuffers(AudioBuffer& outBuf)
 /* -------------------------------------------------------------------------- */
 
 /* readActions
-Reads all recorded actions. */
+Reads all recorded actions at the current frame, as placed by the current
+clock. */
 
 void readActions(unsigned frame)
 {
 	pthread_mutex_lock(&mutex_recs);
-	for (unsigned i=0; i<recorder::frames.size(); i++) {
-		if (recorder::frames.at(i) != clock::getCurrentFrame())
-			continue;
-		for (recorder::action* action : recorder::global.at(i)) {
+	recorder::forEachActionAt(clock::getCurrentFrame(), clock::getFramesInLoop(),
+		clock::getBeats(), [frame] (recorder::action* action) {
 			Channel* ch = mh::getChannelByIndex(action->chan);
 			ch->parseAction(action, frame, clock::getCurrentFrame(), clock::isRunning());
-		}
-		break;
-	}
+		});
 	pthread_mutex_unlock(&mutex_recs);
 }
 
@@ -157,7 +275,7 @@ Applies a very dumb hard limiter. */
 
 void limitOutput(AudioBuffer& outBuf, unsigned frame)
 {
-	for (int i=0; i<outBuf.countChannels(); i++)
+	for (int i=0; i<G_OUT_CHANS; i++)
 		if      (outBuf[frame][i] > 1.0f)
 			outBuf[frame][i] = 1.0f;
 		else if (outBuf[frame][i] < -1.0f)
@@ -168,12 +286,12 @@ void limitOutput(AudioBuffer& outBuf, unsigned frame)
 /* -------------------------------------------------------------------------- */
 
 /* finalizeOutput
-Last touches after the output has been rendered: apply output volume. */
+Last touches after the output has been rendered: apply output volume 'vol'. */
 
-void finalizeOutput(AudioBuffer& outBuf, unsigned frame)
+void finalizeOutput(AudioBuffer& outBuf, unsigned frame, float vol)
 {
-	for (int i=0; i<outBuf.countChannels(); i++)
-		outBuf[frame][i] *= outVol;
+	for (int i=0; i<G_OUT_CHANS; i++)
+		outBuf[frame][i] *= vol;
 }
 
 
@@ -189,7 +307,7 @@ void testBar(unsigned frame)
 		return;
 
 	if (metronome::on)
-		metronome::tickPlay = true;
+		metronome::tick(frame);
 
 	pthread_mutex_lock(&mutex_chans);
 	for (unsigned i=0; i<columnChannels.size(); i++) {
@@ -221,12 +339,10 @@ void testFirstBeat(unsigned frame)
 /* -------------------------------------------------------------------------- */
 
 
-void testLastBeat()
+void testLastBeat(unsigned frame)
 {
-	if (clock::isOnBeat())
-		if (metronome::on && !metronome::tickPlay) {
-			metronome::tockPlay = true;
-		}
+	if (clock::isOnBeat() && metronome::on)
+		metronome::tock(frame);
 }
 
 }; // {anonymous}
@@ -275,12 +391,22 @@ int masterPlay(void* outBuf, void* inBuf, unsigned bufferSize,
 	if (!ready)
 		return 0;
 
+	/* Anything published by pointer swap (envelopes, ...) stays alive until the
+	end of the block. Workers run within it too: run() waits for them. */
+
+	reclaimer::Reader reader;
+
+	kernelMidi::beginBlock(streamTime);
+
 #ifdef __linux__
 	clock::recvJackSync();
 #endif
+	clock::recvMIDIsync(bufferSize);
+	commands::process();
+	midiDispatcher::processInput(bufferSize);
 
 	AudioBuffer out, in;
-	out.setData((float*) outBuf, bufferSize, G_OUT_CHANS);
+	out.setData((float*) outBuf, bufferSize, kernelAudio::getOutChans());
 	if (kernelAudio::isInputEnabled())
 		in.setData((float*) inBuf, bufferSize, conf::channelsIn);
 
@@ -289,15 +415,21 @@ int masterPlay(void* outBuf, void* inBuf, unsigned bufferSize,
 
 	clearAllBuffers(out);
 
+	/* When slave of an external MIDI master the sequencer might advance twice
+	or not at all in a frame, to catch up with it: no action is lost or
+	repeated this way. */
+
 	for (unsigned j=0; j<bufferSize; j++) {
-		if (clock::isRunning()) {
+		if (!clock::isRunning())
+			continue;
+		for (int step=clock::getSyncSteps(j); step>0; step--) {
 			doQuantize(j);
 			testBar(j);
 			testFirstBeat(j);
 			readActions(j);
 			clock::incrCurrentFrame();
-			testLastBeat();  // this test must be the last one
-			clock::sendMIDIsync();
+			testLastBeat(j);  // this test must be the last one
+			clock::sendMIDIsync(j);
 		}
 	}
 
@@ -305,15 +437,20 @@ int masterPlay(void* outBuf, void* inBuf, unsigned bufferSize,
 	// -> Resource Channels -> Column Channels -> _outBuf
 	routeAudio(out, in, bufferSize);
 
-	/* post processing */
+	/* Post processing. Output volume ramps from the previous block's value, to
+	smooth fast changes. It only touches the main pair: the metronome is mixed
+	last, untouched, on the main or on the cue pair. */
 
-	/* Post processing. */
+	float vol     = outVol;
+	float volStep = (vol - outVolPrev) / bufferSize;
 	for (unsigned j=0; j<bufferSize; j++) {
-		finalizeOutput(out, j);
+		finalizeOutput(out, j, outVolPrev + volStep * (j + 1));
 		if (conf::limitOutput)
 			limitOutput(out, j);
-		metronome::render(out, j);
 	}
+	outVolPrev = vol;
+
+	metronome::render(out);
 
 	/* Unset data in buffers. If you don't do this, buffers go out of scope and
 	destroy memory allocated by RtAudio ---> havoc. */
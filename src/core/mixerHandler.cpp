@@ -33,6 +33,8 @@
 #include "../glue/main.h"
 #include "../glue/channel.h"
 #include "kernelMidi.h"
+#include "midiDispatcher.h"
+#include "reclaimer.h"
 #include "mixer.h"
 #include "metronome.h"
 #include "const.h"
@@ -70,24 +72,21 @@ namespace
 {
 #ifdef WITH_VST
 
-int readPatchPlugins(vector<patch::plugin_t>* list)
+int readPatchPlugins(vector<patch::plugin_t>* list, Channel* ch)
 {
-	int ret = 1;
-	for (unsigned i=0; i<list->size(); i++) {
-		patch::plugin_t *ppl = &list->at(i);
-		// TODO use glue_addPlugin()
-		Plugin *plugin = pluginHost::addPlugin(ppl->path.c_str(),
-				&mixer::mutex_plugins, nullptr);
-		if (plugin != nullptr) {
-			plugin->setBypass(ppl->bypass);
-			for (unsigned j=0; j<ppl->params.size(); j++)
-				plugin->setParameter(j, ppl->params.at(j));
-			ret &= 1;
-		}
-		else
-			ret &= 0;
-	}
-	return ret;
+	pluginHost::StackRequest r;
+	r.ch = ch;
+	for (const patch::plugin_t& ppl : *list)
+		r.fids.push_back(ppl.path);
+
+	r.setup = [list] (Plugin* plugin, int i) {
+		const patch::plugin_t& ppl = list->at(i);
+		plugin->setBypass(ppl.bypass);
+		if (ppl.state.empty() || !plugin->setState(ppl.state))
+			for (unsigned j=0; j<ppl.params.size(); j++)
+				plugin->setParameter(j, ppl.params.at(j));
+	};
+	return pluginHost::addPlugins({ r }) == 0;
 }
 
 #endif
@@ -144,6 +143,7 @@ InputChannel* addInputChannel()
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		mixer::inputChannels.push_back(ch);
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
 		break;
 	}
@@ -172,8 +172,9 @@ bool deleteInputChannel(InputChannel* ch) {
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		mixer::inputChannels.erase(mixer::inputChannels.begin() + index);
-		delete ch;
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
+		reclaimer::retire(ch);  // the old dispatch table might still point to it
 		return true;
 	}
 }
@@ -207,6 +208,7 @@ ColumnChannel* addColumnChannel() {
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		mixer::columnChannels.push_back(ch);
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
 		break;
 	}
@@ -236,8 +238,9 @@ bool deleteColumnChannel(ColumnChannel* ch) {
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		mixer::columnChannels.erase(mixer::columnChannels.begin() + index);
-		delete ch;
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
+		reclaimer::retire(ch);
 		return true;
 	}
 }
@@ -273,6 +276,7 @@ ResourceChannel* addResourceChannel(ColumnChannel* col, int type)
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		col->addResource(ch);
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
 		break;
 	}
@@ -310,8 +314,9 @@ bool deleteResourceChannel(ResourceChannel* ch)
 		if (pthread_mutex_trylock(&mixer::mutex_chans) != 0)
 			continue;
 		mixer::columnChannels.at(columnIndex)->removeResource(index);
-		delete ch;
+		midiDispatcher::rebuild();
 		pthread_mutex_unlock(&mixer::mutex_chans);
+		reclaimer::retire(ch);
 		return true;
 	}
 }
@@ -384,6 +389,15 @@ bool hasEditedSamples()
 /* -------------------------------------------------------------------------- */
 
 
+void reserveChannelIndex(int i)
+{
+	channelIndex = std::max(channelIndex, i + 1);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void stopSequencer()
 {
 	// TODO: Fix this (call from columnchannels)
@@ -424,6 +438,11 @@ void readPatch()
 	clock::updateFrameBars();
 	metronome::on = patch::metronome;
 
+	/* Actions are stored in ticks: just rebuild their frame positions against
+	the patch clock, whatever samplerate the patch was saved with. */
+
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats(), &mixer::mutex_recs);
+
 #ifdef WITH_VST
 
 	//readPatchPlugins(&patch::masterInPlugins, pluginHost::MASTER_IN);
@@ -436,6 +455,7 @@ void readPatch()
 	very likely). */
 
 	mixer::rewind();
+	midiDispatcher::rebuild();
 	mixer::ready = true;
 }
 
@@ -115,6 +115,12 @@ Returns ResourceChannel with given index 'i'. */
 
 Channel* getChannelByIndex(int i);
 
+/* reserveChannelIndex
+Makes sure new channels never get index 'i' or lower. Used when channels are
+restored from a patch with their saved index. */
+
+void reserveChannelIndex(int i);
+
 /* hasLogicalSamples
 True if 1 or more samples are logical (memory only, such as takes)
 TODO: fix this*/
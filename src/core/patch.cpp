@@ -25,6 +25,8 @@
  * -------------------------------------------------------------------------- */
 
 
+#include <algorithm>
+#include <cstring>
 #include "../utils/log.h"
 #include "../utils/string.h"
 #include "const.h"
@@ -44,12 +46,23 @@ namespace patch
 {
 namespace
 {
+/* validBpm
+False also on NaN, which any plain comparison would let through. */
+
+bool validBpm(float v)
+{
+	return v >= G_MIN_BPM && v <= G_MAX_BPM;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
 /* sanitize
 Internal sanity check. */
 
 void sanitize()
 {
-	bpm          = bpm < G_MIN_BPM || bpm > G_MAX_BPM ? G_DEFAULT_BPM : bpm;
+	bpm          = !validBpm(bpm) ? G_DEFAULT_BPM : bpm;
 	bars         = bars <= 0 || bars > G_MAX_BARS ? G_DEFAULT_BARS : bars;
 	beats        = beats <= 0 || beats > G_MAX_BEATS ? G_DEFAULT_BEATS : beats;
 	quantize     = quantize < 0 || quantize > G_MAX_QUANTIZE ? G_DEFAULT_QUANTIZE : quantize;
@@ -74,6 +87,183 @@ void sanitize()
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/* getFramesPerTick
+Length of a tick in frames, according to the patch's own clock. Computed the
+same way clock::updateFrameBars() and recorder::updateClock() do. A broken
+clock falls back to the same defaults sanitize() picks, so that it never
+divides by zero and packActions() agrees with modernize() after sanitizing. */
+
+double getFramesPerTick()
+{
+	float bpm_        = validBpm(bpm) ? bpm : G_DEFAULT_BPM;
+	int   beats_      = beats <= 0 || beats > G_MAX_BEATS ? G_DEFAULT_BEATS : beats;
+	int   samplerate_ = samplerate <= 0 ? G_DEFAULT_SAMPLERATE : samplerate;
+	int   framesInLoop = (samplerate_ * (60.0f / bpm_)) * beats_;
+	return std::max(framesInLoop, 1) / (double) (beats_ * G_PPQ);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* packVarint, unpackVarint
+Little-endian base 128 integers, 7 bits per byte. */
+
+void packVarint(vector<uint8_t>& out, uint64_t v)
+{
+	while (v >= 0x80) {
+		out.push_back((v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	out.push_back(v);
+}
+
+
+bool unpackVarint(const vector<uint8_t>& in, size_t& pos, uint64_t& v)
+{
+	v = 0;
+	for (int shift=0; shift<64; shift+=7) {
+		if (pos >= in.size())
+			return false;
+		uint8_t b = in[pos++];
+		v |= (uint64_t) (b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* packRaw, unpackRaw
+Raw little-endian copy of the bits of 'size' bytes wide values. */
+
+void packRaw(vector<uint8_t>& out, uint64_t bits, int size)
+{
+	for (int i=0; i<size; i++)
+		out.push_back((bits >> (i * 8)) & 0xFF);
+}
+
+
+bool unpackRaw(const vector<uint8_t>& in, size_t& pos, uint64_t& bits, int size)
+{
+	if (pos + size > in.size())
+		return false;
+	bits = 0;
+	for (int i=0; i<size; i++)
+		bits |= (uint64_t) in[pos++] << (i * 8);
+	return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* packActions
+Compact form of an action list, used instead of the JSON array when
+conf::compactActions is on. A version byte is followed by one record per
+action:
+	flags   1 byte, see PACK_* below
+	type    1 byte
+	frame   zigzag varint, delta from the previous action
+	tick    8 bytes double, only if PACK_TICK (otherwise frame / framesPerTick)
+	fValue  4 bytes float, only if PACK_F_VALUE (otherwise 0.0f)
+	iValue  varint, only if PACK_I_VALUE (otherwise 0)
+The whole buffer is then base64-encoded. Decoding gives back the very same
+values, bit by bit. */
+
+const uint8_t PACK_VERSION = 1;
+const uint8_t PACK_TICK    = 0x01;
+const uint8_t PACK_F_VALUE = 0x02;
+const uint8_t PACK_I_VALUE = 0x04;
+
+string packActions(const vector<action_t>& actions)
+{
+	double fpt = getFramesPerTick();
+
+	vector<uint8_t> out;
+	out.reserve(actions.size() * 8 + 1);
+	out.push_back(PACK_VERSION);
+
+	int64_t prevFrame = 0;
+	for (const action_t& a : actions) {
+		uint32_t fBits;
+		uint64_t tBits;
+		memcpy(&fBits, &a.fValue, sizeof(fBits));
+		memcpy(&tBits, &a.tick, sizeof(tBits));
+
+		uint8_t flags = 0;
+		if (a.tick != a.frame / fpt) flags |= PACK_TICK;
+		if (fBits != 0)              flags |= PACK_F_VALUE;
+		if (a.iValue != 0)           flags |= PACK_I_VALUE;
+
+		int64_t delta = a.frame - prevFrame;
+		prevFrame = a.frame;
+
+		out.push_back(flags);
+		out.push_back(a.type);
+		packVarint(out, (uint64_t) ((delta << 1) ^ (delta >> 63)));
+		if (flags & PACK_TICK)    packRaw(out, tBits, sizeof(tBits));
+		if (flags & PACK_F_VALUE) packRaw(out, fBits, sizeof(fBits));
+		if (flags & PACK_I_VALUE) packVarint(out, a.iValue);
+	}
+	return gu_toBase64(out);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* unpackActions
+Inverse of packActions(). Actions without an explicit tick get tick = -1, then
+modernize() computes it from the frame, exactly as packActions() did. */
+
+bool unpackActions(const string& packed, vector<action_t>& actions)
+{
+	vector<uint8_t> in;
+	if (!gu_fromBase64(packed, in) || in.empty() || in[0] != PACK_VERSION)
+		return false;
+
+	size_t  pos       = 1;
+	int64_t prevFrame = 0;
+	while (pos < in.size()) {
+		if (pos + 2 > in.size())
+			return false;
+		uint8_t flags = in[pos++];
+		action_t a;
+		a.type   = in[pos++];
+		a.tick   = -1.0;
+		a.fValue = 0.0f;
+		a.iValue = 0;
+
+		uint64_t v;
+		if (!unpackVarint(in, pos, v))
+			return false;
+		prevFrame += (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+		a.frame = prevFrame;
+
+		if (flags & PACK_TICK) {
+			if (!unpackRaw(in, pos, v, sizeof(a.tick)))
+				return false;
+			memcpy(&a.tick, &v, sizeof(a.tick));
+		}
+		if (flags & PACK_F_VALUE) {
+			if (!unpackRaw(in, pos, v, sizeof(a.fValue)))
+				return false;
+			uint32_t fBits = v;
+			memcpy(&a.fValue, &fBits, sizeof(a.fValue));
+		}
+		if (flags & PACK_I_VALUE) {
+			if (!unpackVarint(in, pos, v))
+				return false;
+			a.iValue = v;
+		}
+		actions.push_back(a);
+	}
+	return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 /* modernize
@@ -87,6 +277,16 @@ void modernize()
 			for (action_t& a : ch.actions)
 				a.frame /= 2;
 	}
+
+	/* Actions without ticks come from patches saved before tick-based storage:
+	convert their frames using the patch's own clock, computed the same way
+	clock::updateFrameBars() does. */
+
+	double fpt = getFramesPerTick();
+	for (channel_t& ch : channels)
+		for (action_t& a : ch.actions)
+			if (a.tick < 0.0)
+				a.tick = a.frame / fpt;
 }
 
 
@@ -158,6 +358,11 @@ bool readPlugins(json_t* jContainer, vector<plugin_t>* container, const char* ke
 		json_array_foreach(jParams, paramIndex, jParam)
 			plugin.params.push_back(json_real_value(jParam));
 
+		/* read plugin state chunk, if any (older patches don't have it) */
+
+		if (json_object_get(jPlugin, PATCH_KEY_PLUGIN_STATE) != nullptr)
+			if (!storager::setString(jPlugin, PATCH_KEY_PLUGIN_STATE, plugin.state)) return 0;
+
 		/* read midiIn params (midi learning on plugins' parameters) */
 
 		json_t* jMidiInParams = json_object_get(jPlugin, PATCH_KEY_PLUGIN_MIDI_IN_PARAMS);
@@ -180,6 +385,18 @@ bool readPlugins(json_t* jContainer, vector<plugin_t>* container, const char* ke
 
 bool readActions(json_t* jContainer, channel_t* channel)
 {
+	json_t* jPacked = json_object_get(jContainer, PATCH_KEY_CHANNEL_ACTIONS_PACKED);
+	if (jPacked != nullptr) {
+		string packed;
+		if (!storager::setString(jContainer, PATCH_KEY_CHANNEL_ACTIONS_PACKED, packed))
+			return 0;
+		if (!unpackActions(packed, channel->actions)) {
+			gu_log("[patch::readActions] malformed packed actions!\n");
+			return 0;
+		}
+		return 1;
+	}
+
 	json_t* jActions = json_object_get(jContainer, PATCH_KEY_CHANNEL_ACTIONS);
 	if (!storager::checkArray(jActions, PATCH_KEY_CHANNEL_ACTIONS))
 		return 0;
@@ -194,6 +411,9 @@ bool readActions(json_t* jContainer, channel_t* channel)
 		action_t action;
 		if (!storager::setInt   (jAction, PATCH_KEY_ACTION_TYPE,    action.type)) return 0;
 		if (!storager::setInt   (jAction, PATCH_KEY_ACTION_FRAME,   action.frame)) return 0;
+		action.tick = -1.0;  // missing in older patches, see modernize()
+		if (json_object_get(jAction, PATCH_KEY_ACTION_TICK) != nullptr)
+			if (!storager::setDouble(jAction, PATCH_KEY_ACTION_TICK, action.tick)) return 0;
 		if (!storager::setFloat (jAction, PATCH_KEY_ACTION_F_VALUE, action.fValue)) return 0;
 		if (!storager::setUint32(jAction, PATCH_KEY_ACTION_I_VALUE, action.iValue)) return 0;
 		channel->actions.push_back(action);
@@ -312,12 +532,15 @@ void writePlugins(json_t* jContainer, vector<plugin_t>* plugins, const char* key
 		json_object_set_new(jPlugin, PATCH_KEY_PLUGIN_BYPASS, json_boolean(plugin.bypass));
 		json_array_append_new(jPlugins, jPlugin);
 
-		/* plugin params */
+		/* plugin params, always written: older readers and plug-ins that refuse
+		the state chunk rely on them. The state chunk, if any, supersedes them. */
 
 		json_t* jPluginParams = json_array();
 		for (unsigned z=0; z<plugin.params.size(); z++)
 			json_array_append_new(jPluginParams, json_real(plugin.params.at(z)));
 		json_object_set_new(jPlugin, PATCH_KEY_PLUGIN_PARAMS, jPluginParams);
+		if (!plugin.state.empty())
+			json_object_set_new(jPlugin, PATCH_KEY_PLUGIN_STATE, json_string(plugin.state.c_str()));
 
 		/* midiIn params (midi learning on plugins' parameters) */
 
@@ -354,12 +577,19 @@ void writeColumns(json_t* jContainer, vector<column_t>* columns)
 
 void writeActions(json_t*jContainer, vector<action_t>*actions)
 {
+	if (conf::compactActions) {
+		json_object_set_new(jContainer, PATCH_KEY_CHANNEL_ACTIONS_PACKED,
+			json_string(packActions(*actions).c_str()));
+		return;
+	}
+
 	json_t* jActions = json_array();
 	for (unsigned k=0; k<actions->size(); k++) {
 		json_t*  jAction = json_object();
 		action_t action  = actions->at(k);
 		json_object_set_new(jAction, PATCH_KEY_ACTION_TYPE,    json_integer(action.type));
 		json_object_set_new(jAction, PATCH_KEY_ACTION_FRAME,   json_integer(action.frame));
+		json_object_set_new(jAction, PATCH_KEY_ACTION_TICK,    json_real(action.tick));
 		json_object_set_new(jAction, PATCH_KEY_ACTION_F_VALUE, json_real(action.fValue));
 		json_object_set_new(jAction, PATCH_KEY_ACTION_I_VALUE, json_integer(action.iValue));
 		json_array_append_new(jActions, jAction);
@@ -42,6 +42,7 @@ struct action_t
 {
 	int      type;
 	int      frame;
+	double   tick;
 	float    fValue;
 	uint32_t iValue;
 };
@@ -52,6 +53,7 @@ struct plugin_t
 	std::string           path;
 	bool                  bypass;
 	std::vector<float>    params;
+	std::string           state;   // base64 chunk, supersedes params if present
 	std::vector<uint32_t> midiInParams;
 };
 #endif
@@ -0,0 +1,131 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#include <cmath>
+#include "const.h"
+#include "pll.h"
+
+
+namespace giada {
+namespace m
+{
+namespace
+{
+const double PI = 3.14159265358979323846;  // M_PI is not portable
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+Pll::Pll(double bandwidth)
+: m_bandwidth(bandwidth),
+  m_b        (0.0),
+  m_c        (0.0),
+  m_t0       (0.0),
+  m_t1       (0.0),
+  m_period   (0.0),
+  m_count    (0)
+{
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void Pll::reset(double time, double period)
+{
+	double omega = 2.0 * PI * m_bandwidth * period;
+	m_b      = std::sqrt(2.0) * omega;
+	m_c      = omega * omega;
+	m_t0     = time;
+	m_t1     = time + period;
+	m_period = period;
+	m_count  = 1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool Pll::update(double time)
+{
+	if (m_count == 0) {
+		reset(time, m_period > 0.0 ? m_period : 1.0);
+		return true;
+	}
+
+	/* On the second event the period is still unknown: measure it directly. */
+
+	if (m_count == 1) {
+		reset(time, time - m_t0 > 0.0 ? time - m_t0 : m_period);
+		m_count = 2;
+		return true;
+	}
+
+	double err = time - m_t1;
+	if (std::fabs(err) > m_period * G_PLL_MAX_ERROR) {
+		reset(time, m_period);
+		return false;
+	}
+
+	m_t0      = m_t1;
+	m_t1     += m_b * err + m_period;
+	m_period += m_c * err;
+	m_count++;
+	return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+double Pll::getPeriod() const
+{
+	return m_period;
+}
+
+
+double Pll::getTime() const
+{
+	return m_t0;
+}
+
+
+double Pll::getPhase(double time) const
+{
+	return m_period > 0.0 ? (time - m_t0) / m_period : 0.0;
+}
+
+
+bool Pll::isLocked() const
+{
+	return m_count >= G_PLL_LOCK_EVENTS;
+}
+
+}} // giada::m::
@@ -0,0 +1,99 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#ifndef G_PLL_H
+#define G_PLL_H
+
+
+namespace giada {
+namespace m
+{
+/* Pll
+Phase-locked loop that filters the arrival times of a periodic event, such as
+MIDI clock ticks or MTC quarter frames. It is a second order loop (a "delay
+locked loop", see F. Adriaensen, "Using a DLL to filter time"): it estimates
+both the period and the ideal time of the last event, with jitter reduced
+according to the loop bandwidth. All times are in seconds. */
+
+class Pll
+{
+public:
+
+	/* Pll
+	'bandwidth' in Hz: the lower, the smoother (and slower to react). */
+
+	Pll(double bandwidth);
+
+	/* reset
+	Starts over from an event at time 'time', given the expected period. */
+
+	void reset(double time, double period);
+
+	/* update
+	Feeds a new event occurred at time 'time'. Returns false if the event was
+	too far from the expected time (dropout, tempo jump): in that case the loop
+	has been reset. */
+
+	bool update(double time);
+
+	/* getPeriod
+	Returns the filtered period. */
+
+	double getPeriod() const;
+
+	/* getTime
+	Returns the filtered time of the last event. */
+
+	double getTime() const;
+
+	/* getPhase
+	Returns the number of periods elapsed since the last event, at time
+	'time'. */
+
+	double getPhase(double time) const;
+
+	/* isLocked
+	True if enough events have been collected since the last reset to trust the
+	estimates. */
+
+	bool isLocked() const;
+
+private:
+
+	double m_bandwidth;
+	double m_b;       // loop coefficients
+	double m_c;
+	double m_t0;      // filtered time of the last event
+	double m_t1;      // predicted time of the next event
+	double m_period;  // filtered period
+	int    m_count;   // events since the last reset
+};
+
+}} // giada::m::
+
+#endif
@@ -30,6 +30,7 @@
 
 #include <FL/Fl.H>
 #include "../utils/log.h"
+#include "../utils/string.h"
 #include "../utils/time.h"
 #include "const.h"
 #include "plugin.h"
@@ -39,7 +40,7 @@ using std::string;
 using namespace giada::u;
 
 
-int Plugin::idGenerator = 1;
+std::atomic<int> Plugin::idGenerator(1);
 
 
 /* -------------------------------------------------------------------------- */
@@ -50,7 +51,12 @@ Plugin::Plugin(juce::AudioPluginInstance *plugin, double samplerate,
 	: ui    (nullptr),
 		plugin(plugin),
 		id    (idGenerator++),
-		bypass(false)
+		bypass(false),
+		samplerate(samplerate),
+		cpuLoad(0.0f),
+		cpuPeak(0.0f),
+		silentFrames(0),
+		asleep(false)
 {
 	/* Init midiInParams. All values are empty (0x0): they will be filled during
 	midi learning process. */
@@ -184,6 +190,49 @@ bool Plugin::acceptsMidi() const
 /* -------------------------------------------------------------------------- */
 
 
+int Plugin::getLatency() const
+{
+	return plugin->getLatencySamples();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+double Plugin::getTailLength() const
+{
+	return plugin->getTailLengthSeconds();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+std::string Plugin::getState() const
+{
+	juce::MemoryBlock data;
+	plugin->getStateInformation(data);
+	const uint8_t* begin = static_cast<const uint8_t*>(data.getData());
+	return gu_toBase64(std::vector<uint8_t>(begin, begin + data.getSize()));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool Plugin::setState(const std::string& state) const
+{
+	std::vector<uint8_t> data;
+	if (!gu_fromBase64(state, data) || data.empty())
+		return false;
+	plugin->setStateInformation(data.data(), data.size());
+	return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 bool Plugin::isBypassed() const { return bypass; }
 void Plugin::toggleBypass() { bypass = !bypass; }
 void Plugin::setBypass(bool b) { bypass = b; }
@@ -205,7 +254,7 @@ int Plugin::getEditorH() const { return ui->getHeight(); }
 /* -------------------------------------------------------------------------- */
 
 
-void Plugin::process(juce::AudioBuffer<float>& b, juce::MidiBuffer m) const
+void Plugin::process(juce::AudioBuffer<float>& b, juce::MidiBuffer& m) const
 {
 	plugin->processBlock(b, m);
 }
@@ -214,6 +263,29 @@ void Plugin::process(juce::AudioBuffer<float>& b, juce::MidiBuffer m) const
 /* -------------------------------------------------------------------------- */
 
 
+void Plugin::updateCpu(double elapsed, int frames) const
+{
+	/* Time spent over time available for the block. The average is an
+	exponential one, the peak decays a bit on each block. */
+
+	float load = elapsed * samplerate / frames;
+	float avg  = cpuLoad.load(std::memory_order_relaxed);
+	float peak = cpuPeak.load(std::memory_order_relaxed) * G_PLUGIN_CPU_PEAK_DECAY;
+	cpuLoad.store(avg + (load - avg) * G_PLUGIN_CPU_SMOOTHING, std::memory_order_relaxed);
+	cpuPeak.store(load > peak ? load : peak, std::memory_order_relaxed);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+float Plugin::getCpuLoad() const { return cpuLoad.load(std::memory_order_relaxed); }
+float Plugin::getCpuPeak() const { return cpuPeak.load(std::memory_order_relaxed); }
+
+
+/* -------------------------------------------------------------------------- */
+
+
 int Plugin::getNumPrograms() const
 {
 	return plugin->getNumPrograms();
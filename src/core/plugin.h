@@ -33,6 +33,7 @@
 #define G_PLUGIN_H
 
 
+#include <atomic>
 #include "../deps/juce-config.h"
 
 
@@ -40,7 +41,10 @@ class Plugin
 {
 private:
 
-	static int idGenerator;
+	/* idGenerator
+	Atomic: plug-ins may be created by several threads at once. */
+
+	static std::atomic<int> idGenerator;
 
 	juce::AudioProcessorEditor* ui;    // gui
 	juce::AudioPluginInstance* plugin; // core
@@ -48,6 +52,19 @@ private:
 	int id;
 	bool bypass;
 
+	/* samplerate
+	Needed to turn block sizes into time, for the CPU load. */
+
+	double samplerate;
+
+	/* cpuLoad, cpuPeak
+	Share of the block duration spent in process(): rolling average and peak,
+	the latter slowly decaying. Written by whatever thread processes the plug-in,
+	read by the GUI. */
+
+	mutable std::atomic<float> cpuLoad;
+	mutable std::atomic<float> cpuPeak;
+
 public:
 
 	Plugin(juce::AudioPluginInstance* p, double samplerate, int buffersize);
@@ -59,13 +76,13 @@ public:
 	std::string getUniqueId() const;
 
 	/* process
-	Process the plug-in with audio and MIDI data. The audio buffer is a reference:
-	it has to be altered by the plug-in itself. Conversely, the MIDI buffer must
-	be passed by copy: each plug-in must receive its own copy of the event set, so
-	that any attempt to change/clear the MIDI buffer will only modify the local 
-	copy. */
+	Process the plug-in with audio and MIDI data. Both buffers are references and
+	can be altered by the plug-in: each plug-in must receive its own copy of the
+	event set (see pluginHost::processStack), so that any attempt to change/clear
+	the MIDI buffer will only modify that copy. No copy is made here, as copying
+	a juce::MidiBuffer allocates. */
 
-	void process(juce::AudioBuffer<float>& b, juce::MidiBuffer m) const;
+	void process(juce::AudioBuffer<float>& b, juce::MidiBuffer& m) const;
 
 	std::string getName() const;
 	bool isEditorOpen() const;
@@ -88,6 +105,39 @@ public:
 	void setCurrentProgram(int index) const;
 	bool acceptsMidi() const;
 
+	/* getLatency
+	Processing delay introduced by the plug-in, in frames, as reported by the
+	plug-in itself. It may change at any time. */
+
+	int getLatency() const;
+
+	/* getTailLength
+	How long the plug-in keeps producing sound once its input stops, in seconds
+	(infinite for endless tails), as reported by the plug-in itself. */
+
+	double getTailLength() const;
+
+	/* getCpu(Load|Peak)
+	Average and peak CPU share of the plug-in, where 1.0 is the whole time
+	available for an audio block. */
+
+	float getCpuLoad() const;
+	float getCpuPeak() const;
+
+	/* updateCpu
+	Accounts 'elapsed' seconds spent processing an audio block of 'frames'
+	frames, possibly split in several process() calls. Once per block. */
+
+	void updateCpu(double elapsed, int frames) const;
+
+	/* getState, setState
+	Whole plug-in state as an opaque, base64-encoded chunk. It includes internal
+	data not reachable through parameters. setState returns false if the chunk
+	is malformed. */
+
+	std::string getState() const;
+	bool setState(const std::string& state) const;
+
 	void showEditor(void* parent);
 
 	/* closeEditor
@@ -102,6 +152,13 @@ public:
 	A list of midiIn hex values for parameter automation. */
 
 	std::vector<uint32_t> midiInParams;
+
+	/* silentFrames, asleep
+	How long input and output of the plug-in have been silent for, and whether
+	it is skipped because of that. Maintained by pluginHost::processStack(). */
+
+	int silentFrames;
+	std::atomic<bool> asleep;
 };
 
 #endif
@@ -29,6 +29,17 @@
 
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <jansson.h>
 #include "../utils/log.h"
 #include "../utils/fs.h"
 #include "../utils/string.h"
@@ -37,6 +48,14 @@
 #include "resourceChannel.h"
 #include "plugin.h"
 #include "pluginHost.h"
+#include "midiDispatcher.h"
+#include "reclaimer.h"
+#include "mixer.h"
+#include "commands.h"
+#include "queue.h"
+#include "recorder.h"
+#include "clock.h"
+#include "conf.h"
 
 
 using std::vector;
@@ -69,14 +88,78 @@ vector<string> unknownPluginList;
 vector<Plugin*> masterOut;
 vector<Plugin*> masterIn;
 
-/* Audio|MidiBuffer
- * Dynamic buffers. */
-
-juce::AudioBuffer<float> audioBuffer;
-
 int samplerate;
 int buffersize;
 
+/* CacheEntry
+A binary met by a previous scan: modification time and size it had back then,
+plus the plug-ins found inside (none if it's not a plug-in or its probe failed,
+so that broken binaries are not probed again until they change). */
+
+struct CacheEntry
+{
+	juce::int64 mtime;
+	juce::int64 size;
+	vector<juce::PluginDescription> types;
+};
+
+/* scanCache, scanResult, scanner, scan*
+Scan state. scanCache and scanResult belong to the scanner thread while it is
+running, then are read by finishScan() after the join. */
+
+std::map<string, CacheEntry>    scanCache;
+vector<juce::PluginDescription> scanResult;
+std::thread                     scanner;
+std::atomic<bool>               scanRunning(false);
+std::atomic<bool>               scanStopped(false);
+std::atomic<float>              scanProgress(0.0f);
+
+/* Insertion
+A plug-in created by the loader thread, waiting to be appended to the stack of
+channel 'ch'. */
+
+struct Insertion
+{
+	Channel* ch;
+	Plugin*  p;
+};
+
+/* insertQueue, pendingInsertions
+Loader thread -> GUI thread. pendingInsertions counts the plug-ins requested
+and not in a stack yet, the ones still being created included. */
+
+Queue<Insertion, G_PLUGIN_INSERT_QUEUE_SIZE> insertQueue;
+std::atomic<int>                             pendingInsertions(0);
+
+/* LoadRequest, loader*
+Background loader thread for plug-ins added one at a time (see loadPlugin). */
+
+struct LoadRequest
+{
+	string   fid;
+	Channel* ch;
+};
+
+std::thread             loader;
+std::mutex              loaderMutex;
+std::condition_variable loaderCond;
+std::deque<LoadRequest> loaderRequests;
+bool                    loaderStopped;
+
+/* missingMutex
+Plug-ins are created by several threads at once: protects missingPlugins and
+unknownPluginList. */
+
+std::mutex missingMutex;
+
+/* moduleMutex, moduleLocks
+One lock per plug-in binary: some plug-ins don't survive being instantiated by
+two threads at once. Instances of different binaries are still created in
+parallel. moduleMutex protects the map. */
+
+std::mutex                                    moduleMutex;
+std::map<string, std::unique_ptr<std::mutex>> moduleLocks;
+
 /* missingPlugins
  * If some plugins from any stack are missing. */
 
@@ -125,22 +208,423 @@ const juce::PluginDescription* findPluginDescription(const string& id)
 	}
 	return nullptr;
 }
-}; // {anonymous}
+
+/* -------------------------------------------------------------------------- */
+
+
+/* isSilent
+True if every sample in 'b' is below G_PLUGIN_SILENCE. */
+
+bool isSilent(const juce::AudioBuffer<float>& b)
+{
+	for (int j=0; j<b.getNumChannels(); j++)
+		if (b.getMagnitude(j, 0, b.getNumSamples()) > G_PLUGIN_SILENCE)
+			return false;
+	return true;
+}
+
+
+/* updateSleep
+Puts a plug-in to sleep once both its input and its output (i.e. the tail of
+reverbs, delays and the like) have been silent for G_PLUGIN_SLEEP_HOLD ms or
+the tail length declared by the plug-in, whichever is longer, plus the plug-in
+latency. A quiet tail might still be going on. Plug-ins with endless tails never
+sleep. Any input wakes it up: it's processed again from that very block, and
+since its output had decayed there is nothing to click. */
+
+void updateSleep(Plugin* p, bool silentIn, bool silentOut, int frames)
+{
+	if (!silentIn || !silentOut) {
+		p->silentFrames = 0;
+		p->asleep.store(false);
+		return;
+	}
+	double hold = std::max(G_PLUGIN_SLEEP_HOLD / 1000.0, p->getTailLength());
+	if (std::isinf(hold))
+		return;
+	p->silentFrames += frames;
+	if (p->silentFrames >= samplerate * hold + p->getLatency())
+		p->asleep.store(true);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* isAutomated
+True if plug-in at position 'index' in the stack of 'ch' has parameter changes
+scheduled in the current block. */
+
+bool isAutomated(const Channel* ch, int index)
+{
+	for (int i=0; i<ch->paramChangesCount; i++)
+		if (ch->paramChanges[i].plugin == index)
+			return true;
+	return false;
+}
+
+
+/* processAutomated
+Processes plug-in 'p', at position 'index' in the stack of 'ch', over audio
+buffer 'b' with MIDI events 'events'. The block is split at each parameter
+change scheduled for the plug-in, so that changes land on their exact frame.
+Sub-blocks refer to the data of 'b' and to ch->midiScratch: nothing allocates.
+The CPU load of the plug-in is measured over the whole block. */
+
+void processAutomated(Plugin* p, int index, juce::AudioBuffer<float>& b,
+	const juce::MidiBuffer& events, Channel* ch)
+{
+	using namespace std::chrono;
+
+	steady_clock::time_point begin = steady_clock::now();
+
+	int start = 0;
+	for (int i=0; i<=ch->paramChangesCount; i++) {
+		bool last = i == ch->paramChangesCount;
+		if (!last && ch->paramChanges[i].plugin != index)
+			continue;
+
+		int end = last ? b.getNumSamples() : ch->paramChanges[i].frame;
+		if (end > start) {
+			juce::AudioBuffer<float> sub(b.getArrayOfWritePointers(), b.getNumChannels(),
+				start, end - start);
+			ch->midiScratch.clear();
+			ch->midiScratch.addEvents(events, start, end - start, -start);
+			p->process(sub, ch->midiScratch);
+			start = end;
+		}
+		if (!last)
+			p->setParameter(ch->paramChanges[i].param, ch->paramChanges[i].value);
+	}
+
+	p->updateCpu(duration<double>(steady_clock::now() - begin).count(), b.getNumSamples());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+string getCachePath()
+{
+	return gu_getHomePath() + G_SLASH + G_PLUGIN_CACHE_FILE;
+}
+
+
+/* loadCache, saveCache
+Read and write the scan cache from/to disk. An unreadable cache is not an
+error: every binary is simply probed again. */
+
+void loadCache()
+{
+	scanCache.clear();
+
+	juce::XmlElement* root = juce::XmlDocument::parse(juce::File(getCachePath()));
+	if (root == nullptr)
+		return;
+
+	forEachXmlChildElementWithTagName(*root, bin, "BINARY") {
+		CacheEntry& e = scanCache[bin->getStringAttribute("path").toStdString()];
+		e.mtime = bin->getStringAttribute("mtime").getLargeIntValue();
+		e.size  = bin->getStringAttribute("size").getLargeIntValue();
+		forEachXmlChildElement(*bin, type) {
+			juce::PluginDescription pd;
+			if (pd.loadFromXml(*type))
+				e.types.push_back(pd);
+		}
+	}
+	delete root;
+
+	gu_log("[pluginHost::loadCache] %d binaries in scan cache\n", (int) scanCache.size());
+}
+
+
+void saveCache()
+{
+	juce::XmlElement root("PLUGINCACHE");
+	for (const auto& kv : scanCache) {
+		juce::XmlElement* bin = root.createNewChildElement("BINARY");
+		bin->setAttribute("path",  juce::String(kv.first));
+		bin->setAttribute("mtime", juce::String(kv.second.mtime));
+		bin->setAttribute("size",  juce::String(kv.second.size));
+		for (const juce::PluginDescription& pd : kv.second.types)
+			bin->addChildElement(pd.createXml());
+	}
+	if (!root.writeToFile(juce::File(getCachePath()), ""))
+		gu_log("[pluginHost::saveCache] unable to write scan cache!\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* probe(In|Out)Process
+Fill 'types' with the plug-ins found in binary 'path'. The isolated version
+runs 'giada G_PLUGIN_PROBE_ARG path outFile' and reads the result from outFile;
+a probe that crashes or hangs for more than G_PLUGIN_PROBE_TIMEOUT ms just
+finds nothing. */
+
+void probeInProcess(const string& path, vector<juce::PluginDescription>& types)
+{
+	juce::OwnedArray<juce::PluginDescription> found;
+	pluginFormat.findAllTypesForFile(found, juce::String(path));
+	for (const juce::PluginDescription* pd : found)
+		types.push_back(*pd);
+}
+
+
+void probeOutProcess(const string& path, vector<juce::PluginDescription>& types)
+{
+	juce::File outFile = juce::File::createTempFile(".xml");
+
+	juce::StringArray args;
+	args.add(juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName());
+	args.add(G_PLUGIN_PROBE_ARG);
+	args.add(juce::String(path));
+	args.add(outFile.getFullPathName());
+
+	juce::ChildProcess probe;
+	if (!probe.start(args)) {
+		gu_log("[pluginHost::probeOutProcess] unable to start probe process!\n");
+		return;
+	}
+	if (!probe.waitForProcessToFinish(G_PLUGIN_PROBE_TIMEOUT)) {
+		probe.kill();
+		gu_log("[pluginHost::probeOutProcess] '%s' timed out, skipped\n", path.c_str());
+	}
+	else
+	if (probe.getExitCode() != 0)
+		gu_log("[pluginHost::probeOutProcess] '%s' failed or crashed, skipped\n", path.c_str());
+	else {
+		juce::XmlElement* root = juce::XmlDocument::parse(outFile);
+		if (root != nullptr) {
+			forEachXmlChildElement(*root, type) {
+				juce::PluginDescription pd;
+				if (pd.loadFromXml(*type))
+					types.push_back(pd);
+			}
+			delete root;
+		}
+	}
+	outFile.deleteFile();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* scan
+Body of the scanner thread. Binaries unchanged since the last scan are taken
+from the cache, the others are probed. Disappeared binaries drop out of the
+cache. */
+
+void scan(vector<string> dirs, bool isolated)
+{
+	loadCache();
+
+	juce::FileSearchPath searchPath;
+	for (const string& dir : dirs)
+		searchPath.add(juce::File(dir));
+
+	juce::StringArray files = pluginFormat.searchPathsForPlugins(searchPath, true); // true: recursive
+
+	std::map<string, CacheEntry> fresh;
+	int probed = 0;
+	for (int i=0; i<files.size() && !scanStopped.load(); i++) {
+		string      path  = files[i].toStdString();
+		juce::File  file(files[i]);
+		juce::int64 mtime = file.getLastModificationTime().toMilliseconds();
+		juce::int64 size  = file.getSize();
+
+		auto cached = scanCache.find(path);
+		if (cached != scanCache.end() && cached->second.mtime == mtime &&
+		    cached->second.size == size) {
+			fresh[path] = cached->second;
+		}
+		else {
+			gu_log("[pluginHost::scan]   probing '%s'\n", path.c_str());
+			CacheEntry& e = fresh[path];
+			e.mtime = mtime;
+			e.size  = size;
+			if (isolated)
+				probeOutProcess(path, e.types);
+			else
+				probeInProcess(path, e.types);
+			probed++;
+		}
+		scanProgress.store((i + 1) / (float) files.size());
+	}
+
+	/* An interrupted scan is incomplete: keep the old cache on disk. */
+
+	scanResult.clear();
+	if (!scanStopped.load()) {
+		scanCache.swap(fresh);
+		saveCache();
+		for (const auto& kv : scanCache)
+			for (const juce::PluginDescription& pd : kv.second.types)
+				scanResult.push_back(pd);
+	}
+
+	gu_log("[pluginHost::scan] %d binaries, %d probed, %d plugin(s) found\n",
+		files.size(), probed, (int) scanResult.size());
+
+	scanProgress.store(1.0f);
+	scanRunning.store(false);
+}
 
 
 /* -------------------------------------------------------------------------- */
+
+
+/* getModuleLock
+Lock of plug-in binary 'file', created on first use. */
+
+std::mutex& getModuleLock(const string& file)
+{
+	std::lock_guard<std::mutex> lock(moduleMutex);
+	std::unique_ptr<std::mutex>& m = moduleLocks[file];
+	if (!m)
+		m.reset(new std::mutex());
+	return *m;
+}
+
+
+/* createPlugin
+Finds plug-in 'fid' among the known ones and creates a prepared instance of it.
+Safe from any thread, instances of the same binary are created one at a time.
+The default mode uses getTypeForIdentifierString, falling back to
+getTypeForFile (deprecated) for old patches (< 0.14.4). */
+
+Plugin* createPlugin(const string& fid)
+{
+	const juce::PluginDescription* pd = findPluginDescription(fid);
+	if (pd == nullptr) {
+		gu_log("[pluginHost::createPlugin] no plugin found with fid=%s! Trying with "
+			"deprecated mode...\n", fid.c_str());
+		pd = knownPluginList.getTypeForFile(fid);
+		if (pd == nullptr) {
+			gu_log("[pluginHost::createPlugin] still nothing to do, returning unknown plugin\n");
+			std::lock_guard<std::mutex> lock(missingMutex);
+			missingPlugins = true;
+			unknownPluginList.push_back(fid);
+			return nullptr;
+		}
+	}
+
+	juce::AudioPluginInstance* pi;
+	{
+		std::lock_guard<std::mutex> lock(getModuleLock(pd->fileOrIdentifier.toStdString()));
+		pi = pluginFormat.createInstanceFromDescription(*pd, samplerate, buffersize);
+	}
+	if (!pi) {
+		gu_log("[pluginHost::createPlugin] unable to create instance with fid=%s!\n", fid.c_str());
+		std::lock_guard<std::mutex> lock(missingMutex);
+		missingPlugins = true;
+		return nullptr;
+	}
+	gu_log("[pluginHost::createPlugin] plugin instance with fid=%s created\n", fid.c_str());
+
+	return new Plugin(pi, samplerate, buffersize);
+}
+
+
 /* -------------------------------------------------------------------------- */
+
+
+/* publish
+Replaces the stack of 'ch' with 'stack' and retires the old one: the audio
+thread and the workers might still be processing it. GUI thread only. */
+
+void publish(Channel* ch, vector<Plugin*>* stack)
+{
+	reclaimer::retire(ch->plugins.exchange(stack));
+}
+
+
+/* handOver
+Passes a plug-in created by the loader thread to the GUI thread. The queue is
+full only if the GUI is late: just retry. */
+
+void handOver(Channel* ch, Plugin* p)
+{
+	while (!insertQueue.push({ ch, p }))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+
+/* waitInsertions
+Waits until every plug-in requested so far has reached its stack, publishing
+them along the way. Call it before removing channels, so that no insertion
+targets a dead channel. GUI thread only. */
+
+void waitInsertions()
+{
+	while (pendingInsertions.load() > 0) {
+		processInsertions();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 
-pthread_mutex_t mutex_midi;
+/* load
+Body of the loader thread. */
+
+void load()
+{
+	std::unique_lock<std::mutex> lock(loaderMutex);
+	while (true) {
+		loaderCond.wait(lock, [] { return loaderStopped || !loaderRequests.empty(); });
+		if (loaderStopped)
+			return;
+		LoadRequest r = loaderRequests.front();
+		loaderRequests.pop_front();
+		lock.unlock();
+
+		Plugin* p = createPlugin(r.fid);
+		if (p != nullptr)
+			handOver(r.ch, p);
+		else
+			pendingInsertions--;
+
+		lock.lock();
+	}
+}
+}; // {anonymous}
 
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
 
 void close()
 {
+	if (isScanning()) {
+		scanStopped.store(true);
+		scanner.join();
+	}
+
+	/* Stop the loader. Requests not served yet are dropped, plug-ins never
+	inserted are deleted. */
+
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		loaderStopped = true;
+		pendingInsertions -= (int) loaderRequests.size();
+		loaderRequests.clear();
+	}
+	loaderCond.notify_one();
+	loader.join();
+
+	Insertion ins;
+	while (insertQueue.pop(ins)) {
+		delete ins.p;
+		pendingInsertions--;
+	}
+
 	messageManager->deleteInstance();
 }
 
@@ -151,14 +635,14 @@ void close()
 void init(int buffersize_, int samplerate_)
 {
 	messageManager = juce::MessageManager::getInstance();
-	audioBuffer.setSize(G_OUT_CHANS, buffersize_);
 	samplerate = samplerate_;
 	buffersize = buffersize_;
 	missingPlugins = false;
 	//unknownPluginList.empty();
 	loadList(gu_getHomePath() + G_SLASH + "plugins.xml");
 
-	pthread_mutex_init(&mutex_midi, nullptr);
+	loaderStopped = false;
+	loader = std::thread(load);
 
 	gu_log("[pluginHost::init] initialized with buffersize=%d, samplerate=%d\n",
 	buffersize, samplerate);
@@ -168,31 +652,66 @@ void init(int buffersize_, int samplerate_)
 /* -------------------------------------------------------------------------- */
 
 
-int scanDirs(const string& dirs, const std::function<void(float)>& cb)
+bool startScan(const string& dirs, bool isolated)
 {
-	gu_log("[pluginHost::scanDir] requested directories: '%s'\n", dirs.c_str());
-	gu_log("[pluginHost::scanDir] current plugins: %d\n", knownPluginList.getNumTypes());
+	if (isScanning()) {
+		gu_log("[pluginHost::startScan] scan already in progress\n");
+		return false;
+	}
 
-	knownPluginList.clear();   // clear up previous plugins
+	gu_log("[pluginHost::startScan] requested directories: '%s' (isolated=%d)\n",
+		dirs.c_str(), isolated);
 
 	vector<string> dirVec;
 	gu_split(dirs, ";", &dirVec);
 
-	juce::VSTPluginFormat format;
-	juce::FileSearchPath searchPath;
-	for (const string& dir : dirVec)
-		searchPath.add(juce::File(dir));
+	scanProgress.store(0.0f);
+	scanStopped.store(false);
+	scanRunning.store(true);
+	scanner = std::thread(scan, dirVec, isolated);
+	return true;
+}
 
-	juce::PluginDirectoryScanner scanner(knownPluginList, format, searchPath,
-		true, juce::File::nonexistent); // true: recursive
 
-	juce::String name;
-	while (scanner.scanNextFile(false, name)) {
-		gu_log("[pluginHost::scanDir]   scanning '%s'\n", name.toRawUTF8());
-		cb(scanner.getProgress());
-	}
+/* -------------------------------------------------------------------------- */
+
+
+bool isScanning()
+{
+	return scanner.joinable();
+}
+
 
-	gu_log("[pluginHost::scanDir] %d plugin(s) found\n", knownPluginList.getNumTypes());
+bool isScanDone()
+{
+	return isScanning() && !scanRunning.load();
+}
+
+
+float getScanProgress()
+{
+	return scanProgress.load();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int finishScan()
+{
+	if (!isScanning())
+		return countAvailablePlugins();
+
+	scanner.join();
+	if (scanStopped.load())
+		return countAvailablePlugins();
+
+	knownPluginList.clear();
+	for (const juce::PluginDescription& pd : scanResult)
+		knownPluginList.addType(pd);
+	scanResult.clear();
+
+	gu_log("[pluginHost::finishScan] %d plugin(s) found\n", knownPluginList.getNumTypes());
 	return knownPluginList.getNumTypes();
 }
 
@@ -200,6 +719,24 @@ int scanDirs(const string& dirs, const std::function<void(float)>& cb)
 /* -------------------------------------------------------------------------- */
 
 
+int probePlugin(const string& path, const string& outPath)
+{
+	juce::ScopedJuceInitialiser_GUI juceInit;
+
+	juce::OwnedArray<juce::PluginDescription> found;
+	pluginFormat.findAllTypesForFile(found, juce::String(path));
+
+	juce::XmlElement xml("PLUGINS");
+	for (const juce::PluginDescription* pd : found)
+		xml.addChildElement(pd->createXml());
+
+	return xml.writeToFile(juce::File(outPath), "") ? 0 : 1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 int saveList(const string& filepath)
 {
 	int out = knownPluginList.createXml()->writeToFile(juce::File(filepath), "");
@@ -227,68 +764,126 @@ int loadList(const string& filepath)
 /* -------------------------------------------------------------------------- */
 
 
-Plugin* addPlugin(const string& fid, pthread_mutex_t* mutex,
-	Channel* ch)
+void loadPlugin(int index, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
-
-	/* Initialize plugin. The default mode uses getTypeForIdentifierString,
-	falling back to  getTypeForFile (deprecated) for old patches (< 0.14.4). */
-
-	const juce::PluginDescription* pd = findPluginDescription(fid);
+	juce::PluginDescription* pd = knownPluginList.getType(index);
 	if (pd == nullptr) {
-		gu_log("[pluginHost::addPlugin] no plugin found with fid=%s! Trying with "
-			"deprecated mode...\n", fid.c_str());
-		pd = knownPluginList.getTypeForFile(fid);
-		if (pd == nullptr) {
-			gu_log("[pluginHost::addPlugin] still nothing to do, returning unknown plugin\n");
-			missingPlugins = true;
-			unknownPluginList.push_back(fid);
-			return nullptr;
-		}
+		gu_log("[pluginHost::loadPlugin] no plugins found at index=%d!\n", index);
+		return;
 	}
+	gu_log("[pluginHost::loadPlugin] plugin found, uid=%s, name=%s...\n",
+		pd->createIdentifierString().toRawUTF8(), pd->name.toRawUTF8());
 
-	juce::AudioPluginInstance* pi = pluginFormat.createInstanceFromDescription(*pd, samplerate, buffersize);
-	if (!pi) {
-		gu_log("[pluginHost::addPlugin] unable to create instance with fid=%s!\n", fid.c_str());
-		missingPlugins = true;
-		return nullptr;
+	pendingInsertions++;
+	{
+		std::lock_guard<std::mutex> lock(loaderMutex);
+		loaderRequests.push_back({ pd->createIdentifierString().toStdString(), ch });
 	}
-	gu_log("[pluginHost::addPlugin] plugin instance with fid=%s created\n", fid.c_str());
+	loaderCond.notify_one();
+}
 
-	Plugin* p = new Plugin(pi, samplerate, buffersize);
 
-	/* Try to inject the plugin as soon as possible. */
+/* -------------------------------------------------------------------------- */
 
-	while (true) {
-		if (pthread_mutex_trylock(mutex) != 0)
-			continue;
-		pStack->push_back(p);
-		pthread_mutex_unlock(mutex);
-		break;
+
+int addPlugins(const vector<StackRequest>& requests)
+{
+	/* All stacks go in a single list of jobs. Workers pick the next one from a
+	shared index. Slots are filled in place, so that the stack order doesn't
+	depend on which plug-in takes longer to load. */
+
+	struct Job
+	{
+		const StackRequest* r;
+		int                 index;
+		Plugin*             p;
+	};
+
+	vector<Job> jobs;
+	for (const StackRequest& r : requests)
+		for (unsigned i=0; i<r.fids.size(); i++)
+			jobs.push_back({ &r, (int) i, nullptr });
+
+	std::atomic<int> next(0);
+
+	auto work = [&] () {
+		for (int i=next++; i<(int) jobs.size(); i=next++) {
+			Job& j = jobs[i];
+			j.p = createPlugin(j.r->fids[j.index]);
+			if (j.p != nullptr && j.r->setup)
+				j.r->setup(j.p, j.index);
+		}
+	};
+
+	unsigned count = std::min<unsigned>(jobs.size(), std::max(1u, std::thread::hardware_concurrency()));
+	vector<std::thread> workers;
+	for (unsigned i=1; i<count; i++)
+		workers.emplace_back(work);
+	work();
+	for (std::thread& t : workers)
+		t.join();
+
+	/* Plug-ins that failed leave no slot: the ones after them move down. Parameter
+	actions refer to plug-ins by stack position, so they are remapped the same
+	way, the failed plug-ins' ones being dropped. */
+
+	int      failed = 0;
+	unsigned j      = 0;
+	for (const StackRequest& r : requests) {
+		vector<Plugin*>* stack = new vector<Plugin*>(r.ch->getPlugins());
+		vector<int> map(stack->size());
+		for (unsigned i=0; i<map.size(); i++)
+			map[i] = i;
+		bool shifted = false;
+		for (unsigned i=0; i<r.fids.size(); i++, j++)
+			if (jobs[j].p != nullptr) {
+				map.push_back(stack->size());
+				stack->push_back(jobs[j].p);
+			}
+			else {
+				map.push_back(-1);
+				shifted = true;
+				failed++;
+			}
+
+		pthread_mutex_lock(&mixer::mutex_recs);
+		if (shifted)
+			recorder::remapParams(r.ch->index, map);
+		publish(r.ch, stack);
+		pthread_mutex_unlock(&mixer::mutex_recs);
+
+		if (shifted)
+			r.ch->hasActions = recorder::hasActions(r.ch->index);
 	}
 
-	gu_log("[pluginHost::addPlugin] channel=%d, plugin id=%s loaded (%s), stack size=%d\n",
-		ch->index, fid.c_str(), p->getName().c_str(), pStack->size());
+	gu_log("[pluginHost::addPlugins] %d stack(s), %d plugin(s) created, %d failed\n",
+		(int) requests.size(), (int) jobs.size() - failed, failed);
 
-	return p;
+	if (failed < (int) jobs.size())
+		commands::notify(commands::PLUGINS_CHANGED);
+	return failed;
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-Plugin* addPlugin(int index, pthread_mutex_t* mutex,
-	Channel* ch)
+void processInsertions()
 {
-	juce::PluginDescription* pd = knownPluginList.getType(index);
-	if (pd) {
-		gu_log("[pluginHost::addPlugin] plugin found, uid=%s, name=%s...\n",
-			pd->createIdentifierString().toRawUTF8(), pd->name.toRawUTF8());
-		return addPlugin(pd->createIdentifierString().toStdString(), mutex, ch);
+	Insertion ins;
+	bool      inserted = false;
+	while (insertQueue.pop(ins)) {
+		vector<Plugin*>* stack = new vector<Plugin*>(ins.ch->getPlugins());
+		stack->push_back(ins.p);
+		publish(ins.ch, stack);
+		pendingInsertions--;
+		inserted = true;
 	}
-	gu_log("[pluginHost::addPlugin] no plugins found at index=%d!\n", index);
-	return nullptr;
+
+	/* The dispatch table and the plug-in list are rebuilt on notification. */
+
+	if (inserted)
+		commands::notify(commands::PLUGINS_CHANGED);
 }
 
 
@@ -297,7 +892,53 @@ Plugin* addPlugin(int index, pthread_mutex_t* mutex,
 
 unsigned countPlugins(Channel* ch)
 {
-	return ch->plugins.size();
+	return ch->getPlugins().size();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int writeMetrics(const string& path, const vector<Channel*>& channels)
+{
+	json_t* jPlugins = json_array();
+	for (const Channel* ch : channels)
+		for (const Plugin* p : ch->getPlugins()) {
+			json_t* jPlugin = json_object();
+			json_object_set_new(jPlugin, "channel",  json_integer(ch->index));
+			json_object_set_new(jPlugin, "id",       json_integer(p->getId()));
+			json_object_set_new(jPlugin, "name",     json_string(p->getName().c_str()));
+			json_object_set_new(jPlugin, "bypassed", json_boolean(p->isBypassed()));
+			json_object_set_new(jPlugin, "asleep",   json_boolean(p->asleep.load()));
+			json_object_set_new(jPlugin, "latency",  json_integer(p->getLatency()));
+			json_object_set_new(jPlugin, "cpu_avg",  json_real(p->getCpuLoad()));
+			json_object_set_new(jPlugin, "cpu_peak", json_real(p->getCpuPeak()));
+			json_array_append_new(jPlugins, jPlugin);
+		}
+
+	json_t* jRoot = json_object();
+	json_object_set_new(jRoot, "samplerate", json_integer(samplerate));
+	json_object_set_new(jRoot, "buffersize", json_integer(buffersize));
+	json_object_set_new(jRoot, "plugins",    jPlugins);
+
+	int out = json_dump_file(jRoot, path.c_str(), JSON_INDENT(2)) == 0;
+	json_decref(jRoot);
+	if (!out)
+		gu_log("[pluginHost::writeMetrics] unable to write metrics to %s\n", path.c_str());
+	return out;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int getStackLatency(Channel* ch)
+{
+	int latency = 0;
+	for (const Plugin* plugin : ch->getPlugins())
+		if (!plugin->isSuspended() && !plugin->isBypassed())
+			latency += plugin->getLatency();
+	return latency;
 }
 
 
@@ -357,22 +998,22 @@ string getUnknownPluginInfo(int i)
 /* -------------------------------------------------------------------------- */
 
 
-void freeStack(pthread_mutex_t* mutex, Channel* ch)
+void freeStack(Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
+	waitInsertions();
 
-	if (pStack->size() == 0)
+	if (ch->getPlugins().size() == 0)
 		return;
 
-	while (true) {
-		if (pthread_mutex_trylock(mutex) != 0)
-			continue;
-		for (unsigned i=0; i<pStack->size(); i++)
-			delete pStack->at(i);
-		pStack->clear();
-		pthread_mutex_unlock(mutex);
-		break;
-	}
+	vector<Plugin*> old(ch->getPlugins());
+	publish(ch, new vector<Plugin*>());
+	midiDispatcher::rebuild();
+
+	/* The audio thread and the old dispatch table might still point to them. */
+
+	for (Plugin* p : old)
+		reclaimer::retire(p);
+
 	gu_log("[pluginHost::freeStack] channel=%d freed\n", ch->index);
 }
 
@@ -382,12 +1023,27 @@ void freeStack(pthread_mutex_t* mutex, Channel* ch)
 
 void processStack(AudioBuffer& out, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
+	const vector<Plugin*>& stack = ch->getPlugins();
 
-	/* Empty stack, stack not found or mixer not ready: do nothing. */
+	/* Empty stack or mixer not ready: do nothing, just drop pending MIDI events
+	so that the channel buffer doesn't grow. */
 
-	if (pStack == nullptr || pStack->size() == 0)
+	if (stack.size() == 0) {
+		ch->clearMidiBuffer();
+		ch->clearParamChanges();
 		return;
+	}
+
+	/* The stack was swapped after this block's parameter changes came in: their
+	positions might point to other plug-ins now. Drop them. */
+
+	if (ch->paramChangesCount > 0 && ch->paramStack != &stack)
+		ch->clearParamChanges();
+
+	/* Work on the channel's own buffers: stacks of different channels may be
+	processed at the same time by the worker pool. */
+
+	juce::AudioBuffer<float>& audioBuffer = ch->pluginBuffer;
 
 	assert(out.countFrames() == audioBuffer.getNumSamples());
 
@@ -409,43 +1065,50 @@ void processStack(AudioBuffer& out, Channel* ch)
 					audioBuffer.setSample(j, i, out[i][j]);
 
 	/* Hardcore processing. At the end we swap input and output, so that he N-th
-	plugin will process the result of the plugin N-1. Part of this loop must be
-	guarded by mutexes, i.e. the MIDI process part. You definitely don't want
-	a situation like the following one:
-		this::processStack()
-		[a new midi event comes in from kernelMidi thread]
-		channel::clearMidiBuffer()
-	The midi event in between would be surely lost, deleted by the last call to
-	channel::clearMidiBuffer()! */
-
-	if (ch != nullptr)
-		pthread_mutex_lock(&mutex_midi);
-
-	for (const Plugin* plugin : *pStack) {
+	plugin will process the result of the plugin N-1. No locking needed for the
+	channel MIDI buffer: incoming MIDI events are added by the audio thread too,
+	at the beginning of the block (see midiDispatcher::processInput).
+	Plug-ins asleep (see updateSleep) are skipped as long as their input, audio or
+	MIDI, stays silent: their output would be silence too. Automation wakes them
+	up as well. Each plug-in is processed by processAutomated(), which splits the
+	block at the plug-in's parameter changes, if any. */
+
+	for (unsigned k=0; k<stack.size(); k++) {
+		Plugin* plugin = stack.at(k);
 		if (plugin->isSuspended() || plugin->isBypassed())
 			continue;
+		bool automated = isAutomated(ch, k);
 
 		/* If this is a Channel (ch != nullptr) and the current plugin is an
 		instrument (i.e. accepts MIDI), don't let it fill the current audio buffer:
-		create a new temporary one instead and then merge the result into the main
-		one when done. This way each plug-in generates its own audio data and we can
-		play more than one plug-in instrument in the same stack, driven by the same
-		set of MIDI events. */
+		render into the instrument scratch buffer instead and then merge the result
+		into the main one when done (vectorized add). This way each plug-in
+		generates its own audio data and we can play more than one plug-in
+		instrument in the same stack, driven by the same set of MIDI events. */
 
 		if (ch != nullptr && plugin->acceptsMidi()) {
-			juce::AudioBuffer<float> tmp(audioBuffer.getNumChannels(), buffersize);
-			plugin->process(tmp, ch->getPluginMidiEvents());
-			for (int i=0; i<audioBuffer.getNumSamples(); i++)
-				for (int j=0; j<audioBuffer.getNumChannels(); j++)
-					audioBuffer.addSample(j, i, tmp.getSample(j, i));
+			bool silentIn = ch->getPluginMidiEvents().isEmpty() && !automated;
+			if (plugin->asleep.load() && silentIn)
+				continue;
+			ch->instrumentBuffer.clear();
+			processAutomated(plugin, k, ch->instrumentBuffer, ch->getPluginMidiEvents(), ch);
+			for (int j=0; j<audioBuffer.getNumChannels(); j++)
+				audioBuffer.addFrom(j, 0, ch->instrumentBuffer, j, 0, audioBuffer.getNumSamples());
+			updateSleep(plugin, silentIn, isSilent(ch->instrumentBuffer), audioBuffer.getNumSamples());
+		}
+		else {
+			bool silentIn = isSilent(audioBuffer) && !automated;
+			if (plugin->asleep.load() && silentIn)
+				continue;
+			ch->emptyMidiBuffer.clear();
+			processAutomated(plugin, k, audioBuffer, ch->emptyMidiBuffer, ch);
+			updateSleep(plugin, silentIn, isSilent(audioBuffer), audioBuffer.getNumSamples());
 		}
-		else
-			plugin->process(audioBuffer, juce::MidiBuffer()); // Empty MIDI buffer
 	}
 
 	if (ch != nullptr) {
 		ch->clearMidiBuffer();
-		pthread_mutex_unlock(&mutex_midi);
+		ch->clearParamChanges();
 	}
 
 	/* Converting buffer from Juce to Giada. A note for the future: if we
@@ -464,14 +1127,33 @@ void processStack(AudioBuffer& out, Channel* ch)
 /* -------------------------------------------------------------------------- */
 
 
+void captureParameter(const Channel* ch, const Plugin* p, int index, float value)
+{
+	if (!recorder::active || !clock::isRunning())
+		return;
+	if (ch->type != G_CHANNEL_SAMPLE && ch->type != G_CHANNEL_MIDI)
+		return;
+
+	const vector<Plugin*>& stack = ch->getPlugins();
+	for (unsigned k=0; k<stack.size(); k++) {
+		if (stack.at(k) != p)
+			continue;
+		recorder::capture(ch->index, G_ACTION_PARAM, clock::getCurrentFrame(),
+			recorder::paramKey(k, index), value);  // Drops are counted by the recorder
+		return;
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 Plugin* getPluginByIndex(int index, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
-	if (pStack->size() == 0)
+	const vector<Plugin*>& stack = ch->getPlugins();
+	if (index < 0 || (unsigned) index >= stack.size())
 		return nullptr;
-	if ((unsigned) index >= pStack->size())
-		return nullptr;
-	return pStack->at(index);
+	return stack.at(index);
 }
 
 
@@ -480,9 +1162,9 @@ Plugin* getPluginByIndex(int index, Channel* ch)
 
 int getPluginIndex(int id, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
-	for (unsigned i=0; i<pStack->size(); i++)
-		if (pStack->at(i)->getId() == id)
+	const vector<Plugin*>& stack = ch->getPlugins();
+	for (unsigned i=0; i<stack.size(); i++)
+		if (stack.at(i)->getId() == id)
 			return i;
 	return -1;
 }
@@ -491,40 +1173,60 @@ int getPluginIndex(int id, Channel* ch)
 /* -------------------------------------------------------------------------- */
 
 
-void swapPlugin(unsigned indexA, unsigned indexB,
-	pthread_mutex_t* mutex, Channel* ch)
+void swapPlugin(unsigned indexA, unsigned indexB, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
-	while (true) {
-		if (pthread_mutex_trylock(mutex) != 0)
-			continue;
-		std::swap(pStack->at(indexA), pStack->at(indexB));
-		pthread_mutex_unlock(mutex);
-		gu_log("[pluginHost::swapPlugin] plugin at index %d and %d swapped\n", indexA, indexB);
-		return;
-	}
+	vector<Plugin*>* stack = new vector<Plugin*>(ch->getPlugins());
+	std::swap(stack->at(indexA), stack->at(indexB));
+
+	/* Parameter actions refer to plug-ins by stack position: remap them and
+	publish the new stack together, so that no action is read in between. */
+
+	vector<int> map(stack->size());
+	for (unsigned i=0; i<map.size(); i++)
+		map[i] = i;
+	std::swap(map.at(indexA), map.at(indexB));
+
+	pthread_mutex_lock(&mixer::mutex_recs);
+	recorder::remapParams(ch->index, map);
+	publish(ch, stack);
+	pthread_mutex_unlock(&mixer::mutex_recs);
+
+	gu_log("[pluginHost::swapPlugin] plugin at index %d and %d swapped\n", indexA, indexB);
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-int freePlugin(int id, pthread_mutex_t* mutex, Channel* ch)
+int freePlugin(int id, Channel* ch)
 {
-	vector<Plugin*>* pStack = &ch->plugins;
-	for (unsigned i=0; i<pStack->size(); i++) {
-		Plugin *pPlugin = pStack->at(i);
+	const vector<Plugin*>& current = ch->getPlugins();
+	for (unsigned i=0; i<current.size(); i++) {
+		Plugin* pPlugin = current.at(i);
 		if (pPlugin->getId() != id)
 			continue;
-		while (true) {
-			if (pthread_mutex_trylock(mutex) != 0)
-				continue;
-			delete pPlugin;
-			pStack->erase(pStack->begin() + i);
-			pthread_mutex_unlock(mutex);
-			gu_log("[pluginHost::freePlugin] plugin id=%d removed\n", id);
-			return i;
-		}
+		vector<Plugin*>* stack = new vector<Plugin*>(current);
+		stack->erase(stack->begin() + i);
+
+		/* Parameter actions refer to plug-ins by stack position: drop the ones of
+		this plug-in, shift the ones above it. Remap and publish together, so that
+		no action is read in between. */
+
+		vector<int> map(stack->size() + 1);
+		for (unsigned j=0; j<map.size(); j++)
+			map[j] = j < i ? j : j == i ? -1 : j - 1;
+
+		pthread_mutex_lock(&mixer::mutex_recs);
+		recorder::remapParams(ch->index, map);
+		publish(ch, stack);  // 'current' is retired from now on
+		pthread_mutex_unlock(&mixer::mutex_recs);
+
+		midiDispatcher::rebuild();
+		ch->hasActions = recorder::hasActions(ch->index);
+
+		reclaimer::retire(pPlugin);  // the audio thread and the old dispatch table might still use it
+		gu_log("[pluginHost::freePlugin] plugin id=%d removed\n", id);
+		return i;
 	}
 	gu_log("[pluginHost::freePlugin] plugin id=%d not found\n", id);
 	return -1;
@@ -544,10 +1246,10 @@ void runDispatchLoop()
 /* -------------------------------------------------------------------------- */
 
 
-void freeAllStacks(vector<Channel*>* channels, pthread_mutex_t* mutex)
+void freeAllStacks(vector<Channel*>* channels)
 {
 	for (unsigned i=0; i<channels->size(); i++)
-		freeStack(mutex, channels->at(i));
+		freeStack(channels->at(i));
 	missingPlugins = false;
 	unknownPluginList.clear();
 }
@@ -556,18 +1258,22 @@ void freeAllStacks(vector<Channel*>* channels, pthread_mutex_t* mutex)
 /* -------------------------------------------------------------------------- */
 
 
-int clonePlugin(Plugin* src, pthread_mutex_t* mutex,
-	Channel* ch)
+int clonePlugin(Plugin* src, Channel* ch)
 {
-	Plugin* p = addPlugin(src->getUniqueId(), mutex, ch);
+	Plugin* p = createPlugin(src->getUniqueId());
 	if (!p) {
 		gu_log("[pluginHost::clonePlugin] unable to add new plugin to stack!\n");
 		return 0;
 	}
 
-	for (int k=0; k<src->getNumParameters(); k++)
-		p->setParameter(k, src->getParameter(k));
+	if (!p->setState(src->getState()))
+		for (int k=0; k<src->getNumParameters(); k++)
+			p->setParameter(k, src->getParameter(k));
 
+	vector<Plugin*>* stack = new vector<Plugin*>(ch->getPlugins());
+	stack->push_back(p);
+	publish(ch, stack);
+	commands::notify(commands::PLUGINS_CHANGED);
 	return 1;
 }
 
@@ -608,7 +1314,7 @@ void sortPlugins(int method)
 
 void forEachPlugin(const Channel* ch, std::function<void(const Plugin* p)> f)
 {
-	for (const Plugin* p : ch->plugins)
+	for (const Plugin* p : ch->getPlugins())
 		f(p);
 }
 
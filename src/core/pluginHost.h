@@ -32,7 +32,7 @@
 
 
 #include <functional>
-#include <pthread.h>
+#include <vector>
 #include "../deps/juce-config.h"
 #include "audioBuffer.h"
 
@@ -54,6 +54,19 @@ enum sortMethod
 	FORMAT
 };
 
+/* StackRequest
+Plug-ins to add to channel 'ch': unique ids 'fids', in stack order. 'setup' is
+called on each plug-in created, together with its index in 'fids', before the
+plug-in is published: nobody else sees it yet, so it can be configured
+freely. */
+
+struct StackRequest
+{
+	Channel*                                  ch;
+	std::vector<std::string>                  fids;
+	std::function<void(Plugin* p, int index)> setup;
+};
+
 struct PluginInfo
 {
 	std::string uid;
@@ -64,17 +77,45 @@ struct PluginInfo
 	bool isInstrument;
 };
 
-extern pthread_mutex_t mutex_midi;
-
 void init(int bufSize, int samplerate);
 void close();
 
-/* scanDirs
-Parses plugin directories (semicolon-separated) and store list in
-knownPluginList. The callback is called on each plugin found. Used to update the
-main window from the GUI thread. */
+/* startScan
+Starts scanning plugin directories (semicolon-separated) in a background
+thread. Only new or changed binaries are probed: the others come from the scan
+cache, keyed by path, modification time and size. If 'isolated' each binary is
+probed by a child process, so that a crashing plug-in can't take Giada down.
+Returns false if a scan is already in progress. */
+
+bool startScan(const std::string& paths, bool isolated);
+
+/* isScanning
+True from startScan() until finishScan(). */
+
+bool isScanning();
+
+/* isScanDone
+True when the background scan has completed and its result is waiting for
+finishScan(). */
+
+bool isScanDone();
+
+/* getScanProgress
+Progress of the current scan, from 0.0 to 1.0. */
+
+float getScanProgress();
+
+/* finishScan
+Waits for the background scan and replaces knownPluginList with its result.
+Call it from the main thread. Returns the number of plug-ins found. */
 
-int scanDirs(const std::string& paths, const std::function<void(float)>& cb);
+int finishScan();
+
+/* probePlugin
+Entry point of the child process spawned by isolated scans: writes the plug-ins
+found in binary 'path' to XML file 'outPath'. Returns the process exit code. */
+
+int probePlugin(const std::string& path, const std::string& outPath);
 
 /* (save|load)List
  * (Save|Load) knownPluginList (in|from) an XML file. */
@@ -82,24 +123,47 @@ int scanDirs(const std::string& paths, const std::function<void(float)>& cb);
 int saveList(const std::string& path);
 int loadList(const std::string& path);
 
-/* addPlugin
- * Add a new plugin to stack by unique id or by index in knownPluginList
- * std::vector. Requires:
- * fid - plugin unique file id (i.e. path to dynamic library)
- * mutex - Mixer.mutex_plugin
- * freq - current audio frequency
- * bufSize - buffer size */
+/* loadPlugin
+Creates plug-in at 'index' in knownPluginList on the background loader thread,
+then hands it over to the GUI thread, which appends it to the channel's stack
+on the next refresh (see processInsertions). Never blocks: requests are served
+in order. */
+
+void loadPlugin(int index, Channel* ch);
+
+/* addPlugins
+Creates the plug-ins of all 'requests' in parallel, stacks of different
+channels included, and appends them to their stacks in order. Instances of the
+same binary are created one at a time; setups (state restore) run in parallel.
+Blocks until done. GUI thread only. Returns the number of plug-ins that
+couldn't be created: their parameter actions are dropped, the ones of the
+plug-ins after them follow the shifted positions. */
+
+int addPlugins(const std::vector<StackRequest>& requests);
+
+/* processInsertions
+Appends plug-ins handed over by loadPlugin to their stacks. GUI thread only,
+on each refresh. */
 
-Plugin* addPlugin(const std::string& fid, pthread_mutex_t* mutex,
-	Channel* ch=nullptr);
-Plugin *addPlugin(int index, pthread_mutex_t* mutex,
-	Channel* ch=nullptr);
+void processInsertions();
 
 /* countPlugins
  * Return size of channel's stack. */
 
 unsigned countPlugins(Channel* ch=nullptr);
 
+/* getStackLatency
+Sum of the latencies of the plug-ins actually processed in the channel's stack
+(suspended and bypassed ones are skipped). Cheap enough for the audio thread. */
+
+int getStackLatency(Channel* ch);
+
+/* writeMetrics
+Dumps CPU load and latency of every plug-in in 'channels' to a JSON file.
+Returns 1 on success. */
+
+int writeMetrics(const std::string& path, const std::vector<Channel*>& channels);
+
 /* countAvailablePlugins
  * Return size of knownPluginList. */
 
@@ -121,13 +185,20 @@ std::string getUnknownPluginInfo(int index);
 /* freeStack
  * free channel's plugin stack. */
 
-void freeStack(pthread_mutex_t* mutex, Channel* ch=nullptr);
+void freeStack(Channel* ch=nullptr);
 
 /* processStack
 Applies the fx list to the buffer. */
 
 void processStack(AudioBuffer& buffer, Channel* ch=nullptr);
 
+/* captureParameter
+Records the move of parameter 'index' of plug-in 'p' in channel 'ch' as a
+G_ACTION_PARAM action at the current frame, if action recording is on. Never
+blocks nor allocates: the action goes through recorder::capture(). */
+
+void captureParameter(const Channel* ch, const Plugin* p, int index, float value);
+
 /* getPluginByIndex */
 
 Plugin* getPluginByIndex(int index, Channel* ch=nullptr);
@@ -138,14 +209,12 @@ int getPluginIndex(int id, Channel* ch=nullptr);
 
 /* swapPlugin */
 
-void swapPlugin(unsigned indexA, unsigned indexB,
-	pthread_mutex_t* mutex, Channel* ch=nullptr);
+void swapPlugin(unsigned indexA, unsigned indexB, Channel* ch=nullptr);
 
 /* freePlugin.
 Returns the internal stack index of the deleted plugin. */
 
-int freePlugin(int id, pthread_mutex_t *mutex,
-	Channel* ch=nullptr);
+int freePlugin(int id, Channel* ch=nullptr);
 
 /* runDispatchLoop
  * Wakes up plugins' GUI manager for N milliseconds. */
@@ -155,11 +224,13 @@ void runDispatchLoop();
 /* freeAllStacks
  * Frees everything. */
 
-void freeAllStacks(std::vector<Channel*>* channels, pthread_mutex_t* mutex);
+void freeAllStacks(std::vector<Channel*>* channels);
 
-/* clonePlugin */
+/* clonePlugin
+Adds a copy of 'src', state included, to channel 'ch'. Blocks until the copy is
+created. */
 
-int clonePlugin(Plugin* src, pthread_mutex_t* mutex, Channel* ch);
+int clonePlugin(Plugin* src, Channel* ch);
 
 /* doesPluginExist */
 
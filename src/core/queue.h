@@ -0,0 +1,136 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#ifndef G_QUEUE_H
+#define G_QUEUE_H
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace giada {
+namespace m
+{
+/* Queue
+Lock-free bounded queue of 'N' elements of type 'T', safe with any number of
+producers and consumers. Each cell carries a sequence number telling whether it
+is ready to be written or read (Dmitry Vyukov's bounded MPMC queue). push() and
+pop() never block nor allocate, so they can be used from the audio thread: they
+just return false when the queue is full or empty. 'N' must be a power of two. */
+
+template<typename T, size_t N>
+class Queue
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "Queue size must be a power of two");
+
+public:
+
+	Queue()
+	: m_head(0),
+	  m_tail(0)
+	{
+		for (size_t i=0; i<N; i++)
+			m_cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	Queue(const Queue&) = delete;
+	Queue& operator=(const Queue&) = delete;
+
+	/* push
+	Adds a copy of 't' to the queue. Returns false if the queue is full. */
+
+	bool push(const T& t)
+	{
+		size_t pos = m_tail.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = m_cells[pos & (N - 1)];
+			size_t seq = cell.seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+			if (diff == 0) {
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.data = t;
+					cell.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else
+			if (diff < 0)
+				return false;
+			else
+				pos = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	/* pop
+	Moves the oldest element into 't'. Returns false if the queue is empty. */
+
+	bool pop(T& t)
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = m_cells[pos & (N - 1)];
+			size_t seq = cell.seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+			if (diff == 0) {
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					t = cell.data;
+					cell.seq.store(pos + N, std::memory_order_release);
+					return true;
+				}
+			}
+			else
+			if (diff < 0)
+				return false;
+			else
+				pos = m_head.load(std::memory_order_relaxed);
+		}
+	}
+
+private:
+
+	struct Cell
+	{
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	Cell m_cells[N];
+
+	/* m_head, m_tail
+	Read and write positions, kept on separate cache lines so that producers and
+	consumers don't fight over the same one. */
+
+	alignas(64) std::atomic<size_t> m_head;
+	alignas(64) std::atomic<size_t> m_tail;
+};
+
+}} // giada::m::
+
+#endif
@@ -0,0 +1,236 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <limits>
+#ifdef __APPLE__  // our Clang still doesn't know about cstdint (c++11 stuff)
+	#include <stdint.h>
+#else
+	#include <cstdint>
+#endif
+#include "../utils/time.h"
+#include "const.h"
+#include "reclaimer.h"
+
+
+using std::vector;
+
+
+namespace giada {
+namespace m {
+namespace reclaimer
+{
+namespace
+{
+/* Slot
+A reading thread. 'epoch' is the global epoch read when its outermost section
+began, or 0 if it's not reading right now. */
+
+struct Slot
+{
+	std::atomic<bool>     taken;
+	std::atomic<uint64_t> epoch;
+};
+
+/* Garbage
+A deleter, waiting for the readers older than 'epoch' to go. */
+
+struct Garbage
+{
+	uint64_t              epoch;
+	std::function<void()> f;
+};
+
+/* ThreadState
+Slot owned by the current thread and nesting depth of its read sections. The
+slot is given back when the thread exits. */
+
+struct ThreadState
+{
+	int slot  = -1;
+	int depth = 0;
+
+	~ThreadState();
+};
+
+Slot slots[G_RECLAIMER_READERS];
+
+std::atomic<uint64_t> epoch(1);
+
+std::mutex      garbageMutex;
+vector<Garbage> garbage;
+
+thread_local ThreadState state;
+
+
+/* -------------------------------------------------------------------------- */
+
+
+ThreadState::~ThreadState()
+{
+	if (slot != -1)
+		slots[slot].taken.store(false);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* claimSlot
+Takes a free slot for the current thread. Threads that read are few and long
+lived: running out of slots means G_RECLAIMER_READERS is too small, wait for
+another thread to exit rather than reading unprotected. */
+
+int claimSlot()
+{
+	while (true) {
+		for (int i=0; i<G_RECLAIMER_READERS; i++) {
+			bool taken = false;
+			if (slots[i].taken.compare_exchange_strong(taken, true))
+				return i;
+		}
+		std::this_thread::yield();
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* getOldestReader
+Epoch of the oldest read section still open, or the largest possible value if
+nobody is reading. */
+
+uint64_t getOldestReader()
+{
+	uint64_t oldest = std::numeric_limits<uint64_t>::max();
+	for (Slot& s : slots) {
+		uint64_t e = s.epoch.load();
+		if (e != 0 && e < oldest)
+			oldest = e;
+	}
+	return oldest;
+}
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+
+Reader::Reader()
+{
+	if (state.depth++ > 0)
+		return;
+	if (state.slot == -1)
+		state.slot = claimSlot();
+
+	/* Sequentially consistent store: the epoch must be visible before the
+	thread reads any shared pointer, or a writer might free what it's about to
+	see. */
+
+	slots[state.slot].epoch.store(epoch.load());
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+Reader::~Reader()
+{
+	if (--state.depth > 0)
+		return;
+	slots[state.slot].epoch.store(0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void retire(std::function<void()> f)
+{
+	/* Readers that begin from now on get the new epoch: they can't see the data
+	unpublished before this call. */
+
+	uint64_t e = epoch.fetch_add(1) + 1;
+	{
+		std::lock_guard<std::mutex> lock(garbageMutex);
+		garbage.push_back({ e, f });
+	}
+	collect();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void synchronize()
+{
+	uint64_t e = epoch.fetch_add(1) + 1;
+	while (getOldestReader() < e)
+		u::time::sleep(1);
+	collect();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void collect()
+{
+	/* Deleters run with the mutex released: they may retire something else in
+	turn. */
+
+	vector<Garbage> ready;
+	{
+		std::lock_guard<std::mutex> lock(garbageMutex);
+		uint64_t oldest = getOldestReader();
+		for (unsigned i=0; i<garbage.size();) {
+			if (garbage[i].epoch <= oldest) {
+				ready.push_back(garbage[i]);
+				garbage.erase(garbage.begin() + i);
+			}
+			else
+				i++;
+		}
+	}
+	for (Garbage& g : ready)
+		g.f();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int countPending()
+{
+	std::lock_guard<std::mutex> lock(garbageMutex);
+	return garbage.size();
+}
+}}}; // giada::m::reclaimer::
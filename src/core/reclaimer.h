@@ -0,0 +1,90 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#ifndef G_RECLAIMER_H
+#define G_RECLAIMER_H
+
+
+#include <functional>
+
+
+namespace giada {
+namespace m {
+namespace reclaimer
+{
+/* Reader
+Read section over data shared by pointer swap. While a Reader is alive on a
+thread, nothing that was retired after it began is deleted. Constructing and
+destroying one never blocks nor allocates, so it is fine for the audio thread
+and for MIDI threads. Sections can be nested. Up to G_RECLAIMER_READERS threads
+may read at once. */
+
+class Reader
+{
+public:
+
+	Reader();
+	~Reader();
+
+	Reader(const Reader&) = delete;
+	Reader& operator=(const Reader&) = delete;
+};
+
+/* retire
+Runs 'f' (usually a delete) once every Reader alive at the time of the call has
+gone, i.e. when nobody can still see the data it frees. Call it right after
+the data has been unpublished. Never call it from a read section. */
+
+void retire(std::function<void()> f);
+
+template<typename T>
+void retire(T* p)
+{
+	retire([p] { delete p; });
+}
+
+/* synchronize
+Blocks until every Reader alive at the time of the call has gone. For objects
+that must be destroyed on the spot, e.g. channels and plug-ins. */
+
+void synchronize();
+
+/* collect
+Runs the retired deleters that are safe to run by now. Called periodically by
+the GUI refresh, and by retire() itself. */
+
+void collect();
+
+/* countPending
+Number of deleters still waiting for their readers. */
+
+int countPending();
+
+}}}; // giada::m::reclaimer::
+
+
+#endif
@@ -27,13 +27,19 @@
 
 #include <cassert>
 #include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <set>
 #include "../utils/log.h"
 #include "const.h"
+#include "queue.h"
+#include "reclaimer.h"
 #include "sampleChannel.h"
 #include "recorder.h"
 
 
 using std::vector;
+using std::map;
 
 
 namespace giada {
@@ -48,6 +54,234 @@ process. */
 
 Composite cmp;
 
+/* envelopes
+Volume envelopes compiled from G_ACTION_VOLUME actions, one per channel. They
+are rebuilt by compileEnvelopes() each time an edit is done and the action list
+has changed (envelopesReady == false), then published by pointer swap: the
+audio thread only reads them, never waits nor allocates. */
+
+typedef map<int, vector<Segment>> Envelopes;
+
+std::atomic<const Envelopes*> envelopes(nullptr);
+bool envelopesReady = false;
+
+/* clockFrames, clockBeats, framesPerTick
+Clock parameters the frame cache has been built with. Until the first call to
+updateClock() a tick lasts exactly one frame. Written with the mixer mutex
+held, as the audio thread checks them in forEachActionAt(). */
+
+int    clockFrames   = 0;
+int    clockBeats    = 0;
+double framesPerTick = 1.0;
+
+/* Captured
+An entry of the capture queue: a plain action to record or one of the two
+halves of an overdub. 'extra' is the buffer size for OVERDUB_START and the
+total frames for OVERDUB_STOP. */
+
+enum { CAPTURE_REC = 0, CAPTURE_OVERDUB_START, CAPTURE_OVERDUB_STOP };
+
+struct Captured
+{
+	int      op;
+	action   a;
+	unsigned extra;
+};
+
+/* captureQueue, dropped
+Entries waiting to be replayed by flushCaptured(), any thread -> main thread.
+Entries that don't fit are counted, so that the GUI can tell. */
+
+Queue<Captured, G_ACTION_CAPTURE_QUEUE_SIZE> captureQueue;
+std::atomic<int> dropped(0);
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool enqueue(int op, int chan, int type, int frame, uint32_t iValue, float fValue,
+	unsigned extra)
+{
+	Captured c;
+	c.op       = op;
+	c.a.chan   = chan;
+	c.a.type   = type;
+	c.a.frame  = frame;
+	c.a.tick   = 0.0;  // computed by rec()
+	c.a.iValue = iValue;
+	c.a.fValue = fValue;
+	c.extra    = extra;
+	if (captureQueue.push(c))
+		return true;
+	dropped++;
+	return false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int tickToFrame(double tick)
+{
+	return (int) std::round(tick * framesPerTick);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* pushAction
+Stores a new action in the frame stack. Both positions are given: 'frame' is
+the cached one, 'tick' the actual one. */
+
+void pushAction(int index, int type, int frame, double tick, uint32_t iValue,
+	float fValue)
+{
+	/* allocating the action */
+
+	action* a = (action*) malloc(sizeof(action));
+	a->chan   = index;
+	a->type   = type;
+	a->frame  = frame;
+	a->tick   = tick;
+	a->iValue = iValue;
+	a->fValue = fValue;
+
+	/* check if the frame exists in the stack. If it exists, we don't extend
+	 * the stack, but we add (or push) a new action to it. */
+
+	int frameToExpand = frames.size();
+	for (int i=0; i<frameToExpand; i++)
+		if (frames.at(i) == frame) {
+			frameToExpand = i;
+			break;
+		}
+
+	/* espansione dello stack frames nel caso l'azione ricada in frame
+	 * non precedentemente memorizzati (frameToExpand == frames.size()).
+	 * Espandere frames è facile, basta aggiungere un frame in coda.
+	 * Espandere global è più complesso: bisogna prima allocare una
+	 * cella in global (per renderlo parallelo a frames) e poi
+	 * inizializzare il suo sub-stack (di action). */
+
+	if (frameToExpand == (int) frames.size()) {
+		frames.push_back(frame);
+		global.push_back(vector<action*>());     // array of actions added
+		global.at(global.size()-1).push_back(a); // action added
+	}
+	else {
+
+		/* no duplicates, please */
+
+		for (unsigned t=0; t<global.at(frameToExpand).size(); t++) {
+			action* ac = global.at(frameToExpand).at(t);
+			if (ac->chan   == index  &&
+			    ac->type   == type   &&
+			    ac->frame  == frame  &&
+			    ac->iValue == iValue &&
+			    ac->fValue == fValue) {
+				free(a);
+				return;
+			}
+		}
+
+		global.at(frameToExpand).push_back(a);		// expand array
+	}
+
+	sortedActions  = false;
+	envelopesReady = false;
+
+	gu_log("[recorder::rec] action recorded, type=%d frame=%d tick=%f chan=%d iValue=%d (0x%X) fValue=%f\n",
+		a->type, a->frame, a->tick, a->chan, a->iValue, a->iValue, a->fValue);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* rebuildFrames
+Recomputes the frame of each action from its tick for a loop of 'framesInLoop'
+frames and 'beats' beats, and regroups the frame stack accordingly, new actions
+'extra' included. Actions that fall on the same frame are merged into the same
+group, as rec() would do. The new stack is built aside: the mixer mutex, if
+any, is held only to write the new frames and clock and swap the stacks. */
+
+void rebuildFrames(int framesInLoop, int beats, pthread_mutex_t* mixerMutex,
+	const vector<action*>& extra=vector<action*>())
+{
+	vector<action*> all(extra);
+	for (const vector<action*>& acts : global)
+		all.insert(all.end(), acts.begin(), acts.end());
+
+	std::stable_sort(all.begin(), all.end(), [](const action* a, const action* b) {
+		return a->tick < b->tick;
+	});
+
+	vector<int> newFrames;
+	vector<vector<action*>> newGlobal;
+	for (action* a : all) {
+		int frame = toFrame(a->tick, framesInLoop, beats);
+		if (newFrames.empty() || newFrames.back() != frame) {
+			newFrames.push_back(frame);
+			newGlobal.push_back(vector<action*>());
+		}
+		newGlobal.back().push_back(a);
+	}
+
+	if (mixerMutex != nullptr)
+		pthread_mutex_lock(mixerMutex);
+	for (unsigned i=0; i<newGlobal.size(); i++)
+		for (action* a : newGlobal.at(i))
+			a->frame = newFrames.at(i);
+	frames.swap(newFrames);
+	global.swap(newGlobal);
+	clockFrames   = framesInLoop;
+	clockBeats    = beats;
+	framesPerTick = framesInLoop / (double) (beats * G_PPQ);
+	if (mixerMutex != nullptr)
+		pthread_mutex_unlock(mixerMutex);
+
+	sortedActions  = true;
+	envelopesReady = false;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* compileEnvelopes
+Turns volume actions into piecewise-linear segments. Requires sorted actions.
+Each segment ramps towards the next point; the last one holds its value. Points
+past the end of the loop are left out. The new envelopes replace the published
+ones, which are freed as soon as the audio thread is done with them. */
+
+void compileEnvelopes()
+{
+	map<int, vector<const action*>> points;
+	for (unsigned i=0; i<global.size(); i++)
+		for (const action* a : global.at(i))
+			if (a->type == G_ACTION_VOLUME && (clockBeats == 0 || a->tick < clockBeats * G_PPQ))
+				points[a->chan].push_back(a);
+
+	Envelopes* out = new Envelopes();
+	for (const auto& kv : points) {
+		const vector<const action*>& p = kv.second;
+		vector<Segment>& env = (*out)[kv.first];
+		env.reserve(p.size());
+		for (unsigned i=0; i<p.size(); i++) {
+			Segment seg = { p.at(i)->tick, p.at(i)->fValue, 0.0f };
+			if (i < p.size() - 1 && p.at(i+1)->tick != seg.tick)
+				seg.delta = ((p.at(i+1)->fValue - seg.value) / (p.at(i+1)->tick - seg.tick)) * 1.003f;
+			env.push_back(seg);
+		}
+	}
+
+	const Envelopes* old = envelopes.exchange(out);
+	if (old != nullptr)
+		reclaimer::retire(old);
+	envelopesReady = true;
+}
+
 
 /* -------------------------------------------------------------------------- */
 
@@ -70,6 +304,22 @@ void fixOverdubTruncation(const Composite& comp, pthread_mutex_t* mixerMutex)
   deleteAction(next->chan, next->frame, next->type, false, mixerMutex);
 }
 
+
+/* -------------------------------------------------------------------------- */
+
+
+/* recLocked
+Same as rec(), with the mixer mutex held if any. */
+
+void recLocked(int index, int type, int frame, pthread_mutex_t* mixerMutex)
+{
+	if (mixerMutex != nullptr)
+		pthread_mutex_lock(mixerMutex);
+	rec(index, type, frame);
+	if (mixerMutex != nullptr)
+		pthread_mutex_unlock(mixerMutex);
+}
+
 }; // {anonymous}
 
 
@@ -80,7 +330,6 @@ void fixOverdubTruncation(const Composite& comp, pthread_mutex_t* mixerMutex)
 
 vector<int> frames;
 vector<vector<action*>> global;
-vector<action*> actions;     // used internally
 
 bool active = false;
 bool sortedActions = false;
@@ -93,6 +342,9 @@ void init()
 {
 	active = false;
   sortedActions = false;
+	clockFrames   = 0;
+	clockBeats    = 0;
+	framesPerTick = 1.0;
 	clearAll();
 }
 
@@ -123,59 +375,16 @@ bool canRec(Channel* ch, bool clockRunning, bool mixerRecording)
 
 void rec(int index, int type, int frame, uint32_t iValue, float fValue)
 {
-	/* allocating the action */
-
-	action* a = (action*) malloc(sizeof(action));
-	a->chan   = index;
-	a->type   = type;
-	a->frame  = frame;
-	a->iValue = iValue;
-	a->fValue = fValue;
-
-	/* check if the frame exists in the stack. If it exists, we don't extend
-	 * the stack, but we add (or push) a new action to it. */
-
-	int frameToExpand = frames.size();
-	for (int i=0; i<frameToExpand; i++)
-		if (frames.at(i) == frame) {
-			frameToExpand = i;
-			break;
-		}
-
-	/* espansione dello stack frames nel caso l'azione ricada in frame
-	 * non precedentemente memorizzati (frameToExpand == frames.size()).
-	 * Espandere frames è facile, basta aggiungere un frame in coda.
-	 * Espandere global è più complesso: bisogna prima allocare una
-	 * cella in global (per renderlo parallelo a frames) e poi
-	 * inizializzare il suo sub-stack (di action). */
-
-	if (frameToExpand == (int) frames.size()) {
-		frames.push_back(frame);
-		global.push_back(actions);               // array of actions added
-		global.at(global.size()-1).push_back(a); // action added
-	}
-	else {
+	pushAction(index, type, frame, frame / framesPerTick, iValue, fValue);
+}
 
-		/* no duplicates, please */
 
-		for (unsigned t=0; t<global.at(frameToExpand).size(); t++) {
-			action* ac = global.at(frameToExpand).at(t);
-			if (ac->chan   == index  &&
-			    ac->type   == type   &&
-			    ac->frame  == frame  &&
-			    ac->iValue == iValue &&
-			    ac->fValue == fValue)
-				return;
-		}
-
-		global.at(frameToExpand).push_back(a);		// expand array
-	}
+/* -------------------------------------------------------------------------- */
 
-	sortedActions = false;
 
-	gu_log("[recorder::rec] action recorded, type=%d frame=%d chan=%d iValue=%d (0x%X) fValue=%f\n",
-		a->type, a->frame, a->chan, a->iValue, a->iValue, a->fValue);
-	//print();
+void recTick(int index, int type, double tick, uint32_t iValue, float fValue)
+{
+	pushAction(index, type, tickToFrame(tick), tick, iValue, fValue);
 }
 
 
@@ -199,6 +408,7 @@ void clearChan(int index)
 				j++;
 		}
 	}
+	envelopesReady = false;
 	optimize();
 	//print();
 }
@@ -207,7 +417,7 @@ void clearChan(int index)
 /* -------------------------------------------------------------------------- */
 
 
-void clearAction(int index, char act)
+void clearAction(int index, int act)
 {
 	gu_log("[recorder::clearAction] clearing action %d from chan %d...\n", act, index);
 	for (unsigned i=0; i<global.size(); i++) {						// for each frame i
@@ -224,6 +434,7 @@ void clearAction(int index, char act)
 				j++;
 		}
 	}
+	envelopesReady = false;
 	optimize();
 	//print();
 }
@@ -232,7 +443,7 @@ void clearAction(int index, char act)
 /* -------------------------------------------------------------------------- */
 
 
-void deleteAction(int chan, int frame, char type, bool checkValues,
+void deleteAction(int chan, int frame, int type, bool checkValues,
 	pthread_mutex_t* mixerMutex, uint32_t iValue, float fValue)
 {
 	/* find the frame 'frame' */
@@ -271,6 +482,7 @@ void deleteAction(int chan, int frame, char type, bool checkValues,
 		}
 	}
 	if (found) {
+		envelopesReady = false;
 		optimize();
 		gu_log("[recorder::deleteAction] action deleted, type=%d frame=%d chan=%d iValue=%d (%X) fValue=%f\n",
 			type, frame, chan, iValue, iValue, fValue);
@@ -284,7 +496,7 @@ void deleteAction(int chan, int frame, char type, bool checkValues,
 /* -------------------------------------------------------------------------- */
 
 
-void deleteActions(int chan, int frame_a, int frame_b, char type,
+void deleteActions(int chan, int frame_a, int frame_b, int type,
   pthread_mutex_t* mixerMutex)
 {
 	sortActions();
@@ -314,6 +526,8 @@ void clearAll()
 	}
 	global.clear();
 	frames.clear();
+	envelopesReady = false;
+	sortActions();
 }
 
 
@@ -326,7 +540,7 @@ void optimize()
 
 	unsigned i = 0;
 	while (true) {
-		if (i == global.size()) return;
+		if (i == global.size()) break;
 		if (global.at(i).size() == 0) {
 			global.erase(global.begin() + i);
 			frames.erase(frames.begin() + i);
@@ -344,15 +558,17 @@ void optimize()
 
 void sortActions()
 {
-	if (sortedActions)
-		return;
-	for (unsigned i=0; i<frames.size(); i++)
-		for (unsigned j=0; j<frames.size(); j++)
-			if (frames.at(j) > frames.at(i)) {
-				std::swap(frames.at(j), frames.at(i));
-				std::swap(global.at(j), global.at(i));
-			}
-	sortedActions = true;
+	if (!sortedActions) {
+		for (unsigned i=0; i<frames.size(); i++)
+			for (unsigned j=0; j<frames.size(); j++)
+				if (frames.at(j) > frames.at(i)) {
+					std::swap(frames.at(j), frames.at(i));
+					std::swap(global.at(j), global.at(i));
+				}
+		sortedActions = true;
+	}
+	if (!envelopesReady)
+		compileEnvelopes();
 	//print();
 }
 
@@ -360,131 +576,92 @@ void sortActions()
 /* -------------------------------------------------------------------------- */
 
 
-void updateBpm(float oldval, float newval, int oldquanto)
+void updateClock(int framesInLoop, int beats, pthread_mutex_t* mixerMutex)
 {
-	for (unsigned i=0; i<frames.size(); i++) {
-
-		float frame  = ((float) frames.at(i)/newval) * oldval;
-		frames.at(i) = (int) frame;
-
-		/* the division up here cannot be precise. A new frame can be 44099
-		 * and the quantizer set to 44100. That would mean two recs completely
-		 * useless. So we compute a reject value ('scarto'): if it's lower
-		 * than 6 frames the new frame is collapsed with a quantized frame. */
-		/** XXX - maybe 6 frames are too low */
-
-		if (frames.at(i) != 0) {
-			int scarto = oldquanto % frames.at(i);
-			if (scarto > 0 && scarto <= 6)
-				frames.at(i) = frames.at(i) + scarto;
-		}
-	}
-
-	/* update structs */
+	if (beats <= 0 || (framesInLoop == clockFrames && beats == clockBeats))
+		return;
 
-	for (unsigned i=0; i<frames.size(); i++) {
-		for (unsigned j=0; j<global.at(i).size(); j++) {
-			action* a = global.at(i).at(j);
-			a->frame = frames.at(i);
-		}
-	}
+	rebuildFrames(framesInLoop, beats, mixerMutex);
+	sortActions();  // envelopes follow the new loop end
 
-	//print();
+	gu_log("[recorder::updateClock] frame cache rebuilt, framesPerTick=%f\n",
+		framesPerTick);
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void updateSamplerate(int systemRate, int patchRate)
+void expand(int oldBeats, int newBeats, pthread_mutex_t* mixerMutex)
 {
-	/* diff ratio: systemRate / patchRate
-	 * e.g.  44100 / 96000 = 0.4... */
-
-	if (systemRate == patchRate)
+	if (oldBeats <= 0 || newBeats <= oldBeats)
 		return;
 
-	gu_log("[recorder::updateSamplerate] systemRate (%d) != patchRate (%d), converting...\n", systemRate, patchRate);
+	/* Channels with actions past the old end had them recorded on a longer loop
+	that was shrunk later: growing the loop back brings them back, no copies are
+	made for such channels. */
 
-	float ratio = systemRate / (float) patchRate;
-	for (unsigned i=0; i<frames.size(); i++) {
+	std::set<int> restored;
+	for (const vector<action*>& acts : global)
+		for (const action* a : acts)
+			if (a->tick >= oldBeats * G_PPQ)
+				restored.insert(a->chan);
 
-		gu_log("[recorder::updateSamplerate]    oldFrame = %d", frames.at(i));
+	/* The copies are made aside and merged in by rebuildFrames(), which holds
+	the mixer mutex only to swap the new frame stack in. */
 
-		float newFrame = frames.at(i);
-		newFrame = floorf(newFrame * ratio);
-
-		frames.at(i) = (int) newFrame;
-
-		gu_log(", newFrame = %d\n", frames.at(i));
-	}
-
-	/* update structs */
-
-	for (unsigned i=0; i<frames.size(); i++) {
-		for (unsigned j=0; j<global.at(i).size(); j++) {
-			action* a = global.at(i).at(j);
-			a->frame = frames.at(i);
+	vector<action*> copies;
+	for (const vector<action*>& acts : global)
+		for (const action* a : acts) {
+			if (a->tick >= oldBeats * G_PPQ || restored.count(a->chan) > 0)
+				continue;
+			for (int z=1; z*oldBeats<newBeats; z++) {
+				double tick = a->tick + (double) oldBeats * G_PPQ * z;
+				if (tick >= newBeats * G_PPQ)
+					break;
+				action* c = (action*) malloc(sizeof(action));
+				*c = *a;
+				c->tick = tick;
+				copies.push_back(c);
+			}
 		}
-	}
-}
-
-
-/* -------------------------------------------------------------------------- */
 
+	rebuildFrames(clockFrames, clockBeats, mixerMutex, copies);
+	sortActions();
 
-void expand(int old_fpb, int new_fpb)
-{
-	/* this algorithm requires multiple passages if we expand from e.g. 2
-	 * to 16 beats, precisely 16 / 2 - 1 = 7 times (-1 is the first group,
-	 * which exists yet). If we expand by a non-multiple, the result is zero,
-	 * due to float->int implicit cast */
-
-	unsigned pass = (int) (new_fpb / old_fpb) - 1;
-	if (pass == 0) pass = 1;
-
-	unsigned init_fs = frames.size();
-
-	for (unsigned z=1; z<=pass; z++) {
-		for (unsigned i=0; i<init_fs; i++) {
-			unsigned newframe = frames.at(i) + (old_fpb*z);
-			frames.push_back(newframe);
-			global.push_back(actions);
-			for (unsigned k=0; k<global.at(i).size(); k++) {
-				action* a = global.at(i).at(k);
-				rec(a->chan, a->type, newframe, a->iValue, a->fValue);
-			}
-		}
-	}
-	gu_log("[recorder::expand] expanded recs\n");
-	//print();
+	gu_log("[recorder::expand] expanded recs, %d actions added\n", (int) copies.size());
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void shrink(int new_fpb)
+void remapParams(int chan, const vector<int>& map, pthread_mutex_t* mixerMutex)
 {
-	/* easier than expand(): here we delete eveything beyond old_framesPerBars. */
-
-	unsigned i=0;
-	while (true) {
-		if (i == frames.size()) break;
-
-		if (frames.at(i) >= new_fpb) {
-			for (unsigned k=0; k<global.at(i).size(); k++)
-				free(global.at(i).at(k));		      // free action
-			global.at(i).clear();								// free action container
-			global.erase(global.begin() + i);   // shrink global
-			frames.erase(frames.begin() + i);   // shrink frames
+	if (mixerMutex != nullptr)
+		pthread_mutex_lock(mixerMutex);
+	for (vector<action*>& acts : global) {
+		unsigned k=0;
+		while (k < acts.size()) {
+			action* a = acts.at(k);
+			int plugin = getParamPlugin(a->iValue);
+			if (a->chan != chan || a->type != G_ACTION_PARAM || plugin >= (int) map.size()) {
+				k++;
+				continue;
+			}
+			if (map.at(plugin) == -1) {
+				free(a);
+				acts.erase(acts.begin() + k);
+				continue;
+			}
+			a->iValue = paramKey(map.at(plugin), getParamIndex(a->iValue));
+			k++;
 		}
-		else
-			i++;
 	}
+	envelopesReady = false;
 	optimize();
-	gu_log("[recorder::shrink] shrinked recs\n");
-	//print();
+	if (mixerMutex != nullptr)
+		pthread_mutex_unlock(mixerMutex);
 }
 
 
@@ -508,7 +685,7 @@ bool hasActions(int chanIndex)
 /* -------------------------------------------------------------------------- */
 
 
-int getNextAction(int chan, char type, int fromFrame, action** out,
+int getNextAction(int chan, int type, int fromFrame, action** out,
 	uint32_t iValue, uint32_t mask)
 {
 	sortActions();  // mandatory
@@ -553,7 +730,7 @@ int getNextAction(int chan, char type, int fromFrame, action** out,
 /* -------------------------------------------------------------------------- */
 
 
-int getAction(int chan, char action, int frame, struct action** out)
+int getAction(int chan, int action, int frame, struct action** out)
 {
 	for (unsigned i=0; i<global.size(); i++)
 		for (unsigned j=0; j<global.at(i).size(); j++)
@@ -571,7 +748,7 @@ int getAction(int chan, char action, int frame, struct action** out)
 /* -------------------------------------------------------------------------- */
 
 
-void startOverdub(int index, char actionMask, int frame, unsigned bufferSize)
+void startOverdub(int index, int actionMask, int frame, unsigned bufferSize)
 {
 	/* prepare the composite struct */
 
@@ -629,7 +806,7 @@ void stopOverdub(int currentFrame, int totalFrames, pthread_mutex_t* mixerMutex)
 	if (cmp.a2.frame < cmp.a1.frame) {  // ring loop
 		ringLoop = true;
 		gu_log("[recorder::stopOverdub] ring loop! frame1=%d < frame2=%d\n", cmp.a1.frame, cmp.a2.frame);
-		rec(cmp.a2.chan, cmp.a2.type, totalFrames);
+		recLocked(cmp.a2.chan, cmp.a2.type, totalFrames, mixerMutex);
 	}
 	else
 	if (cmp.a2.frame == cmp.a1.frame) { // null loop
@@ -653,7 +830,7 @@ void stopOverdub(int currentFrame, int totalFrames, pthread_mutex_t* mixerMutex)
   /* Record second part of the composite action. Also make sure to avoid
   underlying action truncation, if keyrel happens inside a composite action. */
 
-	rec(cmp.a2.chan, cmp.a2.type, cmp.a2.frame);
+	recLocked(cmp.a2.chan, cmp.a2.type, cmp.a2.frame, mixerMutex);
   fixOverdubTruncation(cmp, mixerMutex);
 }
 
@@ -661,10 +838,163 @@ void stopOverdub(int currentFrame, int totalFrames, pthread_mutex_t* mixerMutex)
 /* -------------------------------------------------------------------------- */
 
 
+void forEachActionAt(int frame, int framesInLoop, int beats,
+	std::function<void(action*)> f)
+{
+	/* Fast path: the frame cache matches the clock (or there is no clock yet,
+	ticks being frames). */
+
+	if (clockFrames == 0 || (framesInLoop == clockFrames && beats == clockBeats)) {
+		for (unsigned i=0; i<frames.size(); i++) {
+			if (frames.at(i) != frame)
+				continue;
+			for (action* a : global.at(i))
+				f(a);
+			return;
+		}
+		return;
+	}
+
+	/* The clock has changed (e.g. a tempo change from the audio thread) and the
+	cache hasn't followed yet: convert ticks on the fly. */
+
+	for (const vector<action*>& acts : global)
+		for (action* a : acts)
+			if (toFrame(a->tick, framesInLoop, beats) == frame)
+				f(a);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int toFrame(double tick, int framesInLoop, int beats)
+{
+	if (beats <= 0)
+		return (int) std::round(tick);
+	return (int) std::round(tick * (framesInLoop / (double) (beats * G_PPQ)));
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+const vector<Segment>& getVolumeEnvelope(int chan)
+{
+	static const vector<Segment> empty;
+
+	const Envelopes* e = envelopes.load();
+	if (e == nullptr)
+		return empty;
+	Envelopes::const_iterator it = e->find(chan);
+	return it != e->end() ? it->second : empty;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void forEachAction(std::function<void(const action*)> f)
 {
 	for (const vector<action*> actions : recorder::global)
 		for (const action* action : actions)
 			f(action);
 }
+
+
+/* -------------------------------------------------------------------------- */
+
+
+uint32_t paramKey(int plugin, int param)
+{
+	return ((uint32_t) plugin << 16) | ((uint32_t) param & 0xFFFF);
+}
+
+
+int getParamPlugin(uint32_t key)
+{
+	return key >> 16;
+}
+
+
+int getParamIndex(uint32_t key)
+{
+	return key & 0xFFFF;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool capture(int chan, int type, int frame, uint32_t iValue, float fValue)
+{
+	return enqueue(CAPTURE_REC, chan, type, frame, iValue, fValue, 0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool captureOverdubStart(int chan, int actionMask, int frame, unsigned bufferSize)
+{
+	return enqueue(CAPTURE_OVERDUB_START, chan, actionMask, frame, 0, 0.0f, bufferSize);
+}
+
+
+bool captureOverdubStop(int currentFrame, int totalFrames)
+{
+	return enqueue(CAPTURE_OVERDUB_STOP, -1, 0, currentFrame, 0, 0.0f, totalFrames);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int countDropped()
+{
+	return dropped.exchange(0);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void flushCaptured(pthread_mutex_t* mixerMutex, std::function<void(const action&)> f)
+{
+	vector<Captured> captured;
+	Captured c;
+	while (captureQueue.pop(c))
+		captured.push_back(c);
+	if (captured.empty())
+		return;
+
+	/* Replay in order: an overdub stop deletes what was recorded since its start.
+	stopOverdub() takes the mixer mutex by itself, and wants sorted actions. */
+
+	for (const Captured& c : captured) {
+		if (mixerMutex != nullptr)
+			pthread_mutex_lock(mixerMutex);
+		if (c.op == CAPTURE_REC)
+			rec(c.a.chan, c.a.type, c.a.frame, c.a.iValue, c.a.fValue);
+		else
+		if (c.op == CAPTURE_OVERDUB_START)
+			startOverdub(c.a.chan, c.a.type, c.a.frame, c.extra);
+		else
+			sortActions();
+		if (mixerMutex != nullptr)
+			pthread_mutex_unlock(mixerMutex);
+		if (c.op == CAPTURE_OVERDUB_STOP)
+			stopOverdub(c.a.frame, c.extra, mixerMutex);
+	}
+
+	if (mixerMutex != nullptr)
+		pthread_mutex_lock(mixerMutex);
+	sortActions();
+	if (mixerMutex != nullptr)
+		pthread_mutex_unlock(mixerMutex);
+
+	for (const Captured& c : captured)
+		if (c.op != CAPTURE_OVERDUB_STOP)
+			f(c.a);
+}
 }}}; // giada::m::recorder::
@@ -31,6 +31,7 @@
 
 #include <cstdint>
 #include <vector>
+#include <map>
 #include <functional>
 #include <pthread.h>
 
@@ -51,7 +52,8 @@ struct action
 {
 	int      chan;    // channel index, i.e. Channel->index
  	int      type;
-	int      frame;   // redundant info, used by helper functions
+	int      frame;   // cached position in frames, see updateClock()
+	double   tick;    // tempo-independent position, G_PPQ ticks per beat
 	float    fValue;  // used only for envelopes (volumes, vst params).
 	uint32_t iValue;  // used only for MIDI events
 };
@@ -65,6 +67,18 @@ struct Composite
 	action a2;
 };
 
+/* Segment
+A piece of a compiled envelope: a linear ramp that starts at tick 'tick' with
+value 'value' and moves by 'delta' on each tick, until the next segment. Ticks,
+not frames: the envelope follows tempo changes right away (see toFrame). */
+
+struct Segment
+{
+	double tick;
+	float  value;
+	float  delta;
+};
+
 /* frames
 Frame counter sentinel. It tells which frames contain actions. E.g.:
   frames[0] = 155   // some actions on frame 155
@@ -104,6 +118,12 @@ bool canRec(Channel* ch, bool clockRunning, bool mixerRecording);
 
 void rec(int chan, int action, int frame, uint32_t iValue=0, float fValue=0.0f);
 
+/* recTick
+Records an action at tick 'tick' rather than at a given frame. Its frame
+position is derived from the current clock. Used when reading patches. */
+
+void recTick(int chan, int action, double tick, uint32_t iValue=0, float fValue=0.0f);
+
 /* clearChan
  * clear all actions from a channel. */
 
@@ -112,19 +132,19 @@ void clearChan(int chan);
 /* clearAction
  * clear the 'action' action type from a channel. */
 
-void clearAction(int chan, char action);
+void clearAction(int chan, int action);
 
 /* deleteAction
  * delete ONE action. Useful in the action editor. 'type' can be a mask. */
 
-void deleteAction(int chan, int frame, char type, bool checkValues,
+void deleteAction(int chan, int frame, int type, bool checkValues,
   pthread_mutex_t* mixerMutex, uint32_t iValue=0, float fValue=0.0);
 
 /* deleteActions
 Deletes A RANGE of actions from frame_a to frame_b in channel 'chan' of type
 'type' (can be a bitmask). Exclusive range (frame_a, frame_b). */
 
-void deleteActions(int chan, int frame_a, int frame_b, char type,
+void deleteActions(int chan, int frame_a, int frame_b, int type,
   pthread_mutex_t* mixerMutex);
 
 /* clearAll
@@ -138,23 +158,30 @@ void clearAll();
 void optimize();
 
 /* sortActions
- * sorts actions by frame, asc mode. */
+Sorts actions by frame, asc mode. Also recompiles and publishes envelopes, if
+needed. Editing functions call it on their own, except rec() and recTick():
+call it after recording a batch of actions. */
 
 void sortActions();
 
-/* updateBpm
- * reassign frames by calculating the new bpm value. */
-
-void updateBpm(float oldval, float newval, int oldquanto);
+/* updateClock
+Rebuilds the frame position cache of each action from its tick, given the new
+loop length in frames and in beats. Ticks are never touched, so tempo and
+samplerate changes are lossless. Does nothing if the clock hasn't changed. The
+mixer mutex, if any, is held only while the new cache is being swapped in. Not
+for the audio thread: it allocates. */
 
-/* updateSamplerate
- * reassign frames taking in account the samplerate. If f_system ==
- * f_patch nothing changes, otherwise the conversion is mandatory. */
+void updateClock(int framesInLoop, int beats, pthread_mutex_t* mixerMutex=nullptr);
 
-void updateSamplerate(int systemRate, int patchRate);
+/* expand
+Duplicates the actions of the first 'oldBeats' beats over the new loop length
+'newBeats'. Copies past the end of the new loop are discarded. Channels that
+still have actions past 'oldBeats', left there by a shorter loop, get those
+back instead. The mixer mutex, if any, is held only while swapping the new
+actions in. There is no shrink(): actions past the end of a shorter loop are
+kept, they just don't play. */
 
-void expand(int old_fpb, int new_fpb);
-void shrink(int new_fpb);
+void expand(int oldBeats, int newBeats, pthread_mutex_t* mixerMutex=nullptr);
 
 /* getNextAction
 Returns the nearest action in chan 'chan' of type 'action' starting from 
@@ -166,25 +193,92 @@ Mask example:
 	mask   = 0x0000FF00  // ignore byte 3
 	action = 0x803D3200  // <--- this action will be found */
 
-int getNextAction(int chan, char action, int frame, struct action** out,
+int getNextAction(int chan, int action, int frame, struct action** out,
 	uint32_t iValue=0, uint32_t mask=0);
 
 /* getAction
 Returns a pointer to action in chan 'chan' of type 'action' at frame 'frame'. */
 
-int getAction(int chan, char action, int frame, struct action** out);
+int getAction(int chan, int action, int frame, struct action** out);
 
 /* start/stopOverdub
 These functions are used when you overwrite existing actions. For example:
 pressing Mute button on a channel with some existing mute actions. */
 
-void startOverdub(int chan, char action, int frame, unsigned bufferSize);
+void startOverdub(int chan, int action, int frame, unsigned bufferSize);
 void stopOverdub(int currentFrame, int totalFrames, pthread_mutex_t *mixerMutex);
 
+/* forEachActionAt
+Calls 'f' on each action placed at frame 'frame' of a loop of 'framesInLoop'
+frames and 'beats' beats. The frame cache is used if it was built for that
+clock, otherwise ticks are converted on the fly: a tempo change applies to
+actions right away, before updateClock() catches up. Actions past the end of
+the loop never match. For the audio thread, with the mixer mutex held. */
+
+void forEachActionAt(int frame, int framesInLoop, int beats,
+	std::function<void(action*)> f);
+
+/* toFrame
+Position in frames of tick 'tick', in a loop of 'framesInLoop' frames and
+'beats' beats. */
+
+int toFrame(double tick, int framesInLoop, int beats);
+
+/* getVolumeEnvelope
+Returns the volume envelope of channel 'chan', compiled into sorted
+piecewise-linear segments. Envelopes are compiled when actions are edited, not
+here: this one only reads, so it's safe from the audio thread. The reference
+is valid as long as the caller stays in a reclaimer::Reader section. */
+
+const std::vector<Segment>& getVolumeEnvelope(int chan);
+
 /* forEachAction
 Applies a read-only callback on each action recorded. */
 
 void forEachAction(std::function<void(const action*)> f);
+
+/* paramKey, getParamPlugin, getParamIndex
+The iValue of G_ACTION_PARAM actions: position of the plug-in in the channel's
+stack (high 16 bits) and index of the parameter (low 16 bits). */
+
+uint32_t paramKey(int plugin, int param);
+int getParamPlugin(uint32_t key);
+int getParamIndex(uint32_t key);
+
+/* remapParams
+Follows a change in the plug-in stack of channel 'chan': the G_ACTION_PARAM
+actions of the plug-in that was at position i move to position 'map[i]', or
+are deleted if 'map[i]' is -1. The mixer mutex, if any, is held while
+editing. */
+
+void remapParams(int chan, const std::vector<int>& map,
+	pthread_mutex_t* mixerMutex=nullptr);
+
+/* capture
+Queues an action for flushCaptured(), instead of recording it on the spot. It
+never blocks nor allocates, so it is safe from the audio thread. Returns false
+if the capture queue is full and the action has been dropped. */
+
+bool capture(int chan, int type, int frame, uint32_t iValue=0, float fValue=0.0f);
+
+/* captureOverdubStart, captureOverdubStop
+Same as start/stopOverdub, queued for flushCaptured() as capture() does. */
+
+bool captureOverdubStart(int chan, int action, int frame, unsigned bufferSize);
+bool captureOverdubStop(int currentFrame, int totalFrames);
+
+/* countDropped
+Returns how many captures have been dropped since the last call, because the
+capture queue was full. */
+
+int countDropped();
+
+/* flushCaptured
+Records the actions and overdubs queued so far, in order, then calls 'f' on
+each recorded action (overdub starts included). The mixer mutex, if any, is
+held while recording. */
+
+void flushCaptured(pthread_mutex_t* mixerMutex, std::function<void(const action&)> f);
 }}}; // giada::m::recorder::
 
 #endif
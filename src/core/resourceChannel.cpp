@@ -62,6 +62,7 @@ ResourceChannel::ResourceChannel(int type, int status, int bufferSize)
 	mode             (G_DEFAULT_CHANMODE),
 	recMode          (G_DEFAULT_CHANRECMODE),
 	column		 				(nullptr),
+	inputLatency     (0),
 	midiInKeyPress 		(0x0),
 	midiInKeyRel   		(0x0),
 	midiInKill     		(0x0),
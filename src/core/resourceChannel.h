@@ -217,6 +217,13 @@ public:
 
 	ColumnChannel* column;
 
+	/* inputLatency
+	Plug-in latency, in frames, of the input this channel records from. Input
+	audio is written that many frames back, so that takes line up with the
+	loop. Set by the mixer on each block. */
+
+	int inputLatency;
+
 	// midi stuff
 
 	uint32_t midiInKeyPress;
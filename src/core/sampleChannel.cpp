@@ -28,6 +28,7 @@
 #include <cmath>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
 #include "sampleChannel.h"
 #include "../utils/log.h"
 #include "../utils/fs.h"
@@ -59,6 +60,7 @@ SampleChannel::SampleChannel(int bufferSize)
 		rsmp_state       (nullptr),
 		inputTracker		 (0),
 		frameRewind      (-1),
+		volumeEnvCursor  (0),
 		pitch            (G_DEFAULT_PITCH),
 		fadeinOn         (false),
 		fadeinVol        (1.0f),
@@ -72,6 +74,9 @@ SampleChannel::SampleChannel(int bufferSize)
 		shift            (0),
 		qWait	           (false),
 		qRecWait	           (false),
+		loading          (false),
+		wanted           (false),
+		pendingVelocity  (-1),
 		midiInReadActions(0x0),
 		midiInPitch      (0x0)
 {
@@ -166,31 +171,35 @@ void SampleChannel::clearBuffers()
 
 void SampleChannel::calcVolumeEnv(int frame)
 {
-	/* method: check this frame && next frame, then calculate delta */
+	/* Step through the compiled segments starting from the last known one. They
+	are sorted by tick, so the cursor moves forward only, except when the
+	sequencer restarts or the envelope has been edited and rebuilt. Ticks are
+	placed on the current clock. */
 
-	recorder::action* a0 = nullptr;
-	recorder::action* a1 = nullptr;
-	int res;
-
-	/* get this action on frame 'frame'. It's unlikely that the action
-	 * is not found. */
-
-	res = recorder::getAction(index, G_ACTION_VOLUME, frame, &a0);
-	if (res == 0)
+	const std::vector<recorder::Segment>& env = recorder::getVolumeEnvelope(index);
+	if (env.empty())
 		return;
 
-	/* get the action next to this one.
-	 * res == -1: a1 not found, this is the last one. Rewind the search
-	 * and use action at frame number 0 (actions[0]).
-	 * res == -2 G_ACTION_VOLUME not found. This should never happen */
+	int framesInLoop = clock::getFramesInLoop();
+	int beats        = clock::getBeats();
+	auto segFrame = [&] (unsigned i) {
+		return recorder::toFrame(env.at(i).tick, framesInLoop, beats);
+	};
 
-	res = recorder::getNextAction(index, G_ACTION_VOLUME, frame, &a1);
+	if (volumeEnvCursor >= env.size() || segFrame(volumeEnvCursor) > frame)
+		volumeEnvCursor = 0;
+	while (volumeEnvCursor < env.size() - 1 && segFrame(volumeEnvCursor) < frame)
+		volumeEnvCursor++;
+
+	if (segFrame(volumeEnvCursor) != frame)
+		return;
 
-	if (res == -1)
-		res = recorder::getAction(index, G_ACTION_VOLUME, 0, &a1);
+	/* Delta per tick to delta per frame. */
 
-	volume_i = a0->fValue;
-	volume_d = ((a1->fValue - a0->fValue) / (a1->frame - a0->frame)) * 1.003f;
+	const recorder::Segment& seg = env.at(volumeEnvCursor);
+	volume_i = seg.value;
+	volume_d = framesInLoop > 0 && beats > 0 ?
+		seg.delta * (beats * G_PPQ) / (float) framesInLoop : seg.delta;
 }
 
 
@@ -339,6 +348,11 @@ void SampleChannel::parseAction(recorder::action* a, int localFrame, int globalF
 		case G_ACTION_VOLUME:
 			calcVolumeEnv(globalFrame);
 			break;
+#ifdef WITH_VST
+		case G_ACTION_PARAM:
+			addParamChange(a->iValue, a->fValue, localFrame);
+			break;
+#endif
 	}
 }
 
@@ -533,12 +547,12 @@ void SampleChannel::quantize(int index, int localFrame, int globalFrame)
 
 		if (recorder::canRec(this, clock::isRunning(), mixer::recording)) {
 			if (mode == SINGLE_PRESS) {
-				recorder::startOverdub(index, G_ACTION_KEYS, globalFrame,
+				recorder::captureOverdubStart(index, G_ACTION_KEYS, globalFrame,
 					kernelAudio::getRealBufSize());
 	      readActions = false;   // don't read actions while overdubbing
 	    }
 			else
-				recorder::rec(index, G_ACTION_KEYPRESS, globalFrame);
+				recorder::capture(index, G_ACTION_KEYPRESS, globalFrame);
 	    hasActions = true;
 		}
 
@@ -719,7 +733,7 @@ void SampleChannel::empty()
   end     = 0;
   tracker = 0;
 	status  = STATUS_EMPTY;
-  volume  = G_DEFAULT_VOL;
+  resetVolume(G_DEFAULT_VOL);
   boost   = G_DEFAULT_BOOST;
 	sendMidiLplay();
 }
@@ -772,10 +786,18 @@ void SampleChannel::process(giada::m::AudioBuffer& out, giada::m::AudioBuffer& i
 		}
 		else {
 			int waveSize = wave->getSize();
+			int latency  = std::min(inputLatency, waveSize - 1);
 			for (int i=0; i<vChan.countFrames(); i++) {
-				for (int j=0; j<vChan.countChannels(); j++) {
-					(*wave)[inputTracker][j] += in[i][j];   // add, don't overwrite
-				}
+
+				/* Input is late by 'latency' frames. Loops wrap around, single takes
+				just drop the frames that fall before the start. */
+
+				int pos = inputTracker - latency;
+				if (pos < 0 && !(recMode & REC_SINGLE_ANY))
+					pos += waveSize;
+				if (pos >= 0)
+					for (int j=0; j<vChan.countChannels(); j++)
+						(*wave)[pos][j] += in[i][j];   // add, don't overwrite
 				inputTracker++;
 				if (inputTracker >= waveSize) {
 					if (recMode & REC_SINGLE_ANY) {
@@ -1140,7 +1162,7 @@ void SampleChannel::recStop(bool force) {
 void SampleChannel::writePatch(bool isProject)
 {
 	Channel::writePatch(isProject);
-	channelManager::writePatch(this, isProject, index);
+	channelManager::writePatch(this, isProject, patch::channels.size() - 1);
 }
 
 
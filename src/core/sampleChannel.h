@@ -29,6 +29,7 @@
 #define G_SAMPLE_CHANNEL_H
 
 
+#include <atomic>
 #include <functional>
 #include <samplerate.h>
 #include "resourceChannel.h"
@@ -56,7 +57,8 @@ private:
 	void calcFadeoutStep();
 
 	/* calcVolumeEnv
-	Computes any changes in volume done via envelope tool. */
+	Computes any changes in volume done via envelope tool, reading the compiled
+	envelope segments from Recorder. */
 
 	void calcVolumeEnv(int frame);
 
@@ -101,6 +103,11 @@ private:
 
 	int frameRewind;
 
+	/* volumeEnvCursor
+	Index of the current segment in the compiled volume envelope. */
+
+	unsigned volumeEnvCursor;
+
 	float pitch;
 
 	bool  fadeinOn;
@@ -184,6 +191,16 @@ public:
 	bool  qWait;           // quantizer wait
 	bool  qRecWait;        // quantizer recording wait
 
+	/* loading, wanted, pendingVelocity
+	Lazy loading. 'loading' is true while the wave is still queued in waveLoader.
+	A key press meanwhile sets 'wanted' (load this one first) and, unless presses
+	are skipped, keeps its velocity in 'pendingVelocity' (-1 = none) to start the
+	channel as soon as the wave is in. */
+
+	std::atomic<bool> loading;
+	std::atomic<bool> wanted;
+	std::atomic<int>  pendingVelocity;
+
 	/* midi stuff */
 
   bool     midiInVeloAsVol;
@@ -79,6 +79,27 @@ bool setFloat(json_t* jRoot, const char* key, float& output)
 /* -------------------------------------------------------------------------- */
 
 
+bool setDouble(json_t* jRoot, const char* key, double& output)
+{
+	json_t* jObject = json_object_get(jRoot, key);
+	if (!jObject) {
+		gu_log("[storager::setDouble] key '%s' not found, using default value\n", key);
+		output = 0.0;
+		return true;
+	}
+	if (!json_is_real(jObject)) {
+		gu_log("[storager::setDouble] key '%s' is not a double!\n", key);
+		json_decref(jRoot);
+		return false;
+	}
+	output = json_real_value(jObject);
+	return true;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 bool setUint32(json_t* jRoot, const char* key, uint32_t &output)
 {
 	json_t* jObject = json_object_get(jRoot, key);
@@ -39,6 +39,7 @@ namespace storager
 {
 bool setString(json_t *jRoot, const char *key, std::string &output);
 bool setFloat(json_t *jRoot, const char *key, float &output);
+bool setDouble(json_t *jRoot, const char *key, double &output);
 bool setUint32(json_t *jRoot, const char *key, uint32_t &output);
 bool setInt(json_t *jRoot, const char *key, int &output);
 bool setBool(json_t *jRoot, const char *key, bool &output);
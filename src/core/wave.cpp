@@ -43,7 +43,8 @@ Wave::Wave()
 : m_rate   (0),
   m_bits   (0),
   m_logical(false),
-  m_edited (false) 
+  m_edited (false),
+  m_savedHash(0)
 {
 }
 
@@ -65,10 +66,11 @@ Wave::Wave(const Wave& other)
 	m_bits    (other.m_bits),	
 	m_logical (true),   // a cloned wave does not exist on disk
 	m_edited  (false),
-	m_path    (other.m_path)
+	m_path    (other.m_path),
+	m_savedHash(0)
 {
 	buffer.alloc(other.getSize(), other.getChannels());
-	buffer.copyData(other.getFrame(0), other.getSize(), other.getChannels());
+	buffer.copyData(other.getFrame(0), other.getSize());
 }
 
 
@@ -105,6 +107,8 @@ int Wave::getSize() const { return buffer.countFrames(); }
 int Wave::getBits() const { return m_bits; }
 bool Wave::isLogical() const { return m_logical; }
 bool Wave::isEdited() const { return m_edited; }
+uint64_t Wave::getSavedHash() const { return m_savedHash; }
+std::string Wave::getSavedFileId() const { return m_savedFileId; }
 
 
 /* -------------------------------------------------------------------------- */
@@ -145,6 +149,39 @@ void Wave::setEdited(bool e)  { m_edited = e; }
 /* -------------------------------------------------------------------------- */
 
 
+void Wave::setSaved(const string& fileId, uint64_t hash)
+{
+	m_savedFileId = fileId;
+	m_savedHash   = hash;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+uint64_t Wave::hash() const
+{
+	/* FNV-1a, one 32-bit sample at a time rather than byte by byte: this runs
+	on every load, so keep it cheap on long samples. */
+
+	uint64_t h = 14695981039346656037ULL;
+	if (getSize() == 0)
+		return h;
+
+	const uint32_t* data = reinterpret_cast<const uint32_t*>(buffer[0]);
+	size_t size = (size_t) getSize() * getChannels();
+
+	for (size_t i = 0; i < size; i++) {
+		h ^= data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void Wave::setPath(const string& p, int id) 
 { 
 	if (id == -1)
@@ -33,6 +33,11 @@
 
 #include <sndfile.h>
 #include <string>
+#ifdef __APPLE__  // our Clang still doesn't know about cstdint (c++11 stuff)
+	#include <stdint.h>
+#else
+	#include <cstdint>
+#endif
 #include "const.h"
 #include "audioBuffer.h"
 
@@ -62,6 +67,19 @@ public:
 	bool isLogical() const;
 	bool isEdited() const;
 
+	/* hash
+	Returns a hash of the audio content, used to tell whether data has changed
+	since the last save. */
+
+	uint64_t hash() const;
+
+	/* getSavedHash, getSavedFileId
+	Hash of the content and gu_fileId() of the file on disk as they were when this
+	Wave was last read from or written to 'm_path'. */
+
+	uint64_t getSavedHash() const;
+	std::string getSavedFileId() const;
+
 	/* setPath
 	Sets new path 'p'. If 'id' != -1 inserts a numeric id next to the file 
 	extension, e.g. : /path/to/sample-[id].wav */
@@ -71,6 +89,7 @@ public:
 	void setRate(int v);
 	void setLogical(bool l);
 	void setEdited(bool e);
+	void setSaved(const std::string& fileId, uint64_t hash);
 
 	/* moveData
 	Moves data held by 'b' into this buffer. Then 'b' becomes an empty buffer. */
@@ -94,6 +113,8 @@ private:
 	bool m_logical;     // memory only (a take)
 	bool m_edited;      // edited via editor
 	std::string m_path; // E.g. /path/to/my/sample.wav
+	uint64_t m_savedHash;
+	std::string m_savedFileId;
 };
 
 #endif
@@ -0,0 +1,213 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include "../utils/log.h"
+#include "const.h"
+#include "conf.h"
+#include "wave.h"
+#include "waveManager.h"
+#include "waveLoader.h"
+
+
+using std::vector;
+
+
+namespace giada {
+namespace m {
+namespace waveLoader
+{
+namespace
+{
+std::mutex          mutex;
+vector<Request>     requests;
+vector<Result>      results;
+vector<std::thread> workers;
+int                 active = 0;  // threads still taking requests
+int                 running = 0; // requests being decoded right now
+
+/* generation
+Bumped by cancel(): results of requests started before it are thrown away. */
+
+unsigned generation = 0;
+
+
+/* -------------------------------------------------------------------------- */
+
+/* take
+Pops the request with the lowest priority. Mutex must be held. */
+
+Request take()
+{
+	auto it = std::min_element(requests.begin(), requests.end(),
+		[] (const Request& a, const Request& b) { return a.priority < b.priority; });
+	Request r = *it;
+	requests.erase(it);
+	return r;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!requests.empty()) {
+		Request  r   = take();
+		unsigned gen = generation;
+		running++;
+		lock.unlock();
+
+		Wave* w   = nullptr;
+		int   res = waveManager::load(r.path, conf::rsmpQuality, conf::samplerate, &w);
+
+		lock.lock();
+		running--;
+		if (gen == generation)
+			results.push_back({ r.chan, r.index, res, w });
+		else
+			delete w;
+	}
+	active--;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* joinIdle
+Joins exited threads once none is active anymore. Never called by a loader. */
+
+void joinIdle()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (active > 0)
+			return;
+	}
+	for (std::thread& t : workers)
+		t.join();
+	workers.clear();
+}
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+
+void start(const vector<Request>& reqs)
+{
+	if (reqs.empty())
+		return;
+
+	joinIdle();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	requests.insert(requests.end(), reqs.begin(), reqs.end());
+
+	int cores = std::max(1u, std::thread::hardware_concurrency());
+	int spawn = std::min(cores - active, (int) requests.size());
+	for (int i=0; i<spawn; i++) {
+		workers.emplace_back(work);
+		active++;
+	}
+
+	gu_log("[waveLoader::start] %d wave(s) queued, %d loader(s) running\n",
+		(int) requests.size(), active);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int collect(std::function<void(const Result&)> f)
+{
+	vector<Result> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(results);
+	}
+	for (const Result& r : ready)
+		f(r);
+	joinIdle();
+	return ready.size();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void prioritize(int chan)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (requests.empty())
+		return;
+	int first = std::min_element(requests.begin(), requests.end(),
+		[] (const Request& a, const Request& b) { return a.priority < b.priority; })->priority;
+	for (Request& r : requests)
+		if (r.chan == chan) {
+			r.priority = first - 1;
+			gu_log("[waveLoader::prioritize] channel %d moved up\n", chan);
+		}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int countPending()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return requests.size() + running + results.size();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.clear();
+		generation++;
+	}
+	for (std::thread& t : workers)
+		t.join();
+	workers.clear();
+
+	for (const Result& r : results)
+		delete r.wave;
+	results.clear();
+}
+
+}}}; // giada::m::waveLoader::
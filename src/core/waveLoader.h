@@ -0,0 +1,96 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#ifndef G_WAVE_LOADER_H
+#define G_WAVE_LOADER_H
+
+
+#include <string>
+#include <vector>
+#include <functional>
+
+
+class Wave;
+
+
+namespace giada {
+namespace m {
+namespace waveLoader
+{
+/* Request
+A wave to decode for channel 'chan'. 'index' is an opaque tag handed back with
+the result (e.g. the position in patch::channels). Lower 'priority' values are
+loaded first. */
+
+struct Request
+{
+	int         chan;
+	int         index;
+	int         priority;
+	std::string path;
+};
+
+struct Result
+{
+	int   chan;
+	int   index;
+	int   res;    // G_RES_OK or any G_RES_ERR_* from waveManager
+	Wave* wave;   // owned by the receiver, nullptr on failure
+};
+
+/* start
+Queues 'reqs' and makes sure enough loader threads are running: decoding and
+resampling happen off the calling thread, one wave per core at a time. */
+
+void start(const std::vector<Request>& reqs);
+
+/* collect
+Hands every finished result to 'f', on the calling thread, and returns how many
+they were. */
+
+int collect(std::function<void(const Result&)> f);
+
+/* prioritize
+Moves the queued request of channel 'chan', if any, in front of all others. */
+
+void prioritize(int chan);
+
+/* countPending
+Requests queued or being decoded, not yet collected. */
+
+int countPending();
+
+/* cancel
+Drops queued requests, waits for the running ones and frees any wave not
+collected yet. */
+
+void cancel();
+
+}}}; // giada::m::waveLoader::
+
+
+#endif
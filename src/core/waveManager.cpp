@@ -26,6 +26,7 @@
 
 
 #include <cmath>
+#include <cstdio>
 #include <sndfile.h>
 #include <samplerate.h>
 #include "../utils/log.h"
@@ -122,6 +123,33 @@ int create(const string& path, Wave** out)
 /* -------------------------------------------------------------------------- */
 
 
+int load(const string& path, int quality, int samplerate, Wave** out)
+{
+	Wave* wave = nullptr;
+	int res = create(path, &wave);
+	if (res != G_RES_OK)
+		return res;
+
+	if (wave->getRate() != samplerate) {
+		gu_log("[waveManager::load] input rate (%d) != system rate (%d), conversion needed\n",
+			wave->getRate(), samplerate);
+		res = resample(wave, quality, samplerate);
+		if (res != G_RES_OK) {
+			delete wave;
+			return res;
+		}
+	}
+
+	wave->setSaved(gu_fileId(path), wave->hash());
+
+	*out = wave;
+	return G_RES_OK;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 int createEmpty(int frames, int channels, int samplerate, const string& name,
 	Wave** out)
 {
@@ -215,10 +243,16 @@ int save(Wave* w, const string& path)
 	header.channels   = w->getChannels();
 	header.format     = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
 
-	SNDFILE* file = sf_open(path.c_str(), SFM_WRITE, &header);
+	/* Write to a temporary file first, then move it over the target. The target
+	may be hard-linked to a sample somewhere else (see gu_linkFile): writing it
+	in place would overwrite the original too. */
+
+	string tmpPath = path + ".tmp";
+
+	SNDFILE* file = sf_open(tmpPath.c_str(), SFM_WRITE, &header);
 	if (file == nullptr) {
 		gu_log("[waveManager::save] unable to open %s for exporting: %s\n",
-			path.c_str(), sf_strerror(file));
+			tmpPath.c_str(), sf_strerror(file));
 		return G_RES_ERR_IO;
 	}
 
@@ -227,8 +261,16 @@ int save(Wave* w, const string& path)
 
 	sf_close(file);
 
+	if (!gu_replaceFile(tmpPath, path)) {
+		gu_log("[waveManager::save] unable to move %s to %s\n", tmpPath.c_str(),
+			path.c_str());
+		remove(tmpPath.c_str());
+		return G_RES_ERR_IO;
+	}
+
 	w->setLogical(false);
 	w->setEdited(false);
+	w->setSaved(gu_fileId(path), w->hash());
 
 	return G_RES_OK;
 }
@@ -44,6 +44,12 @@ Creates a new Wave object with data read from file 'path'. */
 
 int create(const std::string& path, Wave** out);
 
+/* load
+Creates a new Wave from file 'path' like create(), then converts it to
+'samplerate' if needed. Touches no shared state: safe on any thread. */
+
+int load(const std::string& path, int quality, int samplerate, Wave** out);
+
 /* createEmpty
 Creates a new silent Wave object. */
 
@@ -0,0 +1,346 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include "const.h"
+#include "../utils/log.h"
+#include "workerPool.h"
+#if defined(G_OS_LINUX)
+	#include <cerrno>
+	#include <pthread.h>
+	#include <semaphore.h>
+#elif defined(G_OS_MAC)
+	#include <pthread.h>
+	#include <dispatch/dispatch.h>
+#elif defined(G_OS_WINDOWS)
+	#include <windows.h>
+#endif
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+	#include <immintrin.h>
+#endif
+
+
+namespace giada {
+namespace m {
+namespace workerPool
+{
+namespace
+{
+/* Semaphore
+Native semaphore. Posting is an atomic increment plus a wake-up call when
+somebody is waiting: no mutex is involved, so the audio thread can't be blocked
+by a worker going to sleep. */
+
+class Semaphore
+{
+public:
+
+#if defined(G_OS_LINUX)
+
+	Semaphore()  { sem_init(&m_sem, 0, 0); }
+	~Semaphore() { sem_destroy(&m_sem); }
+	void post()  { sem_post(&m_sem); }
+	void wait()  { while (sem_wait(&m_sem) == -1 && errno == EINTR); }
+
+private:
+
+	sem_t m_sem;
+
+#elif defined(G_OS_MAC)
+
+	Semaphore()  { m_sem = dispatch_semaphore_create(0); }
+	~Semaphore() { dispatch_release(m_sem); }
+	void post()  { dispatch_semaphore_signal(m_sem); }
+	void wait()  { dispatch_semaphore_wait(m_sem, DISPATCH_TIME_FOREVER); }
+
+private:
+
+	dispatch_semaphore_t m_sem;
+
+#elif defined(G_OS_WINDOWS)
+
+	Semaphore()  { m_sem = CreateSemaphore(nullptr, 0, G_MAX_WORKERS, nullptr); }
+	~Semaphore() { CloseHandle(m_sem); }
+	void post()  { ReleaseSemaphore(m_sem, 1, nullptr); }
+	void wait()  { WaitForSingleObject(m_sem, INFINITE); }
+
+private:
+
+	HANDLE m_sem;
+
+#endif
+};
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* ticket
+Current job, packed in a single word so that a worker can never take an index
+of a job that has been replaced in the meantime: generation in the upper 32
+bits, number of calls in the next 16, next index to take in the lower 16. */
+
+std::atomic<uint64_t> ticket(0);
+std::atomic<int>      done(0);
+
+/* job function and data. Written only while no index of the previous job can
+still be taken, read only by who owns an index of the current one. */
+
+void (*jobFn)(int, void*) = nullptr;
+void* jobData = nullptr;
+
+std::vector<std::thread> workers;
+std::atomic<bool>        running(false);
+
+/* sleepers, wakeup
+Workers that found nothing to do for G_WORKER_SPIN polls wait on 'wakeup'.
+'sleepers' counts the posts they are owed: publish() takes the whole count and
+posts that many times. */
+
+std::atomic<int> sleepers(0);
+Semaphore        wakeup;
+
+
+/* -------------------------------------------------------------------------- */
+
+
+uint32_t getGeneration(uint64_t t) { return t >> 32; }
+int      getCount     (uint64_t t) { return (t >> 16) & 0xFFFF; }
+int      getIndex     (uint64_t t) { return t & 0xFFFF; }
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* relax
+Tells the CPU we are busy waiting, without giving the time slice away as
+yield() would. */
+
+inline void relax()
+{
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+	_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* setRealtime
+Gives the calling worker the real-time scheduling RtAudio gives the audio
+thread (SCHED_RR, priority clamped to the allowed range), so that it isn't
+preempted by ordinary threads while the audio thread waits for it. Without the
+rights to do so the worker keeps running at normal priority. */
+
+void setRealtime()
+{
+#if defined(G_OS_LINUX) || defined(G_OS_MAC)
+	struct sched_param param;
+	int min = sched_get_priority_min(SCHED_RR);
+	int max = sched_get_priority_max(SCHED_RR);
+	param.sched_priority = std::max(min, std::min(max, G_WORKER_PRIORITY));
+	int err = pthread_setschedparam(pthread_self(), SCHED_RR, &param);
+	if (err != 0)
+		gu_log("[workerPool] unable to set real-time priority (error %d)\n", err);
+#elif defined(G_OS_WINDOWS)
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* work
+Takes and executes indexes of job 'generation' until there are none left. */
+
+void work(uint32_t generation)
+{
+	while (true) {
+		uint64_t t = ticket.load(std::memory_order_acquire);
+		if (getGeneration(t) != generation || getIndex(t) >= getCount(t))
+			return;
+		if (!ticket.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel))
+			continue;
+		jobFn(getIndex(t), jobData);
+		done.fetch_add(1, std::memory_order_release);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* sleep
+Waits for a post, unless job 'seen' has been replaced in the meantime. Both the
+increment here and the exchange in publish() are sequentially consistent, as
+are the ticket store and load: either this sees the new ticket or publish()
+sees the sleeper. */
+
+void sleep(uint32_t seen)
+{
+	sleepers.fetch_add(1);
+	if (getGeneration(ticket.load()) == seen) {
+		wakeup.wait();
+		return;
+	}
+
+	/* Job replaced: take the post back, if publish() hasn't claimed it yet. If it
+	has, the post is on its way and must be consumed. */
+
+	int n = sleepers.load();
+	while (n > 0 && !sleepers.compare_exchange_weak(n, n - 1));
+	if (n == 0)
+		wakeup.wait();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void workerLoop()
+{
+	setRealtime();
+	uint32_t seen = getGeneration(ticket.load(std::memory_order_acquire));
+	while (running.load()) {
+		int polls = 0;
+		uint32_t generation;
+		while ((generation = getGeneration(ticket.load(std::memory_order_acquire))) == seen) {
+			if (++polls < G_WORKER_SPIN)
+				relax();
+			else {
+				sleep(seen);
+				polls = 0;
+			}
+		}
+		seen = generation;
+		work(generation);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+/* publish
+Makes a new job visible to the workers and wakes up the sleeping ones. Never
+blocks: one atomic exchange, and a post per sleeper, if any. */
+
+void publish(uint64_t t)
+{
+	ticket.store(t);
+	for (int n = sleepers.exchange(0); n > 0; n--)
+		wakeup.post();
+}
+}; // {anonymous}
+
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+
+void init(int count)
+{
+	if (running.load())
+		return;
+	if (count > G_MAX_WORKERS)
+		count = G_MAX_WORKERS;
+	running.store(true);
+	for (int i=0; i<count; i++)
+		workers.push_back(std::thread(workerLoop));
+	gu_log("[workerPool::init] %d worker threads started\n", count);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void close()
+{
+	if (!running.load())
+		return;
+	running.store(false);
+	uint64_t t = ticket.load();
+	publish((uint64_t) (getGeneration(t) + 1) << 32);
+	for (std::thread& w : workers)
+		w.join();
+	workers.clear();
+	gu_log("[workerPool::close] worker threads stopped\n");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void run(int count, void (*f)(int, void*), void* data)
+{
+	if (count <= 0)
+		return;
+
+	/* Not worth waking up anybody for a single call, or too many calls to fit
+	the ticket: do it here. */
+
+	if (workers.empty() || count == 1 || count > 0xFFFF) {
+		for (int i=0; i<count; i++)
+			f(i, data);
+		return;
+	}
+
+	uint32_t generation = getGeneration(ticket.load()) + 1;
+	jobFn   = f;
+	jobData = data;
+	done.store(0);
+	publish(((uint64_t) generation << 32) | ((uint64_t) count << 16));
+
+	/* Help the workers, then wait for the calls still running elsewhere. They
+	are short and the workers run at real-time priority: busy wait, keeping the
+	CPU. */
+
+	work(generation);
+	while (done.load(std::memory_order_acquire) < count)
+		relax();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+int countWorkers()
+{
+	return workers.size();
+}
+
+}}}; // giada::m::workerPool::
@@ -0,0 +1,63 @@
+/* -----------------------------------------------------------------------------
+ *
+ * Giada - Your Hardcore Loopmachine
+ *
+ * -----------------------------------------------------------------------------
+ *
+ * Copyright (C) 2010-2018 Giovanni A. Zuliani | Monocasual
+ *
+ * This file is part of Giada - Your Hardcore Loopmachine.
+ *
+ * Giada - Your Hardcore Loopmachine is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU General
+ * Public License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * Giada - Your Hardcore Loopmachine is distributed in the hope that it
+ * will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Giada - Your Hardcore Loopmachine. If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * -------------------------------------------------------------------------- */
+
+
+#ifndef G_WORKER_POOL_H
+#define G_WORKER_POOL_H
+
+
+namespace giada {
+namespace m {
+namespace workerPool
+{
+/* init
+Starts 'count' worker threads, capped to G_MAX_WORKERS, at real-time priority
+when allowed. With 0 workers every job runs on the calling thread. */
+
+void init(int count);
+
+/* close
+Stops and joins all workers. */
+
+void close();
+
+/* run
+Calls 'f(i, data)' for every i in [0, count), spreading the calls across the
+workers and the calling thread, and returns when all of them are done. Meant
+for the audio thread: it never allocates nor takes locks, and waits for the
+workers busy. Not reentrant: only one thread at a time may call it. */
+
+void run(int count, void (*f)(int, void*), void* data);
+
+/* countWorkers
+Number of running worker threads, the calling thread excluded. */
+
+int countWorkers();
+
+}}}; // giada::m::workerPool::
+
+
+#endif
@@ -61,6 +61,7 @@
 #include "../core/midiChannel.h"
 #include "../core/plugin.h"
 #include "../core/waveManager.h"
+#include "../core/midiDispatcher.h"
 #include "main.h"
 #include "channel.h"
 
@@ -91,20 +92,10 @@ int loadChannel(SampleChannel* ch, const string& fname)
 	conf::samplePath = gu_dirname(fname);
 
 	Wave* wave = nullptr;
-	int result = waveManager::create(fname, &wave);
+	int result = waveManager::load(fname, conf::rsmpQuality, conf::samplerate, &wave);
 	if (result != G_RES_OK)
 		return result;
 
-	if (wave->getRate() != conf::samplerate) {
-		gu_log("[loadChannel] input rate (%d) != system rate (%d), conversion needed\n",
-			wave->getRate(), conf::samplerate);
-		result = waveManager::resample(wave, conf::rsmpQuality, conf::samplerate);
-		if (result != G_RES_OK) {
-			delete wave;
-			return result;
-		}
-	}
-
 	ch->pushWave(wave);
 
 	G_MainWin->keyboard->updateChannel(ch->guiChannel);
@@ -160,7 +151,7 @@ void deleteChannel(Channel* ch, bool warn) {
 	recorder::clearChan(ch->index);
 	ch->hasActions = false;
 #ifdef WITH_VST
-	pluginHost::freeStack(&mixer::mutex_plugins, ch);
+	pluginHost::freeStack(ch);
 #endif
 
 	Fl::lock();
@@ -244,6 +235,7 @@ int cloneResourceChannel(ResourceChannel* src)
 
 	ch->guiChannel = gch;
 	ch->copy(src, &mixer::mutex_plugins);
+	midiDispatcher::rebuild();
 
 	G_MainWin->keyboard->updateChannel(ch->guiChannel);
 	return true;
@@ -286,7 +278,17 @@ void toggleInputMonitor(Channel* ch)
 
 void setVolume(Channel* ch, float v, bool gui, bool editor)
 {
-	ch->volume = v;
+	ch->resetVolume(v);
+	refreshVolume(ch, gui, editor);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void refreshVolume(Channel* ch, bool gui, bool editor)
+{
+	float v = ch->volume;
 
 	/* Changing channel volume? Update wave editor (if it's shown). */
 
@@ -313,6 +315,15 @@ void setVolume(Channel* ch, float v, bool gui, bool editor)
 void setPitch(SampleChannel* ch, float val)
 {
 	ch->setPitch(val);
+	refreshPitch(ch);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void refreshPitch(SampleChannel* ch)
+{
 	gdSampleEditor* gdEditor = static_cast<gdSampleEditor*>(gu_getSubwindow(G_MainWin, WID_SAMPLE_EDITOR));
 	if (gdEditor) {
 		Fl::lock();
@@ -346,13 +357,12 @@ void toggleMute(Channel* ch, bool gui)
 
 	if (recorder::active && recorder::canRec(ch, clock::isRunning(), mixer::recording)) {
 		if (!ch->mute) {
-			recorder::startOverdub(ch->index, G_ACTION_MUTES, clock::getCurrentFrame(),
+			recorder::captureOverdubStart(ch->index, G_ACTION_MUTES, clock::getCurrentFrame(),
 				kernelAudio::getRealBufSize());
 			ch->setReadActions(false);   // don't read actions while overdubbing
 		}
 		else
-		 recorder::stopOverdub(clock::getCurrentFrame(), clock::getFramesInLoop(),
-			&mixer::mutex_recs);
+		 recorder::captureOverdubStop(clock::getCurrentFrame(), clock::getFramesInLoop());
 	}
 
 	ch->mute ? ch->unsetMute(false) : ch->setMute(false);
@@ -394,9 +404,9 @@ void setSolo(Channel* ch, bool v, bool gui)
 /* -------------------------------------------------------------------------- */
 
 
-void kill(ResourceChannel* ch)
+void kill(ResourceChannel* ch, int localFrame)
 {
-	ch->kill(0); // on frame 0: it's a user-generated event
+	ch->kill(localFrame); // user-generated event
 }
 
 
@@ -94,10 +94,17 @@ void setPitch(SampleChannel* ch, float val);
 void setPanning(ResourceChannel* ch, float val);
 void setBoost(SampleChannel* ch, float val);
 void setName(Channel* ch, const std::string& name);
+
+/* refresh[Volume|Pitch]
+Update the widgets of a property already changed in the engine, e.g. by MIDI
+input. 'gui' and 'editor' have the same meaning as in setVolume(). */
+
+void refreshVolume(Channel* ch, bool gui=false, bool editor=false);
+void refreshPitch(SampleChannel* ch);
 void toggleMute(Channel* ch, bool gui=true);
 void toggleSolo(Channel* ch, bool gui=true);
 void setSolo(Channel* ch, bool v, bool gui);
-void kill(ResourceChannel* ch);
+void kill(ResourceChannel* ch, int localFrame=0);
 
 
 /* toggleReadingRecs
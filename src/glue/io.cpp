@@ -37,6 +37,8 @@
 #include "../utils/log.h"
 #include "../utils/math.h"
 #include "../core/recorder.h"
+#include "../core/commands.h"
+#include "../core/conf.h"
 #include "../core/kernelAudio.h"
 #include "../core/mixer.h"
 #include "../core/mixerHandler.h"
@@ -70,7 +72,7 @@ void ctrlPress(SampleChannel* ch)
 /* -------------------------------------------------------------------------- */
 
 
-void shiftPress(SampleChannel* ch)
+void shiftPress(SampleChannel* ch, int localFrame)
 {
 	/* action recording on:
 			if sequencer is running, rec a killchan
@@ -83,11 +85,11 @@ void shiftPress(SampleChannel* ch)
 	if (m::recorder::active) {
 		if (!m::clock::isRunning())
 			return;
-		ch->kill(0); // on frame 0: user-generated event
+		ch->kill(localFrame); // user-generated event
 		if (m::recorder::canRec(ch, m::clock::isRunning(), m::mixer::recording) &&
 				!(ch->mode & LOOP_ANY))
 		{   // don't record killChan actions for LOOP channels
-			m::recorder::rec(ch->index, G_ACTION_KILL, m::clock::getCurrentFrame());
+			m::recorder::capture(ch->index, G_ACTION_KILL, m::clock::getFrameAt(localFrame));
 			ch->hasActions = true;
 		}
 	}
@@ -96,10 +98,10 @@ void shiftPress(SampleChannel* ch)
 			if (m::clock::isRunning() || ch->status == STATUS_OFF)
 				ch->getReadActions() ? c::channel::stopReadingRecs(ch) : c::channel::startReadingRecs(ch);
 			else
-				ch->kill(0);  // on frame 0: user-generated event
+				ch->kill(localFrame);  // user-generated event
 		}
 		else
-			ch->kill(0);    // on frame 0: user-generated event
+			ch->kill(localFrame);    // user-generated event
 	}
 }
 
@@ -107,7 +109,36 @@ void shiftPress(SampleChannel* ch)
 /* -------------------------------------------------------------------------- */
 
 
-void cleanPress(SampleChannel* ch, int velocity)
+/* deferPress
+A channel whose wave is still being loaded can't start: ask the loader to hurry
+up with it and keep the press for when the wave is in, or drop it if so
+configured. Returns false if the channel can start right away. */
+
+bool deferPress(SampleChannel* ch, int velocity)
+{
+	if (!ch->loading)
+		return false;
+
+	ch->wanted = true;
+	m::commands::notify(m::commands::WAVES_WANTED);
+
+	if (m::conf::lazySkipStart)
+		return true;
+
+	/* The wave might have landed in the meantime. Whoever takes the pending
+	velocity back starts the channel, either here or the GUI on commit. */
+
+	ch->pendingVelocity = velocity;
+	if (ch->loading)
+		return true;
+	return ch->pendingVelocity.exchange(-1) == -1;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void cleanPress(SampleChannel* ch, int velocity, int localFrame)
 {
 	/* Record now if the quantizer is off, otherwise let mixer to handle it when a
 	quantoWait has passed. Moreover, KEYPRESS and KEYREL are meaningless for loop
@@ -118,38 +149,32 @@ void cleanPress(SampleChannel* ch, int velocity)
 			!(ch->mode & LOOP_ANY))
 	{
 		if (ch->mode == SINGLE_PRESS) {
-			m::recorder::startOverdub(ch->index, G_ACTION_KEYS, m::clock::getCurrentFrame(),
-				m::kernelAudio::getRealBufSize());
+			m::recorder::captureOverdubStart(ch->index, G_ACTION_KEYS,
+				m::clock::getFrameAt(localFrame), m::kernelAudio::getRealBufSize());
 			ch->setReadActions(false, false);   // don't read actions while overdubbing
 		}
 		else {
-			m::recorder::rec(ch->index, G_ACTION_KEYPRESS, m::clock::getCurrentFrame());
-			ch->hasActions = true;
 
-			/* Why return here? You record an action and then you call ch->start:
-			Mixer, which is on another thread, reads your newly recorded action if you
-			have readActions == true, and then ch->start kicks in right after it.
-			The result: Mixer plays the channel (due to the new action) but ch->start
-			kills it right away (because the sample is playing). Fix: call ch->start
-			only if you are not recording anything, i.e. let Mixer play it. */
+			/* The action is recorded later on by the GUI, with a frame already gone
+			by: start the channel right here, Mixer won't play it twice. */
 
-			if (ch->getReadActions())
-				return;
+			m::recorder::capture(ch->index, G_ACTION_KEYPRESS, m::clock::getFrameAt(localFrame));
+			ch->hasActions = true;
 		}
 	}
 
-	/* This is a user-generated event, so it's on frame 0. For one-shot modes,
+	/* This is a user-generated event, on frame 'localFrame'. For one-shot modes,
 	velocity drives the internal volume. */
 
 	if (ch->mode & SINGLE_ANY && ch->midiInVeloAsVol)
 		ch->setVolumeI(u::math::map((float)velocity, 0.0f, 127.0f, 0.0f, 1.0f));
 
-	ch->start(0, m::clock::getQuantize() != 0, m::clock::isRunning(), false, true);
+	ch->start(localFrame, m::clock::getQuantize() != 0, m::clock::isRunning(), false, true);
 }
 
-void cleanRecPress(SampleChannel* ch)
+void cleanRecPress(SampleChannel* ch, int localFrame)
 {
-	ch->rec(0, m::clock::getQuantize() != 0, m::clock::isRunning(), false, true);
+	ch->rec(localFrame, m::clock::getQuantize() != 0, m::clock::isRunning(), false, true);
 }
 
 } // {anonymous}
@@ -160,72 +185,78 @@ void cleanRecPress(SampleChannel* ch)
 /* -------------------------------------------------------------------------- */
 
 
-void keyPress(ResourceChannel* ch, bool ctrl, bool shift, int velocity)
+void keyPress(ResourceChannel* ch, bool ctrl, bool shift, int velocity, int localFrame)
 {
 	if (ch->type == G_CHANNEL_SAMPLE)
-		keyPress(static_cast<SampleChannel*>(ch), ctrl, shift, velocity);
+		keyPress(static_cast<SampleChannel*>(ch), ctrl, shift, velocity, localFrame);
 	else
-		keyPress(static_cast<MidiChannel*>(ch), ctrl, shift);
+		keyPress(static_cast<MidiChannel*>(ch), ctrl, shift, localFrame);
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void keyRelease(ResourceChannel* ch, bool ctrl, bool shift)
+void keyRelease(ResourceChannel* ch, bool ctrl, bool shift, int localFrame)
 {
 	if (ch->type == G_CHANNEL_SAMPLE)
-		keyRelease(static_cast<SampleChannel*>(ch), ctrl, shift);
+		keyRelease(static_cast<SampleChannel*>(ch), ctrl, shift, localFrame);
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void keyPress(MidiChannel* ch, bool ctrl, bool shift)
+void keyPress(MidiChannel* ch, bool ctrl, bool shift, int localFrame)
 {
 	if (ctrl)
 		c::channel::toggleMute(ch);
 	else
 	if (shift)
-		ch->kill(0);        // on frame 0: user-generated event
+		ch->kill(localFrame);        // user-generated event
 	else
-		ch->start(0, true, m::clock::isRunning(), false, true); // on frame 0: user-generated event
+		ch->start(localFrame, true, m::clock::isRunning(), false, true); // user-generated event
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void keyPress(SampleChannel* ch, bool ctrl, bool shift, int velocity)
+void keyPress(SampleChannel* ch, bool ctrl, bool shift, int velocity, int localFrame)
 {
 	if (ctrl)
 		ctrlPress(ch);
 	else if (shift)
-		shiftPress(ch);
+		shiftPress(ch, localFrame);
 	else
-		cleanPress(ch, velocity);
+	if (!deferPress(ch, velocity))
+		cleanPress(ch, velocity, localFrame);
 }
 
 
 /* -------------------------------------------------------------------------- */
 
 
-void keyRelease(SampleChannel* ch, bool ctrl, bool shift)
+void keyRelease(SampleChannel* ch, bool ctrl, bool shift, int localFrame)
 {
 	using namespace giada::m;
 
 	if (ctrl || shift)
 		return;
 
+	/* A single press channel released before its wave is in must not start when
+	the wave lands: take the pending press back. */
+
+	if (ch->mode == SINGLE_PRESS && ch->loading)
+		ch->pendingVelocity.exchange(-1);
+
 	ch->stop();
 
 	/* record a key release only if channel is single_press. For any
 	 * other mode the KEY REL is meaningless. */
 
 	if (ch->mode == SINGLE_PRESS && recorder::canRec(ch, clock::isRunning(), mixer::recording))
-		recorder::stopOverdub(clock::getCurrentFrame(), clock::getFramesInLoop(),
-			&mixer::mutex_recs);
+		recorder::captureOverdubStop(clock::getFrameAt(localFrame), clock::getFramesInLoop());
 
 	/* the GUI update is done by gui_refresh() */
 
@@ -236,10 +267,10 @@ void keyRelease(SampleChannel* ch, bool ctrl, bool shift)
 /* -------------------------------------------------------------------------- */
 
 
-void recPress(ResourceChannel* ch, bool ctrl, bool shift)
+void recPress(ResourceChannel* ch, bool ctrl, bool shift, int localFrame)
 {
 	if (ch->getType() == G_CHANNEL_SAMPLE)
-		recPress(static_cast<SampleChannel*>(ch), ctrl, shift);
+		recPress(static_cast<SampleChannel*>(ch), ctrl, shift, localFrame);
 	//else
 	//	recPress(static_cast<MidiChannel*>(ch), ctrl, shift);
 }
@@ -247,14 +278,14 @@ void recPress(ResourceChannel* ch, bool ctrl, bool shift)
 /* -------------------------------------------------------------------------- */
 
 
-void recPress(SampleChannel* ch, bool ctrl, bool shift)
+void recPress(SampleChannel* ch, bool ctrl, bool shift, int localFrame)
 {
 	/*if (ctrl)
 		ctrlRecPress(ch);
 	else if (shift)
 		shiftRecPress(ch);
 	else*/
-		cleanRecPress(ch);
+		cleanRecPress(ch, localFrame);
 }
 
 
@@ -48,21 +48,24 @@ namespace io
 /* keyPress / keyRelease
  * handle the key pressure, either via mouse/keyboard or MIDI. If gui
  * is true it means that the event comes from the main window (mouse,
- * keyb or MIDI), otherwise the event comes from the action recorder. */
+ * keyb or MIDI), otherwise the event comes from the action recorder.
+ * They mutate channels: call them from the audio thread only, i.e.
+ * through m::commands. 'localFrame' is the frame of the current block
+ * the event belongs to. */
 
-void keyPress  (ResourceChannel*       ch, bool ctrl, bool shift, int velocity);
-void keyPress  (SampleChannel* ch, bool ctrl, bool shift, int velocity);
-void keyPress  (MidiChannel*   ch, bool ctrl, bool shift);
-void keyRelease(ResourceChannel*       ch, bool ctrl, bool shift);
-void keyRelease(SampleChannel* ch, bool ctrl, bool shift);
+void keyPress  (ResourceChannel*       ch, bool ctrl, bool shift, int velocity, int localFrame=0);
+void keyPress  (SampleChannel* ch, bool ctrl, bool shift, int velocity, int localFrame=0);
+void keyPress  (MidiChannel*   ch, bool ctrl, bool shift, int localFrame=0);
+void keyRelease(ResourceChannel*       ch, bool ctrl, bool shift, int localFrame=0);
+void keyRelease(SampleChannel* ch, bool ctrl, bool shift, int localFrame=0);
 
 /* recPress
  * handle the key pressure, either via mouse/keyboard or MIDI. If gui
  * is true it means that the event comes from the main window (mouse,
  * keyb or MIDI), otherwise the event comes from the action recorder. */
 
-void recPress  (ResourceChannel*       ch, bool ctrl, bool shift);
-void recPress  (SampleChannel* ch, bool ctrl, bool shift);
+void recPress  (ResourceChannel*       ch, bool ctrl, bool shift, int localFrame=0);
+void recPress  (SampleChannel* ch, bool ctrl, bool shift, int localFrame=0);
 
 /* start/stopActionRec
 Handles the action recording. If gui == true the signal comes from an user
@@ -40,6 +40,7 @@
 #include "../core/midiChannel.h"
 #include "../core/columnChannel.h"
 #include "../core/clock.h"
+#include "../core/commands.h"
 #include "../core/kernelMidi.h"
 #include "../core/kernelAudio.h"
 #include "../core/conf.h"
@@ -47,6 +48,7 @@
 #include "../core/pluginHost.h"
 #endif
 #include "main.h"
+#include "storage.h"
 
 
 extern gdMainWindow *G_MainWin;
@@ -62,31 +64,14 @@ void glue_setBpm(const char *v1, const char *v2)
 	if (mixer::recording)
 		return;
 
-	char  bpmS[6];
 	float bpmF = atof(v1) + (atof(v2)/10);
-	if (bpmF < 20.0f) {
+	if (bpmF < 20.0f)
 		bpmF = 20.0f;
-		sprintf(bpmS, "20.0");
-	}
-	else
-		sprintf(bpmS, "%s.%s", v1, !strcmp(v2, "") ? "0" : v2);
-
-	/* a value such as atof("120.1") will never be 120.1 but 120.0999999,
-	 * because of the rounding error. So we pass the real "wrong" value to
-	 * G_Mixer and we show the nice looking (but fake) one to the GUI. */
 
-	float oldBpmF = clock::getBpm();
-	clock::setBpm(bpmF);
-	recorder::updateBpm(oldBpmF, bpmF, clock::getQuanto());
-
-#ifdef __linux__
-	kernelAudio::jackSetBpm(clock::getBpm());
-#endif
+	/* The engine applies the change at the next block, or refuses it while
+	recording: the GUI shows the new value when the engine notifies it. */
 
-	gu_refreshActionEditor();
-	G_MainWin->mainTimer->setBpm(bpmS);
-
-	gu_log("[glue] Bpm changed to %s (real=%f)\n", bpmS, clock::getBpm());
+	commands::push(commands::SET_BPM, -1, false, false, true, bpmF);  // notify jack
 }
 
 
@@ -97,10 +82,9 @@ void glue_setBpm(float v)
 {
 	if (v < G_MIN_BPM || v > G_MAX_BPM)
 		v = G_DEFAULT_BPM;
-	double fIpart;
-	double fPpart = modf(v, &fIpart);
-	int iIpart = fIpart;
-	int iPpart = ceilf(fPpart);
+	int tenths = roundf(v * 10);  // one decimal digit, as in the GUI
+	int iIpart = tenths / 10;
+	int iPpart = tenths % 10;
 	glue_setBpm(gu_iToString(iIpart).c_str(), gu_iToString(iPpart).c_str());
 }
 
@@ -113,17 +97,18 @@ void glue_setBeats(int beats, int bars, bool expand)
 	/* Temp vars to store old data (they are necessary) */
 
 	int oldBeats = clock::getBeats();
-	unsigned oldTotalFrames = clock::getFramesInLoop();
 
 	clock::setBeats(beats);
 	clock::setBars(bars);
 	clock::updateFrameBars();
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats(), &mixer::mutex_recs);
 
-	/* Update recorded actions, if 'expand' required and an expansion is taking
-	place. */
+	/* Resize recorded actions along with the loop, if required: copy them over
+	the new beats. Actions past the end of a shorter loop are kept, silent, in
+	case the loop grows back. */
 
 	if (expand && clock::getBeats() > oldBeats)
-		recorder::expand(oldTotalFrames, clock::getFramesInLoop());
+		recorder::expand(oldBeats, clock::getBeats(), &mixer::mutex_recs);
 
 	G_MainWin->mainTimer->setMeter(clock::getBeats(), clock::getBars());
 	gu_refreshActionEditor();  // in case the action editor is open
@@ -135,19 +120,7 @@ void glue_setBeats(int beats, int bars, bool expand)
 
 void glue_rewindSeq(bool gui, bool notifyJack)
 {
-	mh::rewindSequencer();
-
-	/* FIXME - potential desync when Quantizer is enabled from this point on.
-	Mixer would wait, while the following calls would be made regardless of its
-	state. */
-
-#ifdef __linux__
-	if (notifyJack)
-		kernelAudio::jackSetPosition(0);
-#endif
-
-	if (conf::midiSync == MIDI_SYNC_CLOCK_M)
-		kernelMidi::send(MIDI_POSITION_PTR, 0, 0);
+	commands::push(commands::REWIND_SEQ, -1, false, false, notifyJack);
 }
 
 
@@ -166,11 +139,8 @@ void glue_quantize(int val)
 void glue_setOutVol(float v, bool gui)
 {
 	mixer::outVol = v;
-	if (!gui) {
-		Fl::lock();
-		G_MainWin->mainIO->setOutVol(v);
-		Fl::unlock();
-	}
+	if (!gui)
+		glue_refreshOutVol();
 }
 
 
@@ -180,11 +150,30 @@ void glue_setOutVol(float v, bool gui)
 void glue_setInVol(float v, bool gui)
 {
 	mixer::inVol = v;
-	if (!gui) {
-		Fl::lock();
-		G_MainWin->mainIO->setInVol(v);
-		Fl::unlock();
-	}
+	if (!gui)
+		glue_refreshInVol();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void glue_refreshOutVol()
+{
+	Fl::lock();
+	G_MainWin->mainIO->setOutVol(mixer::outVol);
+	Fl::unlock();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void glue_refreshInVol()
+{
+	Fl::lock();
+	G_MainWin->mainIO->setInVol(mixer::inVol);
+	Fl::unlock();
 }
 
 
@@ -199,6 +188,7 @@ void glue_clearAllSamples()
 		mixer::columnChannels.at(i)->guiChannel->reset();
 	}
 	recorder::init();
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats(), &mixer::mutex_recs);
 	return;
 }
 
@@ -209,6 +199,7 @@ void glue_clearAllSamples()
 void glue_clearAllActions()
 {
 	recorder::init();
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats(), &mixer::mutex_recs);
 	for (ColumnChannel* cch : mixer::columnChannels)
 		for (ResourceChannel* ch : (*cch))
 			ch->hasActions = false;
@@ -222,13 +213,15 @@ void glue_clearAllActions()
 void glue_resetToInitState(bool resetGui, bool createColumns)
 {
 	gu_closeAllSubwindows();
+	glue_cancelLoading();
 	mixer::close();
 	clock::init(conf::samplerate, conf::midiTCfps);
 	mixer::init(clock::getFramesInLoop(), kernelAudio::getRealBufSize());
 	recorder::init();
+	recorder::updateClock(clock::getFramesInLoop(), clock::getBeats());
 #ifdef WITH_VST
-	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::inputChannels, &mixer::mutex_plugins);
-	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::columnChannels, &mixer::mutex_plugins);
+	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::inputChannels);
+	pluginHost::freeAllStacks((std::vector<Channel*>*)&mixer::columnChannels);
 #endif
 
 	G_MainWin->keyboard->clear();
@@ -42,6 +42,12 @@ void glue_setBeats(int beats, int bars, bool expand);
 void glue_quantize(int val);
 void glue_setOutVol(float v, bool gui=true);
 void glue_setInVol(float v, bool gui=true);
+
+/* glue_refresh[Out|In]Vol
+Update master volume widgets after a change made by the engine. */
+
+void glue_refreshOutVol();
+void glue_refreshInVol();
 void glue_clearAllSamples();
 void glue_clearAllActions();
 
@@ -29,6 +29,8 @@
 #include "../gui/dialogs/gd_warnings.h"
 #include "../gui/elems/config/tabMidi.h"
 #include "../core/midiDeviceHandler.h"
+#include "../core/inputChannel.h"
+#include "../core/mixer.h"
 #include "../core/const.h"
 #include "../utils/gui.h"
 #include "midi.h"
@@ -65,6 +67,12 @@ void deleteMidiDevice(m::MidiDevice* dev, bool warn) {
   	if (!gdConfirmWin("Warning", "Delete MIDI Device: are you sure?"))
   		return;
 	}
+
+	/* The device is deleted later on: input channels must forget it now. */
+
+	for (InputChannel* ch : m::mixer::inputChannels)
+		if (ch->midiInput == dev)
+			ch->midiInput = nullptr;
   m::mdh::deleteMidiDevice(dev);
 
   gdConfig* config = static_cast<gdConfig*>(gu_getSubwindow(G_MainWin, WID_CONFIG));
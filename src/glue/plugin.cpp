@@ -32,9 +32,13 @@
 #include "../core/mixer.h"
 #include "../core/plugin.h"
 #include "../core/channel.h"
+#include "../core/inputChannel.h"
+#include "../core/columnChannel.h"
+#include "../core/resourceChannel.h"
 #include "../core/const.h"
 #include "../core/conf.h"
 #include "../utils/gui.h"
+#include "../utils/fs.h"
 #include "../gui/dialogs/gd_mainWindow.h"
 #include "../gui/dialogs/pluginWindow.h"
 #include "../gui/dialogs/pluginList.h"
@@ -70,6 +74,20 @@ gdPluginWindow* getPluginWindow(const Plugin* p)
 		return nullptr;
 	return static_cast<gdPluginWindow*>(gu_getSubwindow(parent, p->getId() + 1));
 }
+
+
+/* getChannel
+Returns the resource channel whose stack contains plug-in 'p', if any. */
+
+Channel* getChannel(const Plugin* p)
+{
+	for (ColumnChannel* cch : mixer::columnChannels)
+		for (ResourceChannel* ch : (*cch))
+			for (const Plugin* plugin : ch->getPlugins())
+				if (plugin == p)
+					return ch;
+	return nullptr;
+}
 } // {anonymous}
 
 
@@ -78,11 +96,11 @@ gdPluginWindow* getPluginWindow(const Plugin* p)
 /* -------------------------------------------------------------------------- */
 
 
-Plugin* addPlugin(Channel* ch, int index)
+void addPlugin(Channel* ch, int index)
 {
   if (index >= pluginHost::countAvailablePlugins())
-    return nullptr;
-  return pluginHost::addPlugin(index, &mixer::mutex_plugins, ch);
+    return;
+  pluginHost::loadPlugin(index, ch);
 }
 
 
@@ -91,7 +109,7 @@ Plugin* addPlugin(Channel* ch, int index)
 
 void swapPlugins(Channel* ch, int index1, int index2)
 {
-  pluginHost::swapPlugin(index1, index2, &mixer::mutex_plugins, ch);
+  pluginHost::swapPlugin(index1, index2, ch);
 }
 
 
@@ -100,7 +118,7 @@ void swapPlugins(Channel* ch, int index1, int index2)
 
 void freePlugin(Channel* ch, int index)
 {
-  pluginHost::freePlugin(index, &mixer::mutex_plugins, ch);
+  pluginHost::freePlugin(index, ch);
 }
 
 
@@ -132,7 +150,24 @@ void setProgram(Plugin* p, int index)
 void setParameter(Plugin* p, int index, float value, bool gui)
 {
 	p->setParameter(index, value);
+	refreshParameter(p, index, gui);
+
+	/* Moves from the GUI are recorded as automation, if action recording is
+	on. */
+
+	if (gui) {
+		Channel* ch = getChannel(p);
+		if (ch != nullptr)
+			pluginHost::captureParameter(ch, p, index, value);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
 
+
+void refreshParameter(Plugin* p, int index, bool gui)
+{
 	/* No need to update plug-in editor if it has one: the plug-in's editor takes
 	care of it on its own. Conversely, update the specific parameter for UI-less 
 	plug-ins. */
@@ -153,6 +188,28 @@ void setParameter(Plugin* p, int index, float value, bool gui)
 /* -------------------------------------------------------------------------- */
 
 
+void dumpMetrics()
+{
+	std::vector<Channel*> channels;
+	for (InputChannel* ich : mixer::inputChannels)
+		channels.push_back(ich);
+	for (ColumnChannel* cch : mixer::columnChannels) {
+		channels.push_back(cch);
+		for (ResourceChannel* rch : *cch)
+			channels.push_back(rch);
+	}
+
+	std::string path = gu_getHomePath() + G_SLASH + G_PLUGIN_METRICS_FILE;
+	if (pluginHost::writeMetrics(path, channels))
+		gdAlert(("Plug-in metrics written to\n" + path).c_str());
+	else
+		gdAlert("Unable to write plug-in metrics!");
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void setPluginPathCb(void* data)
 {
 	gdBrowserDir* browser = (gdBrowserDir*) data;
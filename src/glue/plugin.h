@@ -43,12 +43,28 @@ namespace giada {
 namespace c     {
 namespace plugin 
 {
-Plugin* addPlugin(Channel* ch, int index);
+/* addPlugin
+Asks for plug-in 'index' in the list of available ones to be loaded in the
+background. The plug-in list is refreshed once it lands in the stack. */
+
+void addPlugin(Channel* ch, int index);
 void swapPlugins(Channel* ch, int indexP1, int indexP2);
 void freePlugin(Channel* ch, int index);
 void setParameter(Plugin* p, int index, float value, bool gui=true); 
 void setProgram(Plugin* p, int index);
 
+/* refreshParameter
+Updates the window of a UI-less plug-in after parameter 'index' has been changed
+elsewhere, e.g. by MIDI input. */
+
+void refreshParameter(Plugin* p, int index, bool gui=false);
+
+/* dumpMetrics
+Writes CPU load and latency of every plug-in in use to G_PLUGIN_METRICS_FILE,
+in the configuration directory, and tells the user where it is. */
+
+void dumpMetrics();
+
 /* setPluginPathCb
 Callback attached to the DirBrowser for adding new Plug-in search paths in the
 configuration window. */
@@ -25,9 +25,12 @@
  * -------------------------------------------------------------------------- */
 
 
+#include <algorithm>
+#include <FL/Fl.H>
 #include "../core/mixer.h"
 #include "../core/metronome.h"
 #include "../core/mixerHandler.h"
+#include "../core/recorder.h"
 #include "../core/channel.h"
 #include "../core/pluginHost.h"
 #include "../core/plugin.h"
@@ -41,6 +44,9 @@
 #include "../core/waveManager.h"
 #include "../core/clock.h"
 #include "../core/wave.h"
+#include "../core/waveLoader.h"
+#include "../core/channelManager.h"
+#include "../core/commands.h"
 #include "../utils/gui.h"
 #include "../utils/log.h"
 #include "../utils/string.h"
@@ -76,6 +82,7 @@ static void glue_fillPatchGlobalsPlugins__(vector <Plugin*>* host, vector<m::pat
 		patch::plugin_t ppl;
 		ppl.path = pl->getUniqueId();
 		ppl.bypass = pl->isBypassed();
+		ppl.state = pl->getState();
 		int numParams = pl->getNumParameters();
 		for (int k=0; k<numParams; k++)
 			ppl.params.push_back(pl->getParameter(k));
@@ -91,26 +98,17 @@ static void glue_fillPatchGlobalsPlugins__(vector <Plugin*>* host, vector<m::pat
 
 static void glue_fillPatchColumns__()
 {
-	// FIXME
-	/*using namespace giada::m;
+	using namespace giada::m;
 
-	for (unsigned i=0; i<G_MainWin->keyboard->getTotalColumns(); i++) {
-		geColumn *gCol = G_MainWin->keyboard->getColumn(i);
+	for (unsigned i=0; i<mixer::columnChannels.size(); i++) {
+		ColumnChannel* cch = mixer::columnChannels.at(i);
 		patch::column_t pCol;
-		pCol.index = gCol->getIndex();
-		pCol.width = gCol->w();
-		for (int k=0; k<gCol->countChannels(); k++) {
-			Channel *colChannel = gCol->getChannel(k);
-			for (unsigned j=0; j<mixer::channels.size(); j++) {
-				Channel *mixerChannel = mixer::channels.at(j);
-				if (colChannel == mixerChannel) {
-					pCol.channels.push_back(mixerChannel->index);
-					break;
-				}
-			}
-		}
+		pCol.index = i;
+		pCol.width = ((geColumn*) cch->guiChannel)->w();
+		for (ResourceChannel* ch : (*cch))
+			pCol.channels.push_back(ch->index);
 		patch::columns.push_back(pCol);
-	}*/
+	}
 }
 
 
@@ -124,10 +122,13 @@ static void glue_fillPatchChannels__(bool isProject)
 	for (InputChannel* ich : mixer::inputChannels)
 		ich->writePatch(isProject);
 
-	for (ColumnChannel* cch : mixer::columnChannels) {
+	for (unsigned i=0; i<mixer::columnChannels.size(); i++) {
+		ColumnChannel* cch = mixer::columnChannels.at(i);
 		cch->writePatch(isProject);
-		for (ResourceChannel* ch : (*cch))
+		for (ResourceChannel* ch : (*cch)) {
 			ch->writePatch(isProject);
+			patch::channels.back().column = i;
+		}
 	}
 }
 
@@ -151,6 +152,7 @@ static void glue_fillPatchGlobals__(const string &name)
 	patch::masterVolIn  = mixer::inVol;
 	patch::masterVolOut = mixer::outVol;
 	patch::metronome    = metronome::on;
+	patch::samplerate   = conf::samplerate;
 
 #ifdef WITH_VST
 
@@ -163,6 +165,33 @@ static void glue_fillPatchGlobals__(const string &name)
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/* glue_loadBrowser__, glue_loadStep__, glue_loadWaiting__
+State of the patch load in progress. The browser pointer is watched by FLTK and
+becomes null if the window is closed in the meantime. 'glue_loadWaiting__' is
+true while the load waits for all samples before finishing (no lazy loading),
+'glue_loadStep__' being the progress bar step per sample. */
+
+static Fl_Widget* glue_loadBrowser__ = nullptr;
+static float      glue_loadStep__    = 0.0f;
+static bool       glue_loadWaiting__ = false;
+
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_isLoading__
+Saving while samples are still being loaded would lose them: refuse. */
+
+static bool glue_isLoading__()
+{
+	if (m::waveLoader::countPending() == 0)
+		return false;
+	gdAlert("Some samples are still loading, please try again later.");
+	return true;
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 
@@ -171,6 +200,9 @@ static bool glue_savePatch__(const string &fullPath, const string &name,
 {
 	using namespace giada::m;
 
+	if (glue_isLoading__())
+		return false;
+
 	patch::init();
 
 	glue_fillPatchGlobals__(name);
@@ -211,6 +243,205 @@ static string glue_makeUniqueSamplePath__(const string& base, const SampleChanne
 }
 
 
+/* -------------------------------------------------------------------------- */
+
+/* glue_isWaveUnchanged__
+Tells whether the Wave content still matches the file it was last read from or
+written to, and that file hasn't been touched on disk since. Such samples don't
+need to be encoded again. */
+
+static bool glue_isWaveUnchanged__(const Wave* w)
+{
+	if (w->isLogical() || w->getSavedFileId().empty())
+		return false;
+	if (w->isEdited() && w->hash() != w->getSavedHash())
+		return false;
+	return gu_fileId(w->getPath()) == w->getSavedFileId();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_readPatchChannels__
+Creates columns and channels from the patch and commits them to the engine
+right away. Sample channels start empty: their waves are queued to the
+waveLoader and pushed later by glue_commitWave__(). Plug-ins come later, see
+glue_readPatchPlugins__(). */
+
+static vector<m::waveLoader::Request> glue_readPatchChannels__(const string& basePath)
+{
+	using namespace giada::m;
+
+	for (const patch::channel_t& pch : patch::channels)
+		mh::reserveChannelIndex(pch.index);
+
+	vector<waveLoader::Request> requests;
+
+	for (const patch::column_t& col : patch::columns) {
+		ColumnChannel* cch = c::channel::addColumnChannel(col.width);
+		for (unsigned k=0; k<patch::channels.size(); k++) {
+			const patch::channel_t& pch = patch::channels.at(k);
+			if (pch.column != col.index)
+				continue;
+			ResourceChannel* ch = c::channel::addResourceChannel(cch, pch.type, pch.size);
+			if (ch == nullptr)
+				continue;
+			ch->readPatch(basePath, k);
+			if (pch.type == G_CHANNEL_SAMPLE && !pch.samplePath.empty()) {
+				static_cast<SampleChannel*>(ch)->loading = true;
+				requests.push_back({ ch->index, (int) k, (int) requests.size(),
+					basePath + pch.samplePath });
+			}
+		}
+	}
+	recorder::sortActions();  // compiles envelopes of the actions just read
+	return requests;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef WITH_VST
+
+/* glue_readPatchPlugins__
+Creates the plug-ins of every channel read from the patch, all stacks at
+once. */
+
+static void glue_readPatchPlugins__()
+{
+	using namespace giada::m;
+
+	vector<pluginHost::StackRequest> requests;
+	for (unsigned k=0; k<patch::channels.size(); k++) {
+		Channel* ch = mh::getChannelByIndex(patch::channels.at(k).index);
+		if (ch != nullptr)
+			requests.push_back(channelManager::readPlugins(ch, k));
+	}
+	pluginHost::addPlugins(requests);
+}
+
+#endif
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_commitWave__
+Hands a decoded wave to its channel, if the channel still exists. Then starts
+the channel if it was pressed while loading. */
+
+static void glue_commitWave__(const m::waveLoader::Result& r)
+{
+	using namespace giada::m;
+
+	Channel* ch = mh::getChannelByIndex(r.chan);
+	if (ch == nullptr || ch->type != G_CHANNEL_SAMPLE) {
+		delete r.wave;
+		return;
+	}
+
+	SampleChannel* sch = static_cast<SampleChannel*>(ch);
+	channelManager::readWave(sch, r.index, r.wave, r.res);
+	sch->loading = false;
+	G_MainWin->keyboard->updateChannel(ch->guiChannel);
+
+	int velocity = sch->pendingVelocity.exchange(-1);
+	if (velocity != -1 && r.res == G_RES_OK)
+		commands::push(commands::KEY_PRESS, sch->index, false, false, velocity);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_setLoadStatus__
+Moves the progress bar of the load browser, if still open. */
+
+static void glue_setLoadStatus__(float v)
+{
+	if (glue_loadBrowser__ != nullptr)
+		static_cast<gdBrowserLoad*>(glue_loadBrowser__)->setStatusBar(v);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_finishLoad__
+Last step of glue_loadPatch(): refreshes the GUI and hands control back to the
+load browser, if still open. */
+
+static void glue_finishLoad__()
+{
+	using namespace giada::m;
+
+	glue_loadWaiting__ = false;
+
+	gu_updateControls();
+	gu_updateMainWinLabel(patch::name);
+
+	glue_setLoadStatus__(0.1f);
+
+	gu_log("[glue] patch loaded successfully\n");
+
+#ifdef WITH_VST
+
+	if (pluginHost::hasMissingPlugins())
+		gdAlert("Some plugins were not loaded successfully.\nCheck the plugin browser to know more.");
+
+#endif
+
+	Fl_Widget* browser = glue_loadBrowser__;
+	Fl::release_widget_pointer(glue_loadBrowser__);
+	glue_loadBrowser__ = nullptr;
+	if (browser != nullptr)
+		browser->do_callback();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+/* glue_pollWaves__
+Commits waves as they come, until none is left. Then finishes the load if it
+was waiting for them. */
+
+static void glue_pollWaves__(void* data)
+{
+	int collected = m::waveLoader::collect(glue_commitWave__);
+	if (glue_loadWaiting__)
+		glue_setLoadStatus__(glue_loadStep__ * collected);
+
+	if (m::waveLoader::countPending() > 0)
+		Fl::repeat_timeout(G_GUI_LOAD_POLL_RATE, glue_pollWaves__);
+	else
+	if (glue_loadWaiting__)
+		glue_finishLoad__();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void glue_cancelLoading()
+{
+	using namespace giada::m;
+
+	Fl::remove_timeout(glue_pollWaves__);
+	waveLoader::cancel();
+
+	glue_loadWaiting__ = false;
+	Fl::release_widget_pointer(glue_loadBrowser__);
+	glue_loadBrowser__ = nullptr;
+
+	/* Channels whose wave was dropped would wait for it forever, swallowing every
+	key press. */
+
+	for (ColumnChannel* cch : mixer::columnChannels)
+		for (ResourceChannel* ch : (*cch))
+			if (ch->type == G_CHANNEL_SAMPLE) {
+				SampleChannel* sch = static_cast<SampleChannel*>(ch);
+				sch->loading = false;
+				sch->pendingVelocity = -1;
+			}
+}
+
+
 /* -------------------------------------------------------------------------- */
 
 
@@ -260,6 +491,11 @@ void glue_loadPatch(void* data)
 		basePath   = fullPath + G_SLASH;
 	}
 
+	/* Waves still loading from the previous patch refer to patch::channels: drop
+	them before reading the new one. */
+
+	glue_cancelLoading();
+
 	int res = patch::read(fileToLoad);
 	if (res != PATCH_READ_OK) {
 		if (res == PATCH_UNREADABLE)
@@ -281,60 +517,48 @@ void glue_loadPatch(void* data)
 
 	glue_resetToInitState(false, false);
 
-	browser->setStatusBar(0.1f);
+	/* From now on the GUI stays alive while loading: the browser may be closed
+	at any time. Watch it. */
 
-	/* Add common stuff, columns and channels. Also increment the progress bar by
-	0.8 / total_channels steps.  */
+	glue_loadBrowser__ = browser;
+	Fl::watch_widget_pointer(glue_loadBrowser__);
 
-	// TODO: fix this
-	/*
-	float steps = 0.8 / patch::channels.size();
+	glue_setLoadStatus__(0.1f);
 
-	for (const patch::column_t& col : patch::columns) {
-		G_MainWin->keyboard->addColumn(col.width);
-		unsigned k = 0;
-		for (const patch::channel_t& pch : patch::channels) {
-			if (pch.column == col.index) {
-				Channel* ch = c::channel::addChannel(pch.column, pch.type, pch.size);
-				ch->readPatch(basePath, k);
-			}
-			browser->setStatusBar(steps);
-			k++;
-		}
-	}*/
+	/* Add columns and channels, then decode all samples in parallel, column by
+	column and top to bottom. The loader is started first, so that plug-ins are
+	instantiated while the first waves are being decoded. */
+
+	vector<waveLoader::Request> requests = glue_readPatchChannels__(basePath);
+	waveLoader::start(requests);
+#ifdef WITH_VST
+	glue_readPatchPlugins__();
+#endif
 
 	/* Prepare Mixer. */
 
 	mh::updateSoloCount();
 	mh::readPatch();
 
-	/* Let recorder recompute the actions' positions if the current
-	samplerate != patch samplerate. */
-
-	recorder::updateSamplerate(conf::samplerate, patch::samplerate);
-
 	/* Save patchPath by taking the last dir of the broswer, in order to reuse it
 	the next time. */
 
 	conf::patchPath = gu_dirname(fullPath);
 
-	/* Refresh GUI. */
+	/* Push waves to their channels as they become ready. The engine plays in the
+	meantime: a channel works as soon as its wave is in. With lazy loading finish
+	right away, waves keep coming in background. Otherwise the poller increments
+	the progress bar by 0.8 / total_samples steps and finishes the load when the
+	last wave is in. glue_cancelLoading() stops both. */
 
-	gu_updateControls();
-	gu_updateMainWinLabel(patch::name);
-
-	browser->setStatusBar(0.1f);
-
-	gu_log("[glue] patch loaded successfully\n");
-
-#ifdef WITH_VST
+	Fl::add_timeout(G_GUI_LOAD_POLL_RATE, glue_pollWaves__);
 
-	if (pluginHost::hasMissingPlugins())
-		gdAlert("Some plugins were not loaded successfully.\nCheck the plugin browser to know more.");
-
-#endif
-
-	browser->do_callback();
+	if (conf::lazyLoading)
+		glue_finishLoad__();
+	else {
+		glue_loadStep__    = 0.8f / std::max<size_t>(1, requests.size());
+		glue_loadWaiting__ = true;
+	}
 }
 
 
@@ -355,6 +579,9 @@ void glue_saveProject(void* data)
 		return;
 	}
 
+	if (glue_isLoading__())
+		return;
+
 	if (gu_isProject(fullPath) && !gdConfirmWin("Warning", "Project exists: overwrite?"))
 		return;
 
@@ -368,7 +595,9 @@ void glue_saveProject(void* data)
 	/* Copy all samples inside the folder. Takes and logical ones are saved via
 	glue_saveSample(). Update the new sample path: everything now comes from the
 	project folder (folderPath). Also make sure the file path is unique inside the
-	project folder.*/
+	project folder. Samples unchanged since the last load or save are not
+	encoded again: they are left in place when already there, hard-linked
+	otherwise. */
 
 	for (ColumnChannel* cch : mixer::columnChannels) {
 		for (ResourceChannel* ch : (*cch)) {
@@ -381,11 +610,27 @@ void glue_saveProject(void* data)
 			if (sch == nullptr || sch->wave == nullptr)
 				continue;
 
-			sch->wave->setPath(glue_makeUniqueSamplePath__(fullPath, sch));
+			Wave*  wave  = sch->wave;
+			string path = glue_makeUniqueSamplePath__(fullPath, sch);
+
+			if (glue_isWaveUnchanged__(wave)) {
+				if (gu_isSameFile(wave->getPath(), path)) {
+					gu_log("[glue_saveProject] File %s unchanged, skipped\n", path.c_str());
+					continue;
+				}
+				if (gu_linkFile(wave->getPath(), path)) {
+					gu_log("[glue_saveProject] Link file to %s\n", path.c_str());
+					wave->setPath(path);
+					wave->setSaved(gu_fileId(path), wave->getSavedHash());
+					continue;
+				}
+			}
+
+			wave->setPath(path);
 
-			gu_log("[glue_saveProject] Save file to %s\n", sch->wave->getPath().c_str());
+			gu_log("[glue_saveProject] Save file to %s\n", path.c_str());
 
-			waveManager::save(sch->wave, sch->wave->getPath()); // TODO - error checking
+			waveManager::save(wave, path); // TODO - error checking
 		}
 	}
 
@@ -35,5 +35,11 @@ void glue_saveProject(void *data);
 void glue_saveSample (void *data);
 void glue_loadSample (void *data);
 
+/* glue_cancelLoading
+Stops the patch load in progress, if any: samples still being decoded are
+dropped and their channels are left empty. */
+
+void glue_cancelLoading();
+
 
 #endif
@@ -33,6 +33,7 @@
 #include "../utils/gui.h"
 #include "../core/const.h"
 #include "../core/clock.h"
+#include "../core/commands.h"
 #include "../core/kernelAudio.h"
 #include "../core/metronome.h"
 #include "../core/mixerHandler.h"
@@ -58,17 +59,9 @@ void glue_startStopSeq(bool gui)
 
 void glue_startSeq(bool gui)
 {
-	clock::start();
+	/* The engine will notify the GUI back once started. */
 
-#ifdef __linux__
-	kernelAudio::jackStart();
-#endif
-
-	if (!gui) {
-    Fl::lock();
-    G_MainWin->mainTransport->updatePlay(1);
-    Fl::unlock();
-  }
+	commands::push(commands::START_SEQ);
 }
 
 
@@ -77,37 +70,10 @@ void glue_startSeq(bool gui)
 
 void glue_stopSeq(bool gui)
 {
-	mh::stopSequencer();
-
-#ifdef __linux__
-	kernelAudio::jackStop();
-#endif
-
-	/* what to do if we stop the sequencer and some action recs are active?
-	 * Deactivate the button and delete any 'rec on' status */
-
-	if (recorder::active) {
-		recorder::active = false;
-    Fl::lock();
-	  G_MainWin->mainTransport->updateRecAction(0);
-	  Fl::unlock();
-	}
-
-	/* if input recs are active (who knows why) we must deactivate them.
-	 * One might stop the sequencer while an input rec is running. */
+	/* The engine will notify the GUI back once stopped, also about any action or
+	input recording it had to stop. */
 
-	if (mixer::recording) {
-		mh::stopInputRec();
-    Fl::lock();
-	  G_MainWin->mainTransport->updateRecInput(0);
-	  Fl::unlock();
-	}
-
-	if (!gui) {
-    Fl::lock();
-	  G_MainWin->mainTransport->updatePlay(0);
-	  Fl::unlock();
-  }
+	commands::push(commands::STOP_SEQ);
 }
 
 
@@ -304,7 +304,7 @@ void gdColumn::cb_posMute() {
 /* -------------------------------------------------------------------------- */
 
 void gdColumn::cb_changeVol() {
-	pColumn->setVolume(vol->value());
+	pColumn->resetVolume(vol->value());
 }
 
 /* -------------------------------------------------------------------------- */
@@ -25,6 +25,7 @@
 
 
 #include <cmath>
+#include <set>
 #include "../../utils/gui.h"
 #include "../../utils/string.h"
 #include "../../core/graphics.h"
@@ -32,6 +33,11 @@
 #include "../../core/const.h"
 #include "../../core/clock.h"
 #include "../../core/sampleChannel.h"
+#include "../../core/recorder.h"
+#ifdef WITH_VST
+#include "../../core/pluginHost.h"
+#include "../../core/plugin.h"
+#endif
 #include "../elems/basics/scroll.h"
 #include "../elems/basics/button.h"
 #include "../elems/basics/resizerBar.h"
@@ -121,6 +127,8 @@ gdActionEditor::gdActionEditor(Channel *chan)
 
 			vc->fill();
 
+			addParamLanes();
+
 			/* if channel is LOOP_ANY, deactivate it: a loop mode channel cannot
 			 * hold keypress/keyrelease actions */
 
@@ -174,6 +182,48 @@ gdActionEditor::~gdActionEditor()
 /* -------------------------------------------------------------------------- */
 
 
+void gdActionEditor::addParamLanes()
+{
+	std::set<uint32_t> keys;
+	recorder::forEachAction([&](const recorder::action* a)
+	{
+		if (a->chan == chan->index && a->type == G_ACTION_PARAM)
+			keys.insert(a->iValue);
+	});
+
+	Fl_Widget* last = vc;
+	for (uint32_t key : keys) {
+		string label = "param " + gu_iToString(recorder::getParamIndex(key));
+#ifdef WITH_VST
+		Plugin* p = pluginHost::getPluginByIndex(recorder::getParamPlugin(key), chan);
+		if (p != nullptr)
+			label = p->getName() + ": " + p->getParameterName(recorder::getParamIndex(key));
+#endif
+		geEnvelopeEditor* lane = new geEnvelopeEditor(scroller->x(),
+			last->y()+last->h()+8, this, G_ACTION_PARAM, G_RANGE_FLOAT, label, key);
+		scroller->add(lane);
+		lane->fill();
+		pc.push_back(lane);
+		last = lane;
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void gdActionEditor::resizeLanes()
+{
+	for (geEnvelopeEditor* lane : pc) {
+		lane->size(totalWidth, lane->h());
+		lane->updateActions();
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void gdActionEditor::cb_zoomIn(Fl_Widget *w, void *p)  { ((gdActionEditor*)p)->__cb_zoomIn(); }
 void gdActionEditor::cb_zoomOut(Fl_Widget *w, void *p) { ((gdActionEditor*)p)->__cb_zoomOut(); }
 
@@ -202,6 +252,7 @@ void gdActionEditor::__cb_zoomIn()
 			ac->updateActions();
 			mc->updateActions();
 			vc->updateActions();
+			resizeLanes();
 		}
 		else {
 			pr->size(totalWidth, pr->h());
@@ -239,6 +290,7 @@ void gdActionEditor::__cb_zoomOut()
 			ac->updateActions();
 			mc->updateActions();
 			vc->updateActions();
+			resizeLanes();
 		}
 		else {
 			pr->size(totalWidth, pr->h());
@@ -62,6 +62,16 @@ private:
 
 	void update();
 
+	/* addParamLanes
+	Adds one envelope lane for each plug-in parameter recorded on this channel. */
+
+	void addParamLanes();
+
+	/* resizeLanes
+	Applies the current zoom to all envelope lanes. */
+
+	void resizeLanes();
+
 public:
 
 	gdActionEditor(Channel *chan);
@@ -87,6 +97,8 @@ public:
 	geEnvelopeEditor *vc;
 	geNoteEditor     *pr;
 
+	std::vector<geEnvelopeEditor*> pc;  // plug-in parameter lanes
+
 	Channel *chan;
 
 	int zoom;
@@ -396,7 +396,7 @@ void gdInput::cb_posMute() {
 /* -------------------------------------------------------------------------- */
 
 void gdInput::cb_changeVol() {
-	ch->setVolume(vol->value());
+	ch->resetVolume(vol->value());
 }
 
 /* -------------------------------------------------------------------------- */
@@ -26,6 +26,7 @@
 
 
 #include "../../../core/midiDispatcher.h"
+#include "../../../core/commands.h"
 #include "../../../core/channel.h"
 #include "../../../core/conf.h"
 #include "../../../utils/log.h"
@@ -67,7 +68,10 @@ void gdMidiInputBase::stopMidiLearn(geMidiLearner* learner)
 
 void gdMidiInputBase::cb_learn(uint32_t* param, uint32_t msg, geMidiLearner* l)
 {
+	/* This runs on the MIDI thread: the GUI rebuilds the dispatch table. */
+
 	*param = msg;
+	commands::notify(commands::MIDI_BINDINGS_CHANGED);
 	stopMidiLearn(l);
 	gu_log("[gdMidiGrabber] MIDI learn done - message=0x%X\n", msg);
 }
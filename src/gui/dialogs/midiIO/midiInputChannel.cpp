@@ -188,7 +188,7 @@ void gdMidiInputChannel::addChannelLearners()
 
 void gdMidiInputChannel::addPluginLearners()
 {
-	vector<Plugin*>* plugins = &ch->plugins;
+	const vector<Plugin*>* plugins = &ch->getPlugins();
 	for (unsigned i=0; i<plugins->size(); i++) {
 
 		Fl_Pack* pack = new Fl_Pack(container->x() + ((i + 1) * (LEARNER_WIDTH + 8)),
@@ -44,6 +44,7 @@
 #include "../elems/basics/idButton.h"
 #include "../elems/basics/statusButton.h"
 #include "../elems/basics/choice.h"
+#include "../elems/basics/box.h"
 #include "../elems/mainWindow/mainIO.h"
 #include "../elems/mainWindow/keyboard/channel.h"
 #include "pluginChooser.h"
@@ -89,6 +90,8 @@ gdPluginList::gdPluginList(Channel* ch)
 
 	gu_setFavicon(this);
 	show();
+
+	Fl::add_timeout(G_GUI_PLUGIN_CPU_RATE, cb_refreshCpu, (void*) this);
 }
 
 
@@ -97,6 +100,7 @@ gdPluginList::gdPluginList(Channel* ch)
 
 gdPluginList::~gdPluginList()
 {
+	Fl::remove_timeout(cb_refreshCpu, (void*) this);
 	conf::pluginListX = x();
 	conf::pluginListY = y();
 }
@@ -106,6 +110,7 @@ gdPluginList::~gdPluginList()
 
 
 void gdPluginList::cb_addPlugin(Fl_Widget* v, void* p) { ((gdPluginList*)p)->cb_addPlugin(); }
+void gdPluginList::cb_refreshCpu(void* p) { ((gdPluginList*)p)->cb_refreshCpu(); }
 
 
 /* -------------------------------------------------------------------------- */
@@ -150,6 +155,20 @@ void gdPluginList::cb_addPlugin()
 /* -------------------------------------------------------------------------- */
 
 
+void gdPluginList::cb_refreshCpu()
+{
+	for (int i=0; i<list->children(); i++) {
+		gdPlugin* gdp = dynamic_cast<gdPlugin*>(list->child(i));
+		if (gdp != nullptr)
+			gdp->refreshCpu();
+	}
+	Fl::repeat_timeout(G_GUI_PLUGIN_CPU_RATE, cb_refreshCpu, (void*) this);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 void gdPluginList::refreshList()
 {
 	/* delete the previous list */
@@ -215,9 +234,10 @@ gdPlugin::gdPlugin(gdPluginList* gdp, Plugin* p, int X, int Y, int W)
 	: Fl_Group(X, Y, W, 20), pParent(gdp), pPlugin (p)
 {
 	begin();
-	button    = new geIdButton(8, y(), 220, 20);
-	program   = new geChoice(button->x()+button->w()+4, y(), 132, 20);
-	bypass    = new geIdButton(program->x()+program->w()+4, y(), 20, 20);
+	button    = new geIdButton(8, y(), 184, 20);
+	program   = new geChoice(button->x()+button->w()+4, y(), 100, 20);
+	cpu       = new geBox(program->x()+program->w()+4, y(), 60, 20);
+	bypass    = new geIdButton(cpu->x()+cpu->w()+4, y(), 20, 20);
 	shiftUp   = new geIdButton(bypass->x()+bypass->w()+4, y(), 20, 20, "", fxShiftUpOff_xpm, fxShiftUpOn_xpm);
 	shiftDown = new geIdButton(shiftUp->x()+shiftUp->w()+4, y(), 20, 20, "", fxShiftDownOff_xpm, fxShiftDownOn_xpm);
 	remove    = new geIdButton(shiftDown->x()+shiftDown->w()+4, y(), 20, 20, "", fxRemoveOff_xpm, fxRemoveOn_xpm);
@@ -245,6 +265,24 @@ gdPlugin::gdPlugin(gdPluginList* gdp, Plugin* p, int X, int Y, int W)
 	shiftUp->callback(cb_shiftUp, (void*)this);
 	shiftDown->callback(cb_shiftDown, (void*)this);
 	remove->callback(cb_removePlugin, (void*)this);
+
+	cpu->tooltip("CPU load: average / peak");
+	refreshCpu();
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void gdPlugin::refreshCpu()
+{
+	if (pPlugin->asleep.load()) {
+		cpu->label("idle");
+		return;
+	}
+	string l = gu_iToString((int) (pPlugin->getCpuLoad() * 100)) + " / " +
+		gu_iToString((int) (pPlugin->getCpuPeak() * 100)) + "%";
+	cpu->copy_label(l.c_str());
 }
 
 
@@ -290,7 +328,7 @@ void gdPlugin::cb_shiftDown()
 		return;
 
 	unsigned pluginIndex = pluginHost::getPluginIndex(pPlugin->getId(), pParent->ch);
-	unsigned stackSize   = pParent->ch->plugins.size();
+	unsigned stackSize   = pParent->ch->getPlugins().size();
 
 	if (pluginIndex == stackSize-1)  // last one in the stack, do nothing
 		return;
@@ -41,6 +41,7 @@ class geButton;
 class gdPluginList;
 class geIdButton;
 class geChoice;
+class geBox;
 
 
 class gdPluginList : public gdWindow
@@ -53,6 +54,12 @@ private:
 	static void cb_addPlugin(Fl_Widget *v, void *p);
 	void cb_addPlugin();
 
+	/* cb_refreshCpu
+	Timer callback, updates the CPU load of each plug-in. */
+
+	static void cb_refreshCpu(void *p);
+	void cb_refreshCpu();
+
 public:
 
 	Channel *ch;      // ch == nullptr ? masterOut
@@ -96,12 +103,18 @@ public:
 
 	geIdButton *button;
 	geChoice    *program;
+	geBox      *cpu;
 	geIdButton *bypass;
 	geIdButton *shiftUp;
 	geIdButton *shiftDown;
 	geIdButton *remove;
 
 	gdPlugin(gdPluginList *gdp, Plugin *p, int x, int y, int w);
+
+	/* refreshCpu
+	Shows average and peak CPU load of the plug-in. */
+
+	void refreshCpu();
 };
 
 #endif
@@ -31,6 +31,7 @@
 
 
 #include <FL/fl_draw.H>
+#include "../../../core/const.h"
 #include "../../../core/resourceChannel.h"
 #include "../../../core/recorder.h"
 #include "../../../core/mixer.h"
@@ -49,11 +50,12 @@ using namespace giada::m;
 
 
 geEnvelopeEditor::geEnvelopeEditor(int x, int y, gdActionEditor *pParent,
-	int type, int range, const char *l)
+	int type, int range, const std::string &l, uint32_t param)
 	:	geBaseActionEditor(x, y, 200, 80, pParent),
 		l                 (l),
 		type              (type),
 		range             (range),
+		param             (param),
 		selectedPoint     (-1),
 		draggedPoint      (-1)
 {
@@ -103,7 +105,7 @@ void geEnvelopeEditor::draw() {
 
 	fl_color(G_COLOR_GREY_4);
 	fl_font(FL_HELVETICA, 12);
-	fl_draw(l, x()+4, y(), 80, h(), (Fl_Align) (FL_ALIGN_LEFT));
+	fl_draw(l.c_str(), x()+4, y(), 80, h(), (Fl_Align) (FL_ALIGN_LEFT));
 
 	int pxOld = x()-3;
 	int pyOld = y()+1;
@@ -193,10 +195,10 @@ int geEnvelopeEditor::handle(int e) {
 						 * and the end of the range */
 
 						if (points.size() == 0) {
-							addPoint(0, 0, 1.0f, 0, 1);
-							recorder::rec(pParent->chan->index, type, 0, 0, 1.0f);
-							addPoint(clock::getFramesInLoop(), 0, 1.0f, pParent->coverX, 1);
-							recorder::rec(pParent->chan->index, type, clock::getFramesInLoop(), 0, 1.0f);
+							addPoint(0, param, 1.0f, 0, 1);
+							recorder::rec(pParent->chan->index, type, 0, param, 1.0f);
+							addPoint(clock::getFramesInLoop(), param, 1.0f, pParent->coverX, 1);
+							recorder::rec(pParent->chan->index, type, clock::getFramesInLoop(), param, 1.0f);
               pParent->chan->hasActions = true;
 						}
 
@@ -204,8 +206,8 @@ int geEnvelopeEditor::handle(int e) {
 
 						int frame   = mx * pParent->zoom;
 						float value = (my - h() + 8) / (float) (1 - h() + 8);
-						addPoint(frame, 0, value, mx, my);
-						recorder::rec(pParent->chan->index, type, frame, 0, value);
+						addPoint(frame, param, value, mx, my);
+						recorder::rec(pParent->chan->index, type, frame, param, value);
             pParent->chan->hasActions = true;
 						recorder::sortActions();
 						sortPoints();
@@ -223,13 +225,16 @@ int geEnvelopeEditor::handle(int e) {
 
 				if (selectedPoint != -1) {
 					if (selectedPoint == 0 || (unsigned) selectedPoint == points.size()-1) {
-						recorder::clearAction(pParent->chan->index, type);
+						if (type == G_ACTION_PARAM)
+							for (const point &p : points)
+								deleteAction(p);
+						else
+							recorder::clearAction(pParent->chan->index, type);
             pParent->chan->hasActions = recorder::hasActions(pParent->chan->index);
 						points.clear();
 					}
 					else {
-						recorder::deleteAction(pParent->chan->index,
-              points.at(selectedPoint).frame, type, false, &mixer::mutex_recs);
+						deleteAction(points.at(selectedPoint));
             pParent->chan->hasActions = recorder::hasActions(pParent->chan->index);
             recorder::sortActions();
 						points.erase(points.begin() + selectedPoint);
@@ -267,13 +272,13 @@ int geEnvelopeEditor::handle(int e) {
 
 					/*  delete previous point and record a new one */
 
-					recorder::deleteAction(pParent->chan->index,
-            points.at(draggedPoint).frame, type, false, &mixer::mutex_recs);
+					deleteAction(points.at(draggedPoint));
           pParent->chan->hasActions = recorder::hasActions(pParent->chan->index);
 
 					if (range == G_RANGE_FLOAT) {
 						float value = (points.at(draggedPoint).y - h() + 8) / (float) (1 - h() + 8);
-						recorder::rec(pParent->chan->index, type, newFrame, 0, value);
+						recorder::rec(pParent->chan->index, type, newFrame, param, value);
+						points.at(draggedPoint).fValue = value;
             pParent->chan->hasActions = true;
 					}
 					else {
@@ -367,6 +372,16 @@ int geEnvelopeEditor::verticalPoint(const point &p) {
 /* ------------------------------------------------------------------ */
 
 
+void geEnvelopeEditor::deleteAction(const point &p) {
+	bool exact = type == G_ACTION_PARAM;
+	recorder::deleteAction(pParent->chan->index, p.frame, type, exact,
+		&mixer::mutex_recs, p.iValue, p.fValue);
+}
+
+
+/* ------------------------------------------------------------------ */
+
+
 void geEnvelopeEditor::sortPoints() {
 	for (unsigned i=0; i<points.size(); i++)
 		for (unsigned j=0; j<points.size(); j++)
@@ -401,11 +416,11 @@ void geEnvelopeEditor::fill() {
 	for (unsigned i=0; i<recorder::global.size(); i++)
 		for (unsigned j=0; j<recorder::global.at(i).size(); j++) {
 			recorder::action *a = recorder::global.at(i).at(j);
-			if (a->type == type && a->chan == pParent->chan->index) {
+			if (a->type == type && a->chan == pParent->chan->index && a->iValue == param) {
 				if (range == G_RANGE_FLOAT)
 					addPoint(
 						a->frame,                      // frame
-						0,                             // int value (unused)
+						a->iValue,                     // int value (parameter key)
 						a->fValue,                     // float value
 						a->frame / pParent->zoom,       // x
 						((1-h()+8)*a->fValue)+h()-8);  // y = (b-a)x + a (line between two points)
@@ -32,14 +32,17 @@
 
 
 #include <vector>
+#include <string>
+#include <cstdint>
 #include "baseActionEditor.h"
 
 
 class geEnvelopeEditor : public geBaseActionEditor
 {
-	const char *l;      // internal label
+	std::string l;      // internal label
 	int         type;   // type of action
 	int         range;
+	uint32_t    param;  // parameter key (iValue), G_ACTION_PARAM only
 
 	/* point
 	 * a single dot in the graph. x = relative frame, y = relative value */
@@ -90,10 +93,16 @@ class geEnvelopeEditor : public geBaseActionEditor
 
 	int verticalPoint(const point &p);
 
+	/* deleteAction
+	 * remove from recorder the action behind point 'p'. Parameter lanes match
+	 * the exact action: other lanes of the same type share frames. */
+
+	void deleteAction(const point &p);
+
 public:
 
 	geEnvelopeEditor(int x, int y, gdActionEditor *pParent, int type, int range,
-    const char *l);
+    const std::string &l, uint32_t param=0);
 	~geEnvelopeEditor();
 
 	/* addPoint
@@ -24,6 +24,8 @@
  *
  * -------------------------------------------------------------------------- */
 
+#include <string>
+#include <cstdlib>
 #include <FL/Fl_Menu_Button.H>
 
 #include "../../../core/conf.h"
@@ -36,8 +38,11 @@
 #include "../basics/choice.h"
 #include "../basics/check.h"
 #include "../basics/idButton.h"
+#include "../basics/button.h"
+#include "../basics/input.h"
 #include "../../dialogs/midiDeviceNameInput.h"
 #include "../../dialogs/gd_mainWindow.h"
+#include "../../dialogs/gd_warnings.h"
 #include "../../../utils/gui.h"
 #include "midiDevice.h"
 
@@ -53,6 +58,8 @@ geMidiDevice::geMidiDevice(MidiDevice* device, int X, int Y, int W)
 	portIn    = new geChoice(button->x()+button->w()+4, y(), (W-8)*8/21, 20);
 	portOut   = new geChoice(portIn->x()+portIn->w()+4, y(), (W-8)*8/21, 20);
 	noNoteOff = new geCheck(x(), y()+portOut->h()+4, 20, 20, "No NoteOff");
+	outLatency = new geInput(x()+W/3-10, y()+portOut->h()+4, 30, 20, "Lat.");
+	measureLatency = new geButton(outLatency->x()+outLatency->w()+4, y()+portOut->h()+4, 36, 20, "Auto");
 	midiMap	  = new geChoice(x()+W*2/3, y()+portOut->h()+4, W/3, 20, "Midi Map");
 	end();
 
@@ -65,6 +72,15 @@ geMidiDevice::geMidiDevice(MidiDevice* device, int X, int Y, int W)
 
 	noNoteOff->value(device->getNoNoteOff());
 
+	outLatency->value(std::to_string(device->getOutLatency()).c_str());
+	outLatency->type(FL_INT_INPUT);
+	outLatency->when(FL_WHEN_RELEASE | FL_WHEN_ENTER_KEY);
+	outLatency->callback(cb_setOutLatency, (void*)this);
+	outLatency->tooltip("Output latency (ms): timed messages leave this much earlier");
+
+	measureLatency->callback(cb_measureLatency, (void*)this);
+	measureLatency->tooltip("Measure output latency. Connect output back to input first");
+
 	fetchOutPorts();
 	fetchInPorts();
 	fetchMidiMaps();
@@ -72,6 +88,13 @@ geMidiDevice::geMidiDevice(MidiDevice* device, int X, int Y, int W)
 
 /* -------------------------------------------------------------------------- */
 
+geMidiDevice::~geMidiDevice()
+{
+	Fl::remove_timeout(cb_pollLatency, (void*)this);
+}
+
+/* -------------------------------------------------------------------------- */
+
 void geMidiDevice::fetchInPorts()
 {
 	if (device->getInPortCount() == 0) {
@@ -142,6 +165,9 @@ void geMidiDevice::cb_setPortIn     (Fl_Widget* v, void* p) { ((geMidiDevice*)p)
 void geMidiDevice::cb_setPortOut		(Fl_Widget* v, void* p) { ((geMidiDevice*)p)->cb_setPortOut(); }
 void geMidiDevice::cb_setNoNoteOff	(Fl_Widget* v, void* p) { ((geMidiDevice*)p)->cb_setNoNoteOff(); }
 void geMidiDevice::cb_midiMap				(Fl_Widget* v, void* p) { ((geMidiDevice*)p)->cb_midiMap(); }
+void geMidiDevice::cb_setOutLatency	(Fl_Widget* v, void* p) { ((geMidiDevice*)p)->cb_setOutLatency(); }
+void geMidiDevice::cb_measureLatency(Fl_Widget* v, void* p) { ((geMidiDevice*)p)->cb_measureLatency(); }
+void geMidiDevice::cb_pollLatency   (void* p)                { ((geMidiDevice*)p)->cb_pollLatency(); }
 
 /* -------------------------------------------------------------------------- */
 
@@ -201,7 +227,7 @@ void geMidiDevice::cb_setPortIn()
 
 void geMidiDevice::cb_setPortOut()
 {
-
+	device->setPortOut(portOut->value()-1);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -219,3 +245,40 @@ void geMidiDevice::cb_midiMap()
 {
 
 }
+
+/* -------------------------------------------------------------------------- */
+
+
+void geMidiDevice::cb_setOutLatency()
+{
+	device->setOutLatency(atoi(outLatency->value()));
+	outLatency->value(std::to_string(device->getOutLatency()).c_str());
+}
+
+/* -------------------------------------------------------------------------- */
+
+
+void geMidiDevice::cb_measureLatency()
+{
+	if (!device->startLatencyProbe()) {
+		gdAlert("Open both the input and the output\nport of this device first.");
+		return;
+	}
+	measureLatency->deactivate();
+	Fl::add_timeout(G_GUI_PROBE_POLL_RATE, cb_pollLatency, (void*)this);
+}
+
+/* -------------------------------------------------------------------------- */
+
+
+void geMidiDevice::cb_pollLatency()
+{
+	if (!device->isLatencyProbeDone()) {
+		Fl::repeat_timeout(G_GUI_PROBE_POLL_RATE, cb_pollLatency, (void*)this);
+		return;
+	}
+	measureLatency->activate();
+	outLatency->value(std::to_string(device->getOutLatency()).c_str());
+	if (device->finishLatencyProbe() == -1)
+		gdAlert("No answer from the MIDI loopback.\nConnect this device's output\nto its input and try again.");
+}
@@ -32,8 +32,10 @@
 #include "../../../core/midiDevice.h"
 
 class geIdButton;
+class geButton;
 class geChoice;
 class geCheck;
+class geInput;
 
 using namespace giada::m;
 
@@ -46,12 +48,18 @@ private:
 	static void cb_setPortOut(Fl_Widget *v, void *p);
 	static void cb_setNoNoteOff(Fl_Widget *v, void *p);
 	static void cb_midiMap(Fl_Widget *v, void *p);
+	static void cb_setOutLatency(Fl_Widget *v, void *p);
+	static void cb_measureLatency(Fl_Widget *v, void *p);
+	static void cb_pollLatency(void *p);
 
 	void cb_button();
 	void cb_setPortIn();
 	void cb_setPortOut();
 	void cb_setNoNoteOff();
 	void cb_midiMap();
+	void cb_setOutLatency();
+	void cb_measureLatency();
+	void cb_pollLatency();
 
 	void fetchOutPorts();
 	void fetchInPorts();
@@ -66,8 +74,11 @@ public:
 	geChoice *portOut;
 	geCheck  *noNoteOff;
 	geChoice *midiMap;
+	geInput  *outLatency;
+	geButton *measureLatency;
 
 	geMidiDevice(MidiDevice *device, int X, int Y, int W);
+	~geMidiDevice();
 
 	void save();
 };
@@ -65,6 +65,7 @@ geTabAudio::geTabAudio(int X, int Y, int W, int H)
 	rsmpQuality = new geChoice(x()+114, y()+177, 250, 20, "Resampling");
 	metronomeWave = new geChoice(x()+114, y()+205, 100, 20, "Metronome");
 	metronomeVol = new geDial(x()+224, y()+205, 20, 20);
+	metronomeCue = new geCheck(x()+252, y()+209, 55, 20, "Cue output");
                 new geBox(x(), rsmpQuality->y()+rsmpQuality->h()+8, w(), 92,
 										"Restart Giada for the changes to take effect.");
 	end();
@@ -209,6 +210,8 @@ geTabAudio::geTabAudio(int X, int Y, int W, int H)
 
 	metronomeVol->value(giada::m::metronome::vol);
 	metronomeVol->callback(cb_metronomeVol, this);
+
+	metronomeCue->value(conf::metronomeCue);
 }
 
 
@@ -528,6 +531,7 @@ void geTabAudio::save()
 	conf::channelsIn     = channelsIn->value()+1;
 
 	conf::limitOutput    = limitOutput->value();
+	conf::metronomeCue   = metronomeCue->value();
 	conf::rsmpQuality    = rsmpQuality->value();
 
 	/* if sounddevOut is disabled (because of system change e.g. alsa ->
@@ -81,6 +81,7 @@ public:
 	geInput  *delayComp;
 	geChoice *metronomeWave;
 	geDial *metronomeVol;
+	geCheck *metronomeCue;
 
 	geTabAudio(int x, int y, int w, int h);
 
@@ -57,6 +57,9 @@ geTabBehaviors::geTabBehaviors(int X, int Y, int W, int H)
 
 	treatRecsAsLoops = new geCheck(x(), y()+155, 280, 20, "Treat one shot channels with actions as loops");
   inputMonitorDefaultOn = new geCheck(x(), y()+180, 280, 20, "New sample channels have input monitor on by default");
+  compactActions = new geCheck(x(), y()+205, 280, 20, "Store recorded actions in compact form");
+  lazyLoading = new geCheck(x(), y()+230, 280, 20, "Load project samples in background");
+  lazySkipStart = new geCheck(x()+25, y()+255, 280, 20, "Ignore channels started while loading");
 
   end();
 
@@ -67,6 +70,9 @@ geTabBehaviors::geTabBehaviors(int X, int Y, int W, int H)
 	conf::chansStopOnSeqHalt == 1 ? chansStopOnSeqHalt_1->value(1) : chansStopOnSeqHalt_0->value(1);
 	treatRecsAsLoops->value(conf::treatRecsAsLoops);
 	inputMonitorDefaultOn->value(conf::inputMonitorDefaultOn);
+	compactActions->value(conf::compactActions);
+	lazyLoading->value(conf::lazyLoading);
+	lazySkipStart->value(conf::lazySkipStart);
 
 	recsStopOnChanHalt_1->callback(cb_radio_mutex, (void*)this);
 	recsStopOnChanHalt_0->callback(cb_radio_mutex, (void*)this);
@@ -99,4 +105,7 @@ void geTabBehaviors::save()
 	conf::chansStopOnSeqHalt = chansStopOnSeqHalt_1->value() == 1 ? 1 : 0;
 	conf::treatRecsAsLoops = treatRecsAsLoops->value() == 1 ? 1 : 0;
 	conf::inputMonitorDefaultOn = inputMonitorDefaultOn->value() == 1 ? 1 : 0;
+	conf::compactActions = compactActions->value() == 1 ? 1 : 0;
+	conf::lazyLoading = lazyLoading->value() == 1 ? 1 : 0;
+	conf::lazySkipStart = lazySkipStart->value() == 1 ? 1 : 0;
 }
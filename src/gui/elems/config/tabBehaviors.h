@@ -51,6 +51,9 @@ public:
 	geRadio *chansStopOnSeqHalt_0;
 	geCheck *treatRecsAsLoops;
 	geCheck *inputMonitorDefaultOn;
+	geCheck *compactActions;
+	geCheck *lazyLoading;
+	geCheck *lazySkipStart;
 
 	geTabBehaviors(int x, int y, int w, int h);
 
@@ -28,7 +28,6 @@
 #ifdef WITH_VST
 
 
-#include <functional>
 #include <FL/Fl.H>
 #include "../../../core/const.h"
 #include "../../../core/conf.h"
@@ -63,6 +62,7 @@ geTabPlugins::geTabPlugins(int X, int Y, int W, int H)
 	m_folderPath = new geInput(m_browse->x()-258, y()+9, 250, G_GUI_UNIT);
 	m_scanButton = new geButton(x()+w()-120, m_folderPath->y()+m_folderPath->h()+8, 120, G_GUI_UNIT);
 	m_info       = new geBox(x(), m_scanButton->y()+m_scanButton->h()+8, w(), 242);
+	m_isolated   = new geCheck(x(), m_scanButton->y(), 200, G_GUI_UNIT, "Scan plug-ins in a separate process");
 
 	end();
 
@@ -79,7 +79,26 @@ geTabPlugins::geTabPlugins(int X, int Y, int W, int H)
 
 	m_scanButton->callback(cb_scan, (void*) this);
 
+	m_isolated->value(conf::pluginScanIsolated);
+
 	refreshCount();
+
+	/* A scan started before this tab was last closed might still be running. */
+
+	if (pluginHost::isScanning()) {
+		m_info->show();
+		m_scanButton->deactivate();
+		Fl::add_timeout(G_GUI_SCAN_POLL_RATE, cb_pollScan, (void*) this);
+	}
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+geTabPlugins::~geTabPlugins()
+{
+	Fl::remove_timeout(cb_pollScan, (void*) this);
 }
 
 
@@ -89,7 +108,7 @@ geTabPlugins::geTabPlugins(int X, int Y, int W, int H)
 void geTabPlugins::refreshCount()
 {
 	string scanLabel = "Scan (" + gu_iToString(pluginHost::countAvailablePlugins()) + " found)";
-	m_scanButton->label(scanLabel.c_str());
+	m_scanButton->copy_label(scanLabel.c_str());
 }
 
 
@@ -98,6 +117,7 @@ void geTabPlugins::refreshCount()
 
 void geTabPlugins::cb_scan(Fl_Widget* w, void* p) { ((geTabPlugins*)p)->cb_scan(); }
 void geTabPlugins::cb_browse(Fl_Widget* w, void* p) { ((geTabPlugins*)p)->cb_browse(); }
+void geTabPlugins::cb_pollScan(void* p) { ((geTabPlugins*)p)->cb_pollScan(); }
 
 
 /* -------------------------------------------------------------------------- */
@@ -117,17 +137,33 @@ void geTabPlugins::cb_browse()
 
 void geTabPlugins::cb_scan()
 {
-	std::function<void(float)> callback = [this] (float progress) 
-	{
-		string l = "Scan in progress (" + gu_iToString((int)(progress*100)) + "%). Please wait...";
-		m_info->label(l.c_str());
-		Fl::wait();
-	};
+	conf::pluginScanIsolated = m_isolated->value();
+	if (!pluginHost::startScan(m_folderPath->value(), conf::pluginScanIsolated))
+		return;
 
+	m_info->label("Scan in progress. Please wait...");
 	m_info->show();
-	pluginHost::scanDirs(m_folderPath->value(), callback);
+	m_scanButton->deactivate();
+	Fl::add_timeout(G_GUI_SCAN_POLL_RATE, cb_pollScan, (void*) this);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+void geTabPlugins::cb_pollScan()
+{
+	if (!pluginHost::isScanDone()) {
+		string l = "Scan in progress (" + gu_iToString((int)(pluginHost::getScanProgress()*100)) + "%). Please wait...";
+		m_info->copy_label(l.c_str());
+		Fl::repeat_timeout(G_GUI_SCAN_POLL_RATE, cb_pollScan, (void*) this);
+		return;
+	}
+
+	pluginHost::finishScan();
 	pluginHost::saveList(gu_getHomePath() + G_SLASH + "plugins.xml");
 	m_info->hide();
+	m_scanButton->activate();
 	refreshCount();
 }
 
@@ -138,6 +174,7 @@ void geTabPlugins::cb_scan()
 void geTabPlugins::save()
 {
 	conf::pluginPath = m_folderPath->value();
+	conf::pluginScanIsolated = m_isolated->value();
 }
 
 
@@ -38,6 +38,7 @@
 class geInput;
 class geButton;
 class geBox;
+class geCheck;
 
 
 class geTabPlugins : public Fl_Group
@@ -48,17 +49,26 @@ private:
 	geButton* m_browse;
 	geButton* m_scanButton;
 	geBox* m_info;
+	geCheck* m_isolated;
 
 	static void cb_scan(Fl_Widget* w, void* p);
 	static void cb_browse(Fl_Widget* w, void* p);
 	void cb_scan();
 	void cb_browse();
 
+	/* cb_pollScan
+	Timer callback: updates the progress while the background scan runs and
+	collects its result when done. */
+
+	static void cb_pollScan(void* p);
+	void cb_pollScan();
+
 	void refreshCount();
 
 public:
 
 	geTabPlugins(int x, int y, int w, int h);
+	~geTabPlugins();
 
 	void save();
 	void refreshVstPath();
@@ -312,7 +312,7 @@ void geMidiChannel::update()
 	recModeBox->redraw();
 
 #ifdef WITH_VST
-	fx->status = mch->plugins.size() > 0;
+	fx->status = mch->getPlugins().size() > 0;
 	fx->redraw();
 #endif
 }
@@ -29,6 +29,7 @@
 #include "../../../../core/const.h"
 #include "../../../../core/channel.h"
 #include "../../../../core/resourceChannel.h"
+#include "../../../../core/commands.h"
 #include "../../../../core/graphics.h"
 #include "../../../../core/pluginHost.h"
 #include "../../../../utils/gui.h"
@@ -76,12 +77,12 @@ void geResourceChannel::cb_openFxWindow(Fl_Widget* v, void* p) { ((geResourceCha
 
 void geResourceChannel::cb_button()
 {
-	using namespace giada::c;
+	using namespace giada::m;
 
 	if (button->value())    // pushed, max velocity (127 i.e. 0x7f)
-		io::keyPress((ResourceChannel*)ch, Fl::event_ctrl(), Fl::event_shift(), 0x7F);
+		commands::push(commands::KEY_PRESS, ch->index, Fl::event_ctrl(), Fl::event_shift(), 0x7F);
 	else                    // released
-		io::keyRelease((ResourceChannel*)ch, Fl::event_ctrl(), Fl::event_shift());
+		commands::push(commands::KEY_RELEASE, ch->index, Fl::event_ctrl(), Fl::event_shift());
 }
 
 /* -------------------------------------------------------------------------- */
@@ -437,7 +437,7 @@ void geSampleChannel::update()
 	arm->value(sch->armed);
 
 #ifdef WITH_VST
-	fx->status = sch->plugins.size() > 0;
+	fx->status = sch->getPlugins().size() > 0;
 	fx->redraw();
 #endif
 }
@@ -37,6 +37,7 @@
 #include "../../../utils/gui.h"
 #include "../../../glue/storage.h"
 #include "../../../glue/main.h"
+#include "../../../glue/plugin.h"
 #include "../../elems/basics/boxtypes.h"
 #include "../../elems/basics/button.h"
 #include "../../dialogs/gd_mainWindow.h"
@@ -174,6 +175,9 @@ void geMainMenu::__cb_edit()
 		{"Remove empty columns"},
 		{"Reset to init state"},
 		{"Setup global MIDI input..."},
+#ifdef WITH_VST
+		{"Dump plug-in metrics"},
+#endif
 		{0}
 	};
 
@@ -247,4 +251,10 @@ void geMainMenu::__cb_edit()
 		gu_openSubWindow(G_MainWin, new gdMidiInputMaster(), 0);
 		return;
 	}
+#ifdef WITH_VST
+	if (strcmp(m->label(), "Dump plug-in metrics") == 0) {
+		giada::c::plugin::dumpMetrics();
+		return;
+	}
+#endif
 }
@@ -26,6 +26,7 @@
 
 
 #include <pthread.h>
+#include <string>
 #if defined(__linux__) || defined(__APPLE__)
 	#include <unistd.h>
 #endif
@@ -58,6 +59,16 @@ void* videoThreadCb(void* arg);
 
 int main(int argc, char** argv)
 {
+#ifdef WITH_VST
+
+	/* Plug-in probe requested by an isolated scan: do just that, no GUI nor
+	audio. See pluginHost::startScan(). */
+
+	if (argc == 4 && std::string(argv[1]) == G_PLUGIN_PROBE_ARG)
+		return giada::m::pluginHost::probePlugin(argv[2], argv[3]);
+
+#endif
+
 	G_quit = false;
 
 	init_prepareParser();
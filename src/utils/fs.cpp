@@ -35,6 +35,8 @@
 #endif
 
 #include <cstdarg>
+#include <cstdio>
+#include <fstream>
 #include <sys/stat.h>   // stat (gu_dirExists)
 #include <errno.h>
 #include <cstdlib>
@@ -146,6 +148,87 @@ bool gu_mkdir(const string &path)
 /* -------------------------------------------------------------------------- */
 
 
+string gu_fileId(const string& path)
+{
+	struct stat buf;
+	if (stat(path.c_str(), &buf) != 0)
+		return "";
+	return gu_format("%llu:%llu:%lld:%lld",
+		(unsigned long long) buf.st_dev, (unsigned long long) buf.st_ino,
+		(long long) buf.st_size, (long long) buf.st_mtime);
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool gu_isSameFile(const string& a, const string& b)
+{
+	struct stat bufA, bufB;
+	if (stat(a.c_str(), &bufA) != 0 || stat(b.c_str(), &bufB) != 0)
+		return false;
+	return bufA.st_dev == bufB.st_dev && bufA.st_ino == bufB.st_ino &&
+	       bufA.st_ino != 0;  // no inodes on some filesystems
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool gu_linkFile(const string& src, const string& dst)
+{
+	if (gu_isSameFile(src, dst))
+		return true;
+
+	/* Link or copy under a temporary name first: 'dst' might still be 'src' under
+	another name, as on filesystems without inodes. Removing it would destroy
+	the source. */
+
+	string tmp = dst + ".tmp";
+	remove(tmp.c_str());
+
+	bool linked = false;
+#if defined(_WIN32)
+	linked = CreateHardLinkA(tmp.c_str(), src.c_str(), nullptr) != 0;
+#else
+	linked = link(src.c_str(), tmp.c_str()) == 0;
+#endif
+
+	if (!linked) {
+		gu_log("[gu_linkFile] unable to link %s, copying instead\n", src.c_str());
+		std::ifstream in(src, std::ios::binary);
+		std::ofstream out(tmp, std::ios::binary);
+		if (!in || !out || !(out << in.rdbuf())) {
+			remove(tmp.c_str());
+			return false;
+		}
+	}
+
+	/* Renaming a file over another link to the same file does nothing: the
+	temporary one would be left behind. */
+
+	bool ok = gu_replaceFile(tmp, dst);
+	remove(tmp.c_str());
+	return ok;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool gu_replaceFile(const string& src, const string& dst)
+{
+#if defined(_WIN32)
+	return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(src.c_str(), dst.c_str()) == 0;
+#endif
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
 string gu_basename(const string& s)
 {
 	string out = s;
@@ -45,6 +45,33 @@ bool gu_isRootDir(const std::string& s);
 
 bool gu_isProject(const std::string& path);
 bool gu_mkdir(const std::string& path);
+
+/* gu_fileId
+Returns a string that identifies the file content on disk (device, inode, size
+and modification time), or an empty string if the file doesn't exist. Two equal
+ids mean the file hasn't been touched in between. */
+
+std::string gu_fileId(const std::string& path);
+
+/* gu_isSameFile
+Tells whether 'a' and 'b' are the same file on disk (same device and inode),
+whatever the spelling of their paths. False if either doesn't exist. */
+
+bool gu_isSameFile(const std::string& a, const std::string& b);
+
+/* gu_linkFile
+Makes 'dst' a hard link to 'src', replacing 'dst' if it already exists. Falls
+back to a plain copy when linking is not possible, e.g. across filesystems.
+'dst' is replaced only once the link or the copy is ready: it may be 'src'
+itself. */
+
+bool gu_linkFile(const std::string& src, const std::string& dst);
+
+/* gu_replaceFile
+Moves 'src' over 'dst', replacing it if it already exists. Other hard links to
+the old 'dst' keep the old content. */
+
+bool gu_replaceFile(const std::string& src, const std::string& dst);
 std::string gu_getCurrentPath();
 std::string gu_getHomePath();
 
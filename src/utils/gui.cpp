@@ -37,6 +37,7 @@
 #include "../core/recorder.h"
 #include "../core/wave.h"
 #include "../core/clock.h"
+#include "../core/commands.h"
 #include "../core/pluginHost.h"
 #include "../core/channel.h"
 #include "../core/columnChannel.h"
@@ -75,6 +76,10 @@ void gu_refreshUI()
 {
 	Fl::lock();
 
+	/* Apply what the engine has to say first (transport, bpm, ...). */
+
+	commands::processNotifications();
+
 	/* update dynamic elements: in and out meters, beat meter and
 	 * each channel */
 
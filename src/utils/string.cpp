@@ -30,6 +30,8 @@
 #include <iomanip>
 #include <cstdarg>
 #include <climits>
+#include <cstring>
+#include <memory>
 #include "../core/const.h"
 #include "string.h"
 
@@ -144,3 +146,65 @@ void gu_split(string in, string sep, vector<string>* v)
 	}
 	while (next != string::npos);
 }
+
+
+/* -------------------------------------------------------------------------- */
+
+
+namespace
+{
+const char* base64Chars =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+} // {anonymous}
+
+
+string gu_toBase64(const vector<uint8_t>& in)
+{
+	string out;
+	out.reserve(((in.size() + 2) / 3) * 4);
+
+	for (size_t i=0; i<in.size(); i+=3) {
+		uint32_t n = in[i] << 16;
+		if (i + 1 < in.size()) n |= in[i+1] << 8;
+		if (i + 2 < in.size()) n |= in[i+2];
+		out.push_back(base64Chars[(n >> 18) & 0x3F]);
+		out.push_back(base64Chars[(n >> 12) & 0x3F]);
+		out.push_back(i + 1 < in.size() ? base64Chars[(n >> 6) & 0x3F] : '=');
+		out.push_back(i + 2 < in.size() ? base64Chars[n & 0x3F] : '=');
+	}
+	return out;
+}
+
+
+/* -------------------------------------------------------------------------- */
+
+
+bool gu_fromBase64(const string& in, vector<uint8_t>& out)
+{
+	if (in.size() % 4 != 0)
+		return false;
+
+	out.clear();
+	out.reserve((in.size() / 4) * 3);
+
+	for (size_t i=0; i<in.size(); i+=4) {
+		uint32_t n   = 0;
+		int      pad = 0;
+		for (size_t k=0; k<4; k++) {
+			char c = in[i+k];
+			const char* p = c != '\0' ? strchr(base64Chars, c) : nullptr;
+			if (c == '=' && i + 4 == in.size() && k >= 2) {
+				pad++;
+				n <<= 6;
+				continue;
+			}
+			if (p == nullptr || pad > 0)
+				return false;
+			n = (n << 6) | (p - base64Chars);
+		}
+		out.push_back((n >> 16) & 0xFF);
+		if (pad < 2) out.push_back((n >> 8) & 0xFF);
+		if (pad < 1) out.push_back(n & 0xFF);
+	}
+	return true;
+}
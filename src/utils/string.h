@@ -31,6 +31,7 @@
 #define G_UTILS_STRING_H
 
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -61,5 +62,12 @@ std::string gu_fToString(float f, int precision);
 
 std::string gu_format(const char* format, ...);
 
+/* gu_toBase64, gu_fromBase64
+Encodes binary data to a base64 string and back. gu_fromBase64 returns false
+on malformed input. */
+
+std::string gu_toBase64(const std::vector<uint8_t>& in);
+bool gu_fromBase64(const std::string& in, std::vector<uint8_t>& out);
+
 
 #endif
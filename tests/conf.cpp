@@ -46,6 +46,7 @@ TEST_CASE("Test Conf class")
     conf::chansStopOnSeqHalt = false;
     conf::treatRecsAsLoops = true;
     conf::resizeRecordings = false;
+    conf::compactActions = false;
     conf::pluginPath = "path/to/plugins";
     conf::patchPath = "path/to/patches";
     conf::samplePath = "path/to/samples";
@@ -122,6 +123,7 @@ TEST_CASE("Test Conf class")
     REQUIRE(conf::chansStopOnSeqHalt == false);
     REQUIRE(conf::treatRecsAsLoops == true);
     REQUIRE(conf::resizeRecordings == false);
+    REQUIRE(conf::compactActions == false);
     REQUIRE(conf::pluginPath == "path/to/plugins");
     REQUIRE(conf::patchPath == "path/to/patches");
     REQUIRE(conf::samplePath == "path/to/samples");
@@ -0,0 +1,65 @@
+#include "../src/core/audioBuffer.h"
+#include "../src/core/delayLine.h"
+#include <catch.hpp>
+
+
+TEST_CASE("Test DelayLine class")
+{
+	using namespace giada::m;
+
+	static const int BUFFER_SIZE = 16;
+	static const int MAX_DELAY   = 40;
+
+	DelayLine line;
+	REQUIRE(line.alloc(MAX_DELAY, 2) == true);
+
+	AudioBuffer buffer;
+	buffer.alloc(BUFFER_SIZE, 2);
+
+	/* Feeds 'blocks' buffers of a ramp (frame number on the left channel, its
+	negative on the right one) and checks the output is the same ramp, late by
+	'delay' frames. */
+
+	auto check = [&](int delay, int blocks) {
+		bool ok = true;
+		for (int b=0; b<blocks; b++) {
+			for (int i=0; i<BUFFER_SIZE; i++) {
+				buffer[i][0] = b * BUFFER_SIZE + i + 1;
+				buffer[i][1] = -(b * BUFFER_SIZE + i + 1);
+			}
+			line.process(buffer);
+			for (int i=0; i<BUFFER_SIZE; i++) {
+				float expected = b * BUFFER_SIZE + i + 1 - delay;
+				if (expected < 1) expected = 0;  // silence before the first frame
+				ok &= buffer[i][0] == expected && buffer[i][1] == -expected;
+			}
+		}
+		return ok;
+	};
+
+	SECTION("test no delay")
+	{
+		REQUIRE(line.getDelay() == 0);
+		REQUIRE(check(0, 4));
+	}
+
+	SECTION("test delay shorter than a buffer")
+	{
+		line.setDelay(5);
+		REQUIRE(check(5, 4));
+	}
+
+	SECTION("test delay longer than a buffer, wrapping around")
+	{
+		line.setDelay(37);
+		REQUIRE(check(37, 10));
+	}
+
+	SECTION("test clamping")
+	{
+		line.setDelay(MAX_DELAY * 2);
+		REQUIRE(line.getDelay() == MAX_DELAY);
+		line.setDelay(-1);
+		REQUIRE(line.getDelay() == 0);
+	}
+}
@@ -1,5 +1,7 @@
 #include "../src/core/patch.h"
 #include "../src/core/const.h"
+#include "../src/core/conf.h"
+#include <cmath>
 #include <catch.hpp>
 
 
@@ -26,10 +28,12 @@ TEST_CASE("Test Patch class")
 
 		action1.type   = 0;
 		action1.frame  = 50000;
+		action1.tick   = 1088.4353741496598;
 		action1.fValue = 0.3f;
 		action1.iValue = 1000;
 		action2.type   = 2;
 		action2.frame  = 589;
+		action2.tick   = 12.82;
 		action2.fValue = 1.0f;
 		action2.iValue = 130;
 		channel1.actions.push_back(action1);
@@ -52,6 +56,7 @@ TEST_CASE("Test Patch class")
 		plugin2.params.push_back(1.0f);
 		plugin2.params.push_back(1.0f);
 		plugin2.params.push_back(0.333f);
+		plugin2.state = "c3RhdGUgY2h1bms=";
 		channel1.plugins.push_back(plugin2);
 #endif
 
@@ -181,12 +186,14 @@ TEST_CASE("Test Patch class")
 		patch::action_t action0 = channel0.actions.at(0);
 		REQUIRE(action0.type == 0);
 		REQUIRE(action0.frame == 50000);
+		REQUIRE(action0.tick == 1088.4353741496598);
 		REQUIRE(action0.fValue == Approx(0.3f));
 		REQUIRE(action0.iValue == 1000);
 
 		patch::action_t action1 = channel0.actions.at(1);
 		REQUIRE(action1.type == 2);
 		REQUIRE(action1.frame == 589);
+		REQUIRE(action1.tick == Approx(12.82));
 		REQUIRE(action1.fValue == Approx(1.0f));
 		REQUIRE(action1.iValue == 130);
 
@@ -208,6 +215,7 @@ TEST_CASE("Test Patch class")
 		REQUIRE(plugin1.params.at(4) == Approx(1.0f));
 		REQUIRE(plugin1.params.at(5) == Approx(1.0f));
 		REQUIRE(plugin1.params.at(6) == Approx(0.333f));
+		REQUIRE(plugin1.state == "c3RhdGUgY2h1bms=");
 
 		patch::plugin_t masterPlugin0 = patch::masterInPlugins.at(0);
 		REQUIRE(masterPlugin0.path   == "/path/to/plugin1");
@@ -228,4 +236,89 @@ TEST_CASE("Test Patch class")
 		REQUIRE(masterPlugin1.params.at(6) == Approx(0.333f));
 #endif
 	}
+
+	SECTION("test actions round trip")
+	{
+		for (bool compact : { true, false }) {
+			patch::init();
+			patch::versionMajor = G_VERSION_MAJOR;
+			patch::versionMinor = G_VERSION_MINOR;
+			patch::versionPatch = G_VERSION_PATCH;
+			patch::bpm          = 127.0f;
+			patch::beats        = 7;
+			patch::samplerate   = 48000;
+
+			double fpt = ((int) (48000 * (60.0f / 127.0f)) * 7) / (double) (7 * G_PPQ);
+
+			patch::channel_t channel;
+			for (int i=0; i<1000; i++) {
+				patch::action_t a;
+				a.type   = i % 2 ? G_ACTION_MIDI : G_ACTION_VOLUME;
+				a.frame  = (i * 7919) % 100000;     // not sorted
+				a.tick   = i % 3 ? a.frame / fpt : i * 0.1;
+				a.fValue = i % 2 ? 0.0f : i / 1000.0f;
+				a.iValue = i % 2 ? 0x90000000 | i : 0;
+				channel.actions.push_back(a);
+			}
+			vector<patch::action_t> src = channel.actions;
+			patch::channels.push_back(channel);
+
+			conf::compactActions = compact;
+			REQUIRE(patch::write("./test-patch-actions.json") == 1);
+			patch::init();
+			REQUIRE(patch::read("./test-patch-actions.json") == PATCH_READ_OK);
+
+			const vector<patch::action_t>& dst = patch::channels.at(0).actions;
+			REQUIRE(dst.size() == src.size());
+			for (unsigned i=0; i<src.size(); i++) {
+				REQUIRE(dst.at(i).type   == src.at(i).type);
+				REQUIRE(dst.at(i).frame  == src.at(i).frame);
+				REQUIRE(dst.at(i).tick   == src.at(i).tick);
+				REQUIRE(dst.at(i).fValue == src.at(i).fValue);
+				REQUIRE(dst.at(i).iValue == src.at(i).iValue);
+			}
+		}
+	}
+
+	SECTION("test actions with a broken clock")
+	{
+		/* Zero or out of range bpm and beats fall back to the defaults, the same
+		ones sanitize() picks on read. */
+
+		double fpt = ((int) (G_DEFAULT_SAMPLERATE * (60.0f / G_DEFAULT_BPM)) * G_DEFAULT_BEATS)
+			/ (double) (G_DEFAULT_BEATS * G_PPQ);
+
+		for (bool compact : { true, false }) {
+			for (float bpm : { 0.0f, 1000.0f }) {
+				patch::init();
+				patch::versionMajor = G_VERSION_MAJOR;
+				patch::versionMinor = G_VERSION_MINOR;
+				patch::versionPatch = G_VERSION_PATCH;
+				patch::bpm          = bpm;
+				patch::beats        = bpm == 0.0f ? 0 : G_MAX_BEATS + 1;
+				patch::samplerate   = 0;
+
+				patch::channel_t channel;
+				patch::action_t a;
+				a.type   = G_ACTION_KEYPRESS;
+				a.frame  = 22050;
+				a.tick   = a.frame / fpt;
+				a.fValue = 0.0f;
+				a.iValue = 0;
+				channel.actions.push_back(a);
+				patch::channels.push_back(channel);
+
+				conf::compactActions = compact;
+				REQUIRE(patch::write("./test-patch-actions.json") == 1);
+				patch::init();
+				REQUIRE(patch::read("./test-patch-actions.json") == PATCH_READ_OK);
+
+				const patch::action_t& b = patch::channels.at(0).actions.at(0);
+				REQUIRE(std::isfinite(b.tick));
+				REQUIRE(b.tick == a.tick);
+				REQUIRE(patch::bpm == G_DEFAULT_BPM);
+				REQUIRE(patch::beats == G_DEFAULT_BEATS);
+			}
+		}
+	}
 }
@@ -0,0 +1,53 @@
+#include <cmath>
+#include <random>
+#include "../src/core/const.h"
+#include "../src/core/pll.h"
+#include <catch.hpp>
+
+
+TEST_CASE("Test Pll class")
+{
+	using namespace giada::m;
+
+	/* MIDI clock at 120 BPM: 24 ticks per beat. */
+
+	const double period = 60.0 / (120.0 * 24.0);
+
+	Pll pll(G_PLL_BANDWIDTH_CLOCK);
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> jitter(-0.001, 0.001);
+
+	SECTION("test lock on jittered input")
+	{
+		REQUIRE(pll.isLocked() == false);
+		for (int i=0; i<24 * 16; i++)
+			pll.update(10.0 + i * period + jitter(rng));
+		REQUIRE(pll.isLocked() == true);
+		REQUIRE(std::fabs(pll.getPeriod() - period) / period < 0.001);
+		REQUIRE(std::fabs(pll.getTime() - (10.0 + (24 * 16 - 1) * period)) < 0.001);
+		REQUIRE(std::fabs(pll.getPhase(pll.getTime() + period / 2) - 0.5) < 0.001);
+	}
+
+	SECTION("test tempo change")
+	{
+		for (int i=0; i<24 * 8; i++)
+			pll.update(i * period);
+
+		const double newPeriod = 60.0 / (125.0 * 24.0);
+		double t = (24 * 8 - 1) * period;
+		for (int i=0; i<24 * 16; i++) {
+			t += newPeriod;
+			pll.update(t + jitter(rng));
+		}
+		REQUIRE(std::fabs(pll.getPeriod() - newPeriod) / newPeriod < 0.001);
+	}
+
+	SECTION("test dropout")
+	{
+		for (int i=0; i<24 * 8; i++)
+			pll.update(i * period);
+		REQUIRE(pll.update(1000.0) == false);
+		REQUIRE(pll.isLocked() == false);
+		REQUIRE(pll.getPeriod() == Approx(period));
+	}
+}
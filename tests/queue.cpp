@@ -0,0 +1,68 @@
+#include <thread>
+#include <vector>
+#include "../src/core/queue.h"
+#include <catch.hpp>
+
+
+TEST_CASE("Test Queue class")
+{
+	using namespace giada::m;
+
+	/* Each SECTION the TEST_CASE is executed from the start. Any code between 
+	this comment and the first SECTION macro is exectuted before each SECTION. */
+
+	Queue<int, 8> queue;
+
+	SECTION("test empty")
+	{
+		int v;
+		REQUIRE(queue.pop(v) == false);
+	}
+
+	SECTION("test push/pop, FIFO order")
+	{
+		for (int i=0; i<8; i++)
+			REQUIRE(queue.push(i) == true);
+		REQUIRE(queue.push(8) == false);  // full
+
+		int v;
+		for (int i=0; i<8; i++) {
+			REQUIRE(queue.pop(v) == true);
+			REQUIRE(v == i);
+		}
+		REQUIRE(queue.pop(v) == false);
+	}
+
+	SECTION("test multiple producers")
+	{
+		static const int PRODUCERS = 4;
+		static const int ITEMS     = 10000;
+
+		Queue<int, 256> q;
+		std::vector<std::thread> producers;
+		for (int p=0; p<PRODUCERS; p++)
+			producers.push_back(std::thread([&q, p] {
+				for (int i=0; i<ITEMS; i++)
+					while (!q.push(p * ITEMS + i))
+						std::this_thread::yield();
+			}));
+
+		std::vector<int> last(PRODUCERS, -1);
+		int received = 0;
+		bool ordered = true;
+		while (received < PRODUCERS * ITEMS) {
+			int v;
+			if (!q.pop(v))
+				continue;
+			int p = v / ITEMS;
+			ordered &= v % ITEMS > last[p];  // per-producer order is kept
+			last[p] = v % ITEMS;
+			received++;
+		}
+		for (std::thread& t : producers)
+			t.join();
+
+		REQUIRE(ordered == true);
+		REQUIRE(received == PRODUCERS * ITEMS);
+	}
+}
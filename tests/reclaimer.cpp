@@ -0,0 +1,78 @@
+#include <atomic>
+#include <thread>
+#include "../src/core/reclaimer.h"
+#include <catch.hpp>
+
+
+TEST_CASE("Test reclaimer")
+{
+	using namespace giada::m;
+
+	reclaimer::collect();
+
+	SECTION("test retire without readers")
+	{
+		int* p = new int(1);
+		bool deleted = false;
+		reclaimer::retire([&] { delete p; deleted = true; });
+
+		REQUIRE(deleted);
+		REQUIRE(reclaimer::countPending() == 0);
+	}
+
+	SECTION("test retire waits for readers")
+	{
+		std::atomic<bool> reading(false);
+		std::atomic<bool> done(false);
+
+		std::thread t([&] {
+			reclaimer::Reader r;
+			reading = true;
+			while (!done.load())
+				std::this_thread::yield();
+		});
+		while (!reading.load())
+			std::this_thread::yield();
+
+		bool deleted = false;
+		reclaimer::retire([&] { deleted = true; });
+
+		REQUIRE(!deleted);
+		REQUIRE(reclaimer::countPending() == 1);
+
+		done = true;
+		t.join();
+		reclaimer::collect();
+
+		REQUIRE(deleted);
+		REQUIRE(reclaimer::countPending() == 0);
+	}
+
+	SECTION("test nested sections")
+	{
+		std::atomic<int> step(0);
+		bool deleted = false;
+
+		std::thread t([&] {
+			reclaimer::Reader outer;
+			{
+				reclaimer::Reader inner;
+			}
+			step = 1;  // still inside 'outer'
+			while (step.load() != 2)
+				std::this_thread::yield();
+		});
+		while (step.load() != 1)
+			std::this_thread::yield();
+
+		reclaimer::retire([&] { deleted = true; });
+
+		REQUIRE(!deleted);
+
+		step = 2;
+		t.join();
+		reclaimer::synchronize();
+
+		REQUIRE(deleted);
+	}
+}
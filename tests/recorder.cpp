@@ -4,6 +4,7 @@
 
 
 using std::string;
+using std::vector;
 using namespace giada::m;
 
 
@@ -259,72 +260,144 @@ TEST_CASE("Test Recorder")
 
 	SECTION("Test BPM update")
 	{
-		recorder::rec(0, G_ACTION_KEYPRESS,  0, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KEYREL,   80, 1, 0.5f);
+		recorder::updateClock(88200, 4);  // 120 bpm, 44100 Hz
+
+		recorder::rec(0, G_ACTION_KEYPRESS,     0, 1, 0.5f);
+		recorder::rec(0, G_ACTION_KEYREL,   22050, 1, 0.5f);
+		recorder::rec(0, G_ACTION_KILL,     30001, 1, 0.5f);
 
-		recorder::updateBpm(60.0f, 120.0f, 44100);  // scaling up
+		recorder::updateClock(176400, 4);  // scaling down to 60 bpm
 
 		REQUIRE(recorder::frames.at(0) == 0);
-		REQUIRE(recorder::frames.at(1) == 40);
+		REQUIRE(recorder::frames.at(1) == 44100);
+		REQUIRE(recorder::frames.at(2) == 60002);
+		REQUIRE(recorder::global.at(1).at(0)->frame == 44100);
 
-		recorder::updateBpm(120.0f, 60.0f, 44100);  // scaling down
+		recorder::updateClock(88200, 4);  // back to 120 bpm
 
 		REQUIRE(recorder::frames.at(0) == 0);
-		REQUIRE(recorder::frames.at(1) == 80);
+		REQUIRE(recorder::frames.at(1) == 22050);
+		REQUIRE(recorder::frames.at(2) == 30001);
+
+		SECTION("Test BPM update, no rounding accumulation")
+		{
+			for (int i=0; i<100; i++) {
+				recorder::updateClock(88200 + 37 * i, 4);
+				recorder::updateClock(88200, 4);
+			}
+			REQUIRE(recorder::frames.at(1) == 22050);
+			REQUIRE(recorder::frames.at(2) == 30001);
+		}
+	}
+
+	SECTION("Test actions read before the frame cache follows the clock")
+	{
+		recorder::updateClock(88200, 4);  // 120 bpm, 44100 Hz
+		recorder::rec(0, G_ACTION_KEYPRESS, 22050, 1, 0.5f);
+
+		int found = 0;
+		auto count = [&] (recorder::action* a) { found++; };
+
+		recorder::forEachActionAt(22050, 88200, 4, count);
+		REQUIRE(found == 1);
+
+		/* 60 bpm, cache not rebuilt yet: ticks are converted on the fly. */
+
+		found = 0;
+		recorder::forEachActionAt(22050, 176400, 4, count);
+		REQUIRE(found == 0);
+		recorder::forEachActionAt(44100, 176400, 4, count);
+		REQUIRE(found == 1);
 	}
 
 	SECTION("Test samplerate update")
 	{
-		recorder::rec(0, G_ACTION_KEYPRESS,   0, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KEYREL,    80, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KEYPRESS, 120, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KEYREL,   150, 1, 0.5f);
+		recorder::updateClock(88200, 4);  // 120 bpm, 44100 Hz
+
+		recorder::rec(0, G_ACTION_KEYPRESS,     0, 1, 0.5f);
+		recorder::rec(0, G_ACTION_KEYREL,   22050, 1, 0.5f);
+		recorder::rec(0, G_ACTION_KEYPRESS, 44100, 1, 0.5f);
 
-		recorder::updateSamplerate(44100, 22050); // scaling down
+		recorder::updateClock(96000, 4);  // 120 bpm, 48000 Hz
 
 		REQUIRE(recorder::frames.at(0) == 0);
-		REQUIRE(recorder::frames.at(1) == 160);
-		REQUIRE(recorder::frames.at(2) == 240);
-		REQUIRE(recorder::frames.at(3) == 300);
+		REQUIRE(recorder::frames.at(1) == 24000);
+		REQUIRE(recorder::frames.at(2) == 48000);
 
-		recorder::updateSamplerate(22050, 44100); // scaling up
+		recorder::updateClock(88200, 4);
 
 		REQUIRE(recorder::frames.at(0) == 0);
-		REQUIRE(recorder::frames.at(1) == 80);
-		REQUIRE(recorder::frames.at(2) == 120);
-		REQUIRE(recorder::frames.at(3) == 150);
+		REQUIRE(recorder::frames.at(1) == 22050);
+		REQUIRE(recorder::frames.at(2) == 44100);
+	}
+
+	SECTION("Test record by tick")
+	{
+		recorder::updateClock(88200, 4);
+		recorder::recTick(0, G_ACTION_KEYPRESS, G_PPQ * 2, 1, 0.5f);
+
+		REQUIRE(recorder::frames.size() == 1);
+		REQUIRE(recorder::frames.at(0) == 44100);
+		REQUIRE(recorder::global.at(0).at(0)->tick == G_PPQ * 2);
 	}
 
 	SECTION("Test expand")
 	{
+		recorder::updateClock(22050, 1);
+
 		recorder::rec(0, G_ACTION_KEYPRESS,   0, 1, 0.5f);
 		recorder::rec(0, G_ACTION_KEYREL,    80, 1, 0.5f);
 		recorder::rec(0, G_ACTION_KILL,     200, 1, 0.5f);
 
-		recorder::expand(300, 600);
+		recorder::updateClock(44100, 2);
+		recorder::expand(1, 2);
 
 		REQUIRE(recorder::frames.size() == 6);
 		REQUIRE(recorder::global.size() == 6);
+		recorder::sortActions();
 		REQUIRE(recorder::frames.at(0) == 0);
 		REQUIRE(recorder::frames.at(1) == 80);
 		REQUIRE(recorder::frames.at(2) == 200);
-		REQUIRE(recorder::frames.at(3) == 300);
-		REQUIRE(recorder::frames.at(4) == 380);
-		REQUIRE(recorder::frames.at(5) == 500);
+		REQUIRE(recorder::frames.at(3) == 22050);
+		REQUIRE(recorder::frames.at(4) == 22130);
+		REQUIRE(recorder::frames.at(5) == 22250);
 	}
 
-	SECTION("Test shrink")
+	SECTION("Test shrink and grow back")
 	{
-		recorder::rec(0, G_ACTION_KEYPRESS,   0, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KEYREL,    80, 1, 0.5f);
-		recorder::rec(0, G_ACTION_KILL,     200, 1, 0.5f);
+		recorder::updateClock(44100, 2);
 
-		recorder::shrink(100);
+		recorder::rec(0, G_ACTION_KEYPRESS,     0, 1, 0.5f);
+		recorder::rec(0, G_ACTION_KEYREL,      80, 1, 0.5f);
+		recorder::rec(0, G_ACTION_VOLUME,   22100, 0, 1.0f);
+		recorder::rec(1, G_ACTION_KEYPRESS,   100, 1, 0.5f);
+		recorder::rec(1, G_ACTION_VOLUME,     200, 0, 1.0f);
+		recorder::rec(1, G_ACTION_VOLUME,   10000, 0, 0.0f);
 
-		REQUIRE(recorder::frames.size() == 2);
-		REQUIRE(recorder::global.size() == 2);
-		REQUIRE(recorder::frames.at(0) == 0);
-		REQUIRE(recorder::frames.at(1) == 80);
+		/* Actions past the new end are kept. The volume envelope leaves them
+		out. */
+
+		recorder::updateClock(22050, 1);
+
+		REQUIRE(recorder::frames.size() == 6);
+		REQUIRE(recorder::frames.at(5) == 22100);  // past the end of the loop
+		REQUIRE(recorder::getVolumeEnvelope(0).size() == 0);
+
+		/* Growing back restores channel 0 as it was, while channel 1 (nothing
+		past the old end) gets its actions copied. */
+
+		recorder::updateClock(44100, 2);
+		recorder::expand(1, 2);
+
+		int chan0 = 0, chan1 = 0;
+		recorder::forEachAction([&] (const recorder::action* a) {
+			a->chan == 0 ? chan0++ : chan1++;
+		});
+		REQUIRE(chan0 == 3);
+		REQUIRE(chan1 == 6);
+		REQUIRE(recorder::frames.back() == 10000 + 22050);
+		REQUIRE(recorder::getVolumeEnvelope(0).size() == 1);
+		REQUIRE(recorder::getVolumeEnvelope(1).size() == 4);
 	}
 
 	SECTION("Test overdub, full overwrite")
@@ -499,4 +572,131 @@ TEST_CASE("Test Recorder")
 		REQUIRE(recorder::frames.at(2) == 400);
 		REQUIRE(recorder::frames.at(3) == 700);
 	}
+
+	SECTION("Test volume envelope compilation")
+	{
+		recorder::rec(0, G_ACTION_VOLUME,    0, 0, 1.0f);
+		recorder::rec(0, G_ACTION_VOLUME, 1000, 0, 1.0f);
+		recorder::rec(0, G_ACTION_VOLUME,  500, 0, 0.0f);
+		recorder::rec(1, G_ACTION_KEYPRESS, 200, 0, 0.0f);
+
+		/* Reading never compiles: envelopes are published when the edit is
+		done. */
+
+		REQUIRE(recorder::getVolumeEnvelope(0).size() == 0);
+
+		recorder::sortActions();
+
+		const vector<recorder::Segment>& env = recorder::getVolumeEnvelope(0);
+
+		REQUIRE(env.size() == 3);
+		REQUIRE(env.at(0).tick == 0);
+		REQUIRE(env.at(0).value == 1.0f);
+		REQUIRE(env.at(0).delta < 0.0f);
+		REQUIRE(env.at(1).tick == 500);
+		REQUIRE(env.at(1).value == 0.0f);
+		REQUIRE(env.at(1).delta > 0.0f);
+		REQUIRE(env.at(2).tick == 1000);
+		REQUIRE(env.at(2).delta == 0.0f);
+		REQUIRE(recorder::getVolumeEnvelope(1).size() == 0);
+
+		SECTION("Test volume envelope rebuild after deletion")
+		{
+			recorder::deleteAction(0, 500, G_ACTION_VOLUME, false, &mutex);
+
+			const vector<recorder::Segment>& env = recorder::getVolumeEnvelope(0);
+
+			REQUIRE(env.size() == 2);
+			REQUIRE(env.at(0).delta == 0.0f);
+		}
+	}
+
+	SECTION("Test parameter keys")
+	{
+		uint32_t key = recorder::paramKey(3, 1200);
+
+		REQUIRE(recorder::getParamPlugin(key) == 3);
+		REQUIRE(recorder::getParamIndex(key) == 1200);
+	}
+
+	SECTION("Test capture")
+	{
+		REQUIRE(recorder::capture(0, G_ACTION_PARAM, 300, recorder::paramKey(1, 2), 0.2f));
+		REQUIRE(recorder::capture(0, G_ACTION_PARAM, 100, recorder::paramKey(1, 2), 0.1f));
+		REQUIRE(recorder::frames.size() == 0);  // nothing recorded yet
+
+		int flushed = 0;
+		recorder::flushCaptured(&mutex, [&] (const recorder::action& a) { flushed++; });
+
+		REQUIRE(flushed == 2);
+		REQUIRE(recorder::frames.size() == 2);
+		REQUIRE(recorder::frames.at(0) == 100);  // sorted
+		REQUIRE(recorder::global.at(0).at(0)->type == G_ACTION_PARAM);
+		REQUIRE(recorder::global.at(0).at(0)->iValue == recorder::paramKey(1, 2));
+		REQUIRE(recorder::global.at(0).at(0)->fValue == 0.1f);
+
+		SECTION("Test clear parameter actions")
+		{
+			recorder::clearAction(0, G_ACTION_PARAM);
+
+			REQUIRE(recorder::frames.size() == 0);
+		}
+	}
+
+	SECTION("Test remap parameter actions")
+	{
+		recorder::rec(0, G_ACTION_PARAM,    100, recorder::paramKey(0, 4), 0.1f);
+		recorder::rec(0, G_ACTION_PARAM,    200, recorder::paramKey(1, 5), 0.2f);
+		recorder::rec(0, G_ACTION_PARAM,    300, recorder::paramKey(2, 6), 0.3f);
+		recorder::rec(1, G_ACTION_PARAM,    300, recorder::paramKey(0, 7), 0.4f);
+		recorder::rec(0, G_ACTION_KEYPRESS, 300, 0, 0.0f);
+		recorder::sortActions();
+
+		SECTION("Test remap after swap")
+		{
+			recorder::remapParams(0, { 2, 1, 0 });
+
+			REQUIRE(recorder::global.at(0).at(0)->iValue == recorder::paramKey(2, 4));
+			REQUIRE(recorder::global.at(1).at(0)->iValue == recorder::paramKey(1, 5));
+			REQUIRE(recorder::global.at(2).at(0)->iValue == recorder::paramKey(0, 6));
+			REQUIRE(recorder::global.at(2).at(1)->iValue == recorder::paramKey(0, 7));  // other channel
+			REQUIRE(recorder::global.at(2).at(2)->iValue == 0);                         // not a parameter
+		}
+
+		SECTION("Test remap after removal")
+		{
+			recorder::remapParams(0, { 0, -1, 1 });
+
+			REQUIRE(recorder::frames.size() == 2);
+			REQUIRE(recorder::frames.at(0) == 100);
+			REQUIRE(recorder::frames.at(1) == 300);
+			REQUIRE(recorder::global.at(0).at(0)->iValue == recorder::paramKey(0, 4));
+			REQUIRE(recorder::global.at(1).at(0)->iValue == recorder::paramKey(1, 6));
+			REQUIRE(recorder::global.at(1).size() == 3);
+		}
+	}
+
+	SECTION("Test captured overdub")
+	{
+		recorder::rec(0, G_ACTION_MUTEON,  000, 1, 0.5f);
+		recorder::rec(0, G_ACTION_MUTEOFF, 400, 1, 0.5f);
+
+		/* Same as "right overlap" above, replayed in order by flushCaptured(). */
+		REQUIRE(recorder::captureOverdubStart(0, G_ACTION_MUTEON | G_ACTION_MUTEOFF, 100, 16));
+		REQUIRE(recorder::captureOverdubStop(500, 500));
+		REQUIRE(recorder::frames.size() == 2);  // nothing recorded yet
+
+		int flushed = 0;
+		recorder::flushCaptured(&mutex, [&] (const recorder::action& a) { flushed++; });
+
+		REQUIRE(flushed == 1);
+		REQUIRE(recorder::frames.size() == 4);
+		REQUIRE(recorder::frames.at(1) == 84);
+		REQUIRE(recorder::global.at(1).at(0)->type == G_ACTION_MUTEOFF);
+		REQUIRE(recorder::frames.at(2) == 100);
+		REQUIRE(recorder::global.at(2).at(0)->type == G_ACTION_MUTEON);
+		REQUIRE(recorder::frames.at(3) == 500);
+		REQUIRE(recorder::global.at(3).at(0)->type == G_ACTION_MUTEOFF);
+		REQUIRE(recorder::countDropped() == 0);
+	}
 }
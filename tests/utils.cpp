@@ -16,6 +16,18 @@ TEST_CASE("Test filesystem utils")
 	REQUIRE(gu_dirname("tests/utils.cpp") == "tests");
 	REQUIRE(gu_getExt("tests/utils.cpp") == "cpp");
 	REQUIRE(gu_stripExt("tests/utils.cpp") == "tests/utils");
+	REQUIRE(gu_fileId("README.md") != "");
+	REQUIRE(gu_fileId("README.md") == gu_fileId("README.md"));
+	REQUIRE(gu_fileId("ghost_file") == "");
+	REQUIRE(gu_isSameFile("README.md", "./README.md") == true);
+	REQUIRE(gu_isSameFile("README.md", "tests/utils.cpp") == false);
+	REQUIRE(gu_isSameFile("README.md", "ghost_file") == false);
+
+	/* Linking a file onto itself, spelled differently, must leave it alone. */
+
+	std::string id = gu_fileId("README.md");
+	REQUIRE(gu_linkFile("README.md", "./README.md") == true);
+	REQUIRE(gu_fileId("README.md") == id);
 #if defined(_WIN32)
 	REQUIRE(gu_isRootDir("C:\\") == true);
 	REQUIRE(gu_isRootDir("C:\\path\\to\\something") == false);
@@ -49,6 +61,13 @@ TEST_CASE("Test string utils")
 	REQUIRE(v.at(0) == "Giada");
 	REQUIRE(v.at(1) == "is");
 	REQUIRE(v.at(2) == "cool");
+
+	vector<uint8_t> raw = { 'G', 'i', 'a', 'd', 'a', 0x00, 0xFF };
+	vector<uint8_t> decoded;
+	REQUIRE(gu_toBase64(raw) == "R2lhZGEA/w==");
+	REQUIRE(gu_fromBase64("R2lhZGEA/w==", decoded) == true);
+	REQUIRE(decoded == raw);
+	REQUIRE(gu_fromBase64("R2lh=GEA", decoded) == false);
 }
 
 
@@ -47,5 +47,29 @@ TEST_CASE("Test Wave class")
 			REQUIRE(wave.getBasename() == "sample");
 			REQUIRE(wave.getBasename(true) == "sample.wav");
 		}
+
+		SECTION("test hash")
+		{
+			uint64_t h = wave.hash();
+
+			REQUIRE(wave.hash() == h);
+			REQUIRE(Wave(wave).hash() == h);
+
+			float data[CHANNELS] = { 0.5f, -0.5f };
+			wave.copyData(data, 1, BUFFER_SIZE - 1);
+
+			REQUIRE(wave.hash() != h);
+		}
+
+		SECTION("test saved state")
+		{
+			REQUIRE(wave.getSavedFileId() == "");
+
+			wave.setSaved("1:2:3:4", wave.hash());
+
+			REQUIRE(wave.getSavedFileId() == "1:2:3:4");
+			REQUIRE(wave.getSavedHash() == wave.hash());
+			REQUIRE(Wave(wave).getSavedFileId() == "");
+		}
 	}
 }
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../src/core/waveLoader.h"
+#include "../src/core/wave.h"
+#include "../src/core/const.h"
+#include "../src/core/conf.h"
+#include <catch.hpp>
+
+
+using std::vector;
+using namespace giada::m;
+
+
+TEST_CASE("Test waveLoader")
+{
+	static const int COUNT = 64;
+
+	conf::samplerate  = 44100;
+	conf::rsmpQuality = 0;
+
+	/* Even channels point to a real file, odd ones to a missing one: failures
+	must come back as results too. */
+
+	vector<waveLoader::Request> reqs;
+	for (int i=0; i<COUNT; i++)
+		reqs.push_back({ i, i * 10, i, i % 2 ? "tests/resources/missing.wav" :
+			"tests/resources/test.wav" });
+
+	/* Collects until nothing is pending anymore, in finishing order. */
+
+	auto drain = [] () {
+		vector<waveLoader::Result> out;
+		while (waveLoader::countPending() > 0) {
+			waveLoader::collect([&] (const waveLoader::Result& r) { out.push_back(r); });
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		waveLoader::collect([&] (const waveLoader::Result& r) { out.push_back(r); });
+		return out;
+	};
+
+	SECTION("test every result is collected exactly once")
+	{
+		waveLoader::start(reqs);
+		vector<waveLoader::Result> out = drain();
+
+		REQUIRE(waveLoader::countPending() == 0);
+		REQUIRE(out.size() == COUNT);
+
+		vector<int> seen(COUNT, 0);
+		for (const waveLoader::Result& r : out) {
+			seen.at(r.chan)++;
+			REQUIRE(r.index == r.chan * 10);
+			if (r.chan % 2) {
+				REQUIRE(r.res != G_RES_OK);
+				REQUIRE(r.wave == nullptr);
+			}
+			else {
+				REQUIRE(r.res == G_RES_OK);
+				REQUIRE(r.wave != nullptr);
+			}
+			delete r.wave;
+		}
+		for (int s : seen)
+			REQUIRE(s == 1);
+
+		REQUIRE(waveLoader::collect([] (const waveLoader::Result& r) {}) == 0);
+	}
+
+	SECTION("test cancel")
+	{
+		/* Uncollected waves are freed by cancel(): nothing is left to collect,
+		neither now nor from loaders that were still running. */
+
+		waveLoader::start(reqs);
+		waveLoader::cancel();
+
+		REQUIRE(waveLoader::countPending() == 0);
+		REQUIRE(waveLoader::collect([] (const waveLoader::Result& r) {}) == 0);
+
+		/* Same, once every wave has been loaded but not collected yet. */
+
+		waveLoader::start(reqs);
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		REQUIRE(waveLoader::countPending() == COUNT);
+		waveLoader::cancel();
+
+		REQUIRE(waveLoader::countPending() == 0);
+		REQUIRE(waveLoader::collect([] (const waveLoader::Result& r) {}) == 0);
+
+		/* The loader is still usable afterwards. */
+
+		waveLoader::start(reqs);
+		vector<waveLoader::Result> out = drain();
+		REQUIRE(out.size() == COUNT);
+		for (const waveLoader::Result& r : out)
+			delete r.wave;
+	}
+
+	SECTION("test prioritize")
+	{
+		/* The last request is moved in front of the queue: it must be loaded long
+		before the others ahead of it, give or take the ones already running. The
+		queue is made longer than the number of loaders, one per core. */
+
+		int total = std::max(1u, std::thread::hardware_concurrency()) * 8;
+
+		vector<waveLoader::Request> files;
+		for (int i=0; i<total; i++)
+			files.push_back({ i, i, i, "tests/resources/test.wav" });
+
+		waveLoader::start(files);
+		waveLoader::prioritize(total - 1);
+		vector<waveLoader::Result> out = drain();
+
+		REQUIRE(out.size() == (unsigned) total);
+		int pos = 0;
+		while (out.at(pos).chan != total - 1)
+			pos++;
+		REQUIRE(pos < total / 2);
+
+		for (const waveLoader::Result& r : out)
+			delete r.wave;
+	}
+}
@@ -2,6 +2,7 @@
 #include "../src/core/waveManager.h"
 #include "../src/core/wave.h"
 #include "../src/core/const.h"
+#include "../src/utils/fs.h"
 #include <catch.hpp>
 
 
@@ -64,4 +65,57 @@ TEST_CASE("Test waveManager")
     REQUIRE(wave->isLogical() == false);
     REQUIRE(wave->isEdited() == false);
   }
+
+  SECTION("test loading")
+  {
+    int res = waveManager::load("tests/resources/test.wav", 1, G_SAMPLE_RATE * 2, &w);
+    std::unique_ptr<Wave> wave(w);
+
+    REQUIRE(res == G_RES_OK);
+    REQUIRE(wave->getRate() == G_SAMPLE_RATE * 2);
+    REQUIRE(wave->getChannels() == G_CHANNELS);
+    REQUIRE(wave->isLogical() == false);
+
+    w = nullptr;
+    res = waveManager::load("tests/resources/missing.wav", 1, G_SAMPLE_RATE, &w);
+
+    REQUIRE(res == G_RES_ERR_IO);
+    REQUIRE(w == nullptr);
+  }
+
+  SECTION("test saving a linked wave")
+  {
+    /* A wave hard-linked into a project (see glue_saveProject) and then edited
+    must not overwrite the file it was linked from. */
+
+    const string src  = "tests/resources/source.wav";
+    const string dest = "tests/resources/linked.wav";
+
+    int res = waveManager::create("tests/resources/test.wav", &w);
+    std::unique_ptr<Wave> orig(w);
+    REQUIRE(res == G_RES_OK);
+    REQUIRE(waveManager::save(orig.get(), src) == G_RES_OK);
+    REQUIRE(gu_linkFile(src, dest));
+
+    string srcId = gu_fileId(src);
+
+    res = waveManager::create(dest, &w);
+    std::unique_ptr<Wave> wave(w);
+    REQUIRE(res == G_RES_OK);
+
+    for (int i=0; i<wave->getSize(); i++)
+      wave->getFrame(i)[0] = 0.5f;
+    wave->setEdited(true);
+    REQUIRE(waveManager::save(wave.get(), dest) == G_RES_OK);
+
+    res = waveManager::create(src, &w);
+    std::unique_ptr<Wave> check(w);
+    REQUIRE(res == G_RES_OK);
+    REQUIRE(gu_fileId(src) == srcId);
+    REQUIRE(check->hash() == orig->hash());
+    REQUIRE(check->hash() != wave->hash());
+
+    remove(src.c_str());
+    remove(dest.c_str());
+  }
 }
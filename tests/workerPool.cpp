@@ -0,0 +1,55 @@
+#include <atomic>
+#include <vector>
+#include "../src/core/workerPool.h"
+#include <catch.hpp>
+
+
+TEST_CASE("Test workerPool")
+{
+	using namespace giada::m;
+
+	workerPool::init(3);
+
+	SECTION("test init")
+	{
+		REQUIRE(workerPool::countWorkers() == 3);
+	}
+
+	SECTION("test every index is called exactly once")
+	{
+		static const int COUNT = 1000;
+
+		std::vector<std::atomic<int>> calls(COUNT);
+		for (std::atomic<int>& c : calls)
+			c.store(0);
+
+		workerPool::run(COUNT, [](int i, void* data) {
+			(*static_cast<std::vector<std::atomic<int>>*>(data))[i]++;
+		}, &calls);
+
+		bool once = true;
+		for (std::atomic<int>& c : calls)
+			once &= c.load() == 1;
+		REQUIRE(once);
+	}
+
+	SECTION("test consecutive jobs")
+	{
+		/* Jobs come one after another, as in the audio callback: none of them may
+		leak calls into the next. */
+
+		std::atomic<int> sum(0);
+		for (int j=0; j<2000; j++)
+			workerPool::run(j % 7, [](int i, void* data) {
+				(*static_cast<std::atomic<int>*>(data)) += i + 1;
+			}, &sum);
+
+		int expected = 0;
+		for (int j=0; j<2000; j++)
+			expected += (j % 7) * (j % 7 + 1) / 2;
+		REQUIRE(sum.load() == expected);
+	}
+
+	workerPool::close();
+	REQUIRE(workerPool::countWorkers() == 0);
+}